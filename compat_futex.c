@@ -27,6 +27,7 @@
 #include <errno.h>
 #include <poll.h>
 #include <stdint.h>
+#include <time.h>
 
 #include <urcu/arch.h>
 #include <urcu/futex.h>
@@ -34,22 +35,39 @@
 static pthread_mutex_t compat_futex_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t compat_futex_cond = PTHREAD_COND_INITIALIZER;
 
+/*
+ * Relative FUTEX_WAIT timeout to absolute CLOCK_REALTIME deadline, as
+ * expected by pthread_cond_timedwait().
+ */
+static void compat_futex_deadline(const struct timespec *timeout,
+		struct timespec *deadline)
+{
+	(void) clock_gettime(CLOCK_REALTIME, deadline);
+	deadline->tv_sec += timeout->tv_sec;
+	deadline->tv_nsec += timeout->tv_nsec;
+	if (deadline->tv_nsec >= 1000000000L) {
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000L;
+	}
+}
+
 /*
  * _NOT SIGNAL-SAFE_. pthread_cond is not signal-safe anyway. Though.
- * For now, timeout, uaddr2 and val3 are unused.
+ * For now, uaddr2 and val3 are unused. The FUTEX_WAIT timeout is relative,
+ * as with sys_futex, and -ETIMEDOUT is returned when it expires.
  * Waiter will relinquish the CPU until woken up.
  */
 
 int compat_futex_noasync(int32_t *uaddr, int op, int32_t val,
 	const struct timespec *timeout, int32_t *uaddr2, int32_t val3)
 {
+	struct timespec deadline;
 	int ret, gret = 0;
 
 	/*
 	 * Check if NULL. Don't let users expect that they are taken into
 	 * account. 
 	 */
-	assert(!timeout);
 	assert(!uaddr2);
 	assert(!val3);
 
@@ -64,7 +82,15 @@ int compat_futex_noasync(int32_t *uaddr, int op, int32_t val,
 	case FUTEX_WAIT:
 		if (*uaddr != val)
 			goto end;
-		pthread_cond_wait(&compat_futex_cond, &compat_futex_lock);
+		if (!timeout) {
+			pthread_cond_wait(&compat_futex_cond,
+					&compat_futex_lock);
+			break;
+		}
+		compat_futex_deadline(timeout, &deadline);
+		if (pthread_cond_timedwait(&compat_futex_cond,
+				&compat_futex_lock, &deadline) == ETIMEDOUT)
+			gret = -ETIMEDOUT;
 		break;
 	case FUTEX_WAKE:
 		pthread_cond_broadcast(&compat_futex_cond);
@@ -80,18 +106,20 @@ end:
 
 /*
  * _ASYNC SIGNAL-SAFE_.
- * For now, timeout, uaddr2 and val3 are unused.
+ * For now, uaddr2 and val3 are unused. The FUTEX_WAIT timeout is relative,
+ * and rounded up to the 10ms polling period.
  * Waiter will busy-loop trying to read the condition.
  */
 
 int compat_futex_async(int32_t *uaddr, int op, int32_t val,
 	const struct timespec *timeout, int32_t *uaddr2, int32_t val3)
 {
+	long polls = -1;
+
 	/*
 	 * Check if NULL. Don't let users expect that they are taken into
 	 * account. 
 	 */
-	assert(!timeout);
 	assert(!uaddr2);
 	assert(!val3);
 
@@ -102,8 +130,14 @@ int compat_futex_async(int32_t *uaddr, int op, int32_t val,
 
 	switch (op) {
 	case FUTEX_WAIT:
-		while (*uaddr == val)
+		if (timeout)
+			polls = timeout->tv_sec * 100
+				+ (timeout->tv_nsec + 9999999) / 10000000;
+		while (*uaddr == val) {
+			if (!polls--)
+				return -ETIMEDOUT;
 			poll(NULL, 0, 10);
+		}
 		break;
 	case FUTEX_WAKE:
 		break;
@@ -0,0 +1,162 @@
+/*
+ * rcurwlock.c
+ *
+ * Userspace RCU library - RCU-assisted reader-biased reader-writer lock
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <poll.h>
+#include <time.h>
+
+#include <urcu/compiler.h>
+#include <urcu/arch.h>
+#include <urcu/system.h>
+#include <urcu/uatomic.h>
+/* Do not #define _LGPL_SOURCE to ensure we can emit the wrapper symbols */
+#undef _LGPL_SOURCE
+#include "urcu/rcurwlock.h"
+#define _LGPL_SOURCE
+#include "urcu/static/rcurwlock.h"
+#include "urcu-die.h"
+
+/*
+ * Readers restore the bias once RCU_RWLOCK_INHIBIT times the duration of
+ * the last revocation has elapsed, which bounds the time writers spend
+ * revoking to about 1 / (RCU_RWLOCK_INHIBIT + 1).
+ */
+#define RCU_RWLOCK_INHIBIT	9
+
+/* Slot checks before a writer sleeps waiting for a reader. */
+#define RCU_RWLOCK_SPIN		1000
+
+struct rcu_rwlock *rcu_rwlock_visible_readers[1UL << RCU_RWLOCK_READERS_ORDER];
+
+static uint64_t rcu_rwlock_now(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int _rcu_rwlock_init(struct rcu_rwlock *lock,
+		const struct rcu_flavor_struct *flavor)
+{
+	lock->rbias = 1;
+	lock->inhibit_until = 0;
+	lock->flavor = flavor;
+	return pthread_rwlock_init(&lock->rwlock, NULL);
+}
+
+int rcu_rwlock_destroy(struct rcu_rwlock *lock)
+{
+	return pthread_rwlock_destroy(&lock->rwlock);
+}
+
+void rcu_rwlock_read_lock_slow(struct rcu_rwlock *lock,
+		struct rcu_rwlock_reader *reader)
+{
+	int ret;
+
+	/* With QSBR, a writer holding the rwlock may wait for us. */
+	lock->flavor->thread_offline();
+	ret = pthread_rwlock_rdlock(&lock->rwlock);
+	lock->flavor->thread_online();
+	if (ret)
+		urcu_die(ret);
+	reader->slot = NULL;
+	/* Writers are excluded: the bias can be restored. */
+	if (!CMM_LOAD_SHARED(lock->rbias)
+			&& rcu_rwlock_now() >= lock->inhibit_until)
+		CMM_STORE_SHARED(lock->rbias, 1);
+}
+
+void rcu_rwlock_read_unlock_slow(struct rcu_rwlock *lock)
+{
+	int ret;
+
+	ret = pthread_rwlock_unlock(&lock->rwlock);
+	if (ret)
+		urcu_die(ret);
+}
+
+/*
+ * Clear the bias, then wait for a grace period: readers which saw it set
+ * have published their slot by then, and later ones see it cleared and
+ * block on the rwlock. Then wait for the published readers to leave.
+ */
+static void rcu_rwlock_revoke(struct rcu_rwlock *lock)
+{
+	unsigned long i, loops;
+	uint64_t start, now;
+
+	start = rcu_rwlock_now();
+	CMM_STORE_SHARED(lock->rbias, 0);
+	lock->flavor->update_synchronize_rcu();
+	for (i = 0; i < (1UL << RCU_RWLOCK_READERS_ORDER); i++) {
+		loops = 0;
+		while (CMM_LOAD_SHARED(rcu_rwlock_visible_readers[i]) == lock) {
+			if (++loops < RCU_RWLOCK_SPIN) {
+				caa_cpu_relax();
+			} else {
+				(void) poll(NULL, 0, 1);
+			}
+		}
+	}
+	now = rcu_rwlock_now();
+	lock->inhibit_until = now + (now - start) * RCU_RWLOCK_INHIBIT;
+}
+
+void rcu_rwlock_write_lock(struct rcu_rwlock *lock)
+{
+	int ret;
+
+	lock->flavor->thread_offline();
+	ret = pthread_rwlock_wrlock(&lock->rwlock);
+	lock->flavor->thread_online();
+	if (ret)
+		urcu_die(ret);
+	if (CMM_LOAD_SHARED(lock->rbias))
+		rcu_rwlock_revoke(lock);
+	/* Order readers releasing their slot before the critical section. */
+	cmm_smp_mb();
+}
+
+void rcu_rwlock_write_unlock(struct rcu_rwlock *lock)
+{
+	int ret;
+
+	ret = pthread_rwlock_unlock(&lock->rwlock);
+	if (ret)
+		urcu_die(ret);
+}
+
+/*
+ * library wrappers to be used by non-LGPL compatible source code.
+ */
+
+void rcu_rwlock_read_lock(struct rcu_rwlock *lock,
+		struct rcu_rwlock_reader *reader)
+{
+	_rcu_rwlock_read_lock(lock, reader);
+}
+
+void rcu_rwlock_read_unlock(struct rcu_rwlock *lock,
+		struct rcu_rwlock_reader *reader)
+{
+	_rcu_rwlock_read_unlock(lock, reader);
+}
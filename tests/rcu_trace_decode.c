@@ -0,0 +1,206 @@
+/*
+ * rcu_trace_decode.c
+ *
+ * Userspace RCU library - decoder for rcu_trace_dump() output
+ *
+ * Prints the events of a trace written by rcu_trace_dump(), read from the
+ * file given as argument or from the standard input, with timestamps in
+ * seconds relative to the first event, followed by a summary: grace period,
+ * callback batch and hash table resize counts and durations.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <urcu/trace.h>
+
+/* Start events waiting for their end, matched by thread. */
+#define MAX_PENDING	1024
+
+struct pending {
+	uint32_t tid;
+	uint32_t type;
+	uint64_t ts_ns;
+};
+
+struct duration {
+	unsigned long long count, total_ns, max_ns;
+};
+
+static const struct {
+	const char *name;
+	const char *arg[2];
+} event_desc[RCU_TRACE_NR_TYPES] = {
+	[RCU_TRACE_GP_START] = { "gp_start", { "seq", "expedited" } },
+	[RCU_TRACE_GP_END] = { "gp_end", { "seq", "expedited" } },
+	[RCU_TRACE_CALL_RCU_BATCH] = { "call_rcu_batch", { "invoked", "queued" } },
+	[RCU_TRACE_CALL_RCU_SLEEP] = { "call_rcu_sleep", { NULL, NULL } },
+	[RCU_TRACE_CALL_RCU_WAKE] = { "call_rcu_wake", { NULL, NULL } },
+	[RCU_TRACE_DEFER_BATCH] = { "defer_batch", { "entries", NULL } },
+	[RCU_TRACE_DEFER_SLEEP] = { "defer_sleep", { NULL, NULL } },
+	[RCU_TRACE_DEFER_WAKE] = { "defer_wake", { NULL, NULL } },
+	[RCU_TRACE_LFHT_RESIZE_START] = { "lfht_resize_start", { "old", "new" } },
+	[RCU_TRACE_LFHT_RESIZE_END] = { "lfht_resize_end", { "old", "new" } },
+};
+
+static struct pending pending[MAX_PENDING];
+static int nr_pending;
+
+static void start(const struct rcu_trace_record *rec)
+{
+	if (nr_pending == MAX_PENDING)
+		return;
+	pending[nr_pending].tid = rec->tid;
+	pending[nr_pending].type = rec->type;
+	pending[nr_pending].ts_ns = rec->ts_ns;
+	nr_pending++;
+}
+
+static void end(const struct rcu_trace_record *rec, uint32_t start_type,
+		struct duration *d)
+{
+	uint64_t ns;
+	int i;
+
+	for (i = nr_pending - 1; i >= 0; i--) {
+		if (pending[i].tid == rec->tid
+				&& pending[i].type == start_type)
+			break;
+	}
+	if (i < 0)
+		return;
+	ns = rec->ts_ns - pending[i].ts_ns;
+	d->count++;
+	d->total_ns += ns;
+	if (ns > d->max_ns)
+		d->max_ns = ns;
+	pending[i] = pending[--nr_pending];
+}
+
+static void print_duration(const char *name, const struct duration *d)
+{
+	printf("%-16s %10llu  avg %12.3f us  max %12.3f us\n", name,
+	       d->count, d->count ? (double) d->total_ns / d->count / 1000 : 0,
+	       (double) d->max_ns / 1000);
+}
+
+int main(int argc, char **argv)
+{
+	struct rcu_trace_header hdr;
+	struct rcu_trace_record rec;
+	struct duration gp = { 0 }, resize = { 0 }, call_rcu_sleep = { 0 },
+		defer_sleep = { 0 };
+	unsigned long long i, nr_batches = 0, nr_cbs = 0, nr_defer = 0;
+	unsigned long long nr_defer_batches = 0;
+	uint64_t first = 0;
+	FILE *f = stdin;
+	int j;
+
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [trace file]\n", argv[0]);
+		return 1;
+	}
+	if (argc == 2) {
+		f = fopen(argv[1], "rb");
+		if (!f) {
+			perror(argv[1]);
+			return 1;
+		}
+	}
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1
+			|| strncmp(hdr.magic, RCU_TRACE_MAGIC, sizeof(hdr.magic))) {
+		fprintf(stderr, "Not an RCU trace\n");
+		return 1;
+	}
+	if (hdr.version != RCU_TRACE_VERSION
+			|| hdr.record_size != sizeof(rec)) {
+		fprintf(stderr, "Unsupported trace version %u, record size %u\n",
+			hdr.version, hdr.record_size);
+		return 1;
+	}
+
+	for (i = 0; i < hdr.nr_records; i++) {
+		if (fread(&rec, sizeof(rec), 1, f) != 1) {
+			fprintf(stderr, "Truncated trace: %llu of %llu records\n",
+				i, (unsigned long long) hdr.nr_records);
+			return 1;
+		}
+		if (!i)
+			first = rec.ts_ns;
+		if (!rec.type || rec.type >= RCU_TRACE_NR_TYPES) {
+			printf("%4llu.%06llu tid %-7u unknown event %u\n",
+			       (unsigned long long) (rec.ts_ns - first) / 1000000000,
+			       (unsigned long long) (rec.ts_ns - first) / 1000 % 1000000,
+			       rec.tid, rec.type);
+			continue;
+		}
+		printf("%4llu.%06llu tid %-7u %-18s",
+		       (unsigned long long) (rec.ts_ns - first) / 1000000000,
+		       (unsigned long long) (rec.ts_ns - first) / 1000 % 1000000,
+		       rec.tid, event_desc[rec.type].name);
+		for (j = 0; j < 2; j++) {
+			if (event_desc[rec.type].arg[j])
+				printf(" %s=%llu", event_desc[rec.type].arg[j],
+				       (unsigned long long) rec.arg[j]);
+		}
+		printf("\n");
+
+		switch (rec.type) {
+		case RCU_TRACE_GP_START:
+		case RCU_TRACE_LFHT_RESIZE_START:
+		case RCU_TRACE_CALL_RCU_SLEEP:
+		case RCU_TRACE_DEFER_SLEEP:
+			start(&rec);
+			break;
+		case RCU_TRACE_GP_END:
+			end(&rec, RCU_TRACE_GP_START, &gp);
+			break;
+		case RCU_TRACE_LFHT_RESIZE_END:
+			end(&rec, RCU_TRACE_LFHT_RESIZE_START, &resize);
+			break;
+		case RCU_TRACE_CALL_RCU_WAKE:
+			end(&rec, RCU_TRACE_CALL_RCU_SLEEP, &call_rcu_sleep);
+			break;
+		case RCU_TRACE_DEFER_WAKE:
+			end(&rec, RCU_TRACE_DEFER_SLEEP, &defer_sleep);
+			break;
+		case RCU_TRACE_CALL_RCU_BATCH:
+			nr_batches++;
+			nr_cbs += rec.arg[0];
+			break;
+		case RCU_TRACE_DEFER_BATCH:
+			nr_defer_batches++;
+			nr_defer += rec.arg[0];
+			break;
+		}
+	}
+
+	printf("\n%llu events over %.3f ms\n",
+	       (unsigned long long) hdr.nr_records,
+	       hdr.nr_records ? (double) (rec.ts_ns - first) / 1000000 : 0);
+	print_duration("grace periods", &gp);
+	print_duration("lfht resizes", &resize);
+	print_duration("call_rcu sleeps", &call_rcu_sleep);
+	print_duration("defer sleeps", &defer_sleep);
+	printf("%-16s %10llu  avg %12.1f callbacks\n", "call_rcu batches",
+	       nr_batches, nr_batches ? (double) nr_cbs / nr_batches : 0);
+	printf("%-16s %10llu  avg %12.1f entries\n", "defer batches",
+	       nr_defer_batches,
+	       nr_defer_batches ? (double) nr_defer / nr_defer_batches : 0);
+	return 0;
+}
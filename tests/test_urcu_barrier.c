@@ -0,0 +1,157 @@
+/*
+ * test_urcu_barrier.c
+ *
+ * Userspace RCU library - rcu_barrier() test
+ *
+ * Threads queue callbacks on their own call_rcu thread, on the per-CPU
+ * ones and on the default one, then call rcu_barrier() and check that
+ * every callback they queued before has been invoked. Some rounds free
+ * a call_rcu thread with callbacks still queued.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_QSBR
+#include <urcu-qsbr.h>
+#elif defined(RCU_BP)
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+
+#define NR_THREADS	4
+#define NR_ROUNDS	20
+#define NR_CALLBACKS	1000
+
+struct item {
+	struct rcu_head head;
+	unsigned long *invoked;
+};
+
+static int failed;
+
+static void item_free(struct rcu_head *head)
+{
+	struct item *item = caa_container_of(head, struct item, head);
+
+	uatomic_inc(item->invoked);
+	free(item);
+}
+
+static void queue_callbacks(unsigned long *invoked)
+{
+	struct item *item;
+	int i;
+
+	for (i = 0; i < NR_CALLBACKS; i++) {
+		item = malloc(sizeof(*item));
+		if (!item)
+			abort();
+		item->invoked = invoked;
+		call_rcu(&item->head, item_free);
+	}
+}
+
+/*
+ * call_rcu_data_free() waits for the call_rcu thread to stop, which may
+ * first wait for a grace period: QSBR threads must be offline.
+ */
+static void free_call_rcu_data(struct call_rcu_data *crdp)
+{
+	set_thread_call_rcu_data(NULL);
+	rcu_thread_offline();
+	call_rcu_data_free(crdp);
+	rcu_thread_online();
+}
+
+static void *thr_barrier(void *arg)
+{
+	long id = (long) arg;
+	struct call_rcu_data *crdp;
+	unsigned long invoked = 0, queued = 0;
+	int round;
+
+	rcu_register_thread();
+	for (round = 0; round < NR_ROUNDS; round++) {
+		/*
+		 * Alternate between the per-CPU or default call_rcu threads
+		 * and a call_rcu thread of our own, freed with callbacks
+		 * left on every other use.
+		 */
+		crdp = NULL;
+		if ((round + id) & 1) {
+			crdp = create_call_rcu_data(0, -1);
+			set_thread_call_rcu_data(crdp);
+		}
+		queue_callbacks(&invoked);
+		queued += NR_CALLBACKS;
+		if (crdp && (round & 2)) {
+			free_call_rcu_data(crdp);
+			crdp = NULL;
+		}
+		rcu_barrier();
+		if (uatomic_read(&invoked) != queued) {
+			printf("FAIL: thread %ld round %d: %lu of %lu callbacks invoked\n",
+			       id, round, uatomic_read(&invoked), queued);
+			uatomic_set(&failed, 1);
+		}
+		if (crdp)
+			free_call_rcu_data(crdp);
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t tid[NR_THREADS];
+	long i;
+	int ret;
+
+	/* Per-CPU call_rcu threads may be unavailable: not an error. */
+	(void) create_all_cpu_call_rcu_data(0);
+
+	for (i = 0; i < NR_THREADS; i++) {
+		ret = pthread_create(&tid[i], NULL, thr_barrier, (void *) i);
+		if (ret) {
+			perror("pthread_create");
+			return 1;
+		}
+	}
+	for (i = 0; i < NR_THREADS; i++) {
+		ret = pthread_join(tid[i], NULL);
+		if (ret) {
+			perror("pthread_join");
+			return 1;
+		}
+	}
+
+	/* From an unregistered thread, with no callback queued. */
+	rcu_barrier();
+	free_all_cpu_call_rcu_data();
+
+	if (failed)
+		return 1;
+	printf("OK: %d threads, %d rounds of %d callbacks\n",
+	       NR_THREADS, NR_ROUNDS, NR_CALLBACKS);
+	return 0;
+}
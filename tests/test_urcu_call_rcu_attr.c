@@ -0,0 +1,261 @@
+/*
+ * test_urcu_call_rcu_attr.c
+ *
+ * Userspace RCU library - call_rcu thread attributes test
+ *
+ * Checks that invalid attributes are refused, that a call_rcu thread
+ * without batching delay invokes callbacks sooner than one with the
+ * default delay, and that an adaptive thread shortens its delay under a
+ * flood of callbacks and lengthens it back once idle. Also checks that
+ * grace periods complete while a call_rcu thread limited in callbacks
+ * or time per batch works through a long batch.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_QSBR
+#include <urcu-qsbr.h>
+#elif defined(RCU_BP)
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+
+#define NR_LATENCY	20
+#define FLOOD_MS	300
+#define FLOOD_CALLBACKS	1000
+#define NR_IDLE		10
+#define NR_SLOW		2000
+#define SLOW_NS		100000ULL
+
+struct item {
+	struct rcu_head head;
+	unsigned long *invoked;
+};
+
+static int failed;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void item_free(struct rcu_head *head)
+{
+	struct item *item = caa_container_of(head, struct item, head);
+
+	uatomic_inc(item->invoked);
+	free(item);
+}
+
+static void queue_callback(unsigned long *invoked)
+{
+	struct item *item;
+
+	item = malloc(sizeof(*item));
+	if (!item)
+		abort();
+	item->invoked = invoked;
+	call_rcu(&item->head, item_free);
+}
+
+static void slow_item_free(struct rcu_head *head)
+{
+	unsigned long long end = now_ns() + SLOW_NS;
+
+	while (now_ns() < end)
+		caa_cpu_relax();
+	item_free(head);
+}
+
+/* QSBR threads must be offline while waiting for the call_rcu thread. */
+static void wait_invoked(unsigned long *invoked, unsigned long count)
+{
+	rcu_thread_offline();
+	while (uatomic_read(invoked) < count)
+		poll(NULL, 0, 1);
+	rcu_thread_online();
+}
+
+static void free_call_rcu_data(struct call_rcu_data *crdp)
+{
+	set_thread_call_rcu_data(NULL);
+	rcu_thread_offline();
+	call_rcu_data_free(crdp);
+	rcu_thread_online();
+}
+
+static void test_invalid(void)
+{
+	struct call_rcu_attr attr = URCU_CALL_RCU_ATTR_INIT;
+	struct call_rcu_data *crdp;
+
+	attr.min_delay_us = attr.max_delay_us + 1;
+	errno = 0;
+	crdp = create_call_rcu_data_attr(0, -1, &attr);
+	if (crdp || errno != EINVAL) {
+		printf("FAIL: min_delay_us > max_delay_us accepted at creation\n");
+		failed = 1;
+	}
+	crdp = create_call_rcu_data(0, -1);
+	if (call_rcu_data_set_attr(crdp, &attr) != -EINVAL) {
+		printf("FAIL: min_delay_us > max_delay_us accepted by set_attr\n");
+		failed = 1;
+	}
+	free_call_rcu_data(crdp);
+}
+
+/* Average latency from call_rcu() to the callback, in nanoseconds. */
+static unsigned long long measure_latency(struct call_rcu_data *crdp)
+{
+	unsigned long invoked = 0;
+	unsigned long long start;
+	int i;
+
+	set_thread_call_rcu_data(crdp);
+	start = now_ns();
+	for (i = 0; i < NR_LATENCY; i++) {
+		queue_callback(&invoked);
+		wait_invoked(&invoked, i + 1);
+	}
+	return (now_ns() - start) / NR_LATENCY;
+}
+
+static void test_latency(void)
+{
+	struct call_rcu_attr attr = URCU_CALL_RCU_ATTR_INIT;
+	struct call_rcu_data *crdp;
+	unsigned long long fast, slow;
+
+	attr.min_delay_us = attr.max_delay_us = 0;
+	crdp = create_call_rcu_data_attr(0, -1, &attr);
+	fast = measure_latency(crdp);
+	free_call_rcu_data(crdp);
+
+	crdp = create_call_rcu_data(0, -1);
+	slow = measure_latency(crdp);
+	free_call_rcu_data(crdp);
+
+	printf("Callback latency: %llu us without delay, %llu us by default\n",
+	       fast / 1000, slow / 1000);
+	if (slow < 10000000ULL || fast >= slow) {
+		printf("FAIL: batching delay not applied\n");
+		failed = 1;
+	}
+}
+
+static void test_adaptive(void)
+{
+	struct call_rcu_attr attr = URCU_CALL_RCU_ATTR_INIT;
+	struct call_rcu_data *crdp;
+	unsigned long invoked = 0, queued = 0, flood_delay;
+	unsigned long long end;
+	int i;
+
+	attr.min_delay_us = 0;
+	attr.max_delay_us = 20000;
+	attr.adaptive = 1;
+	crdp = create_call_rcu_data_attr(0, -1, &attr);
+	set_thread_call_rcu_data(crdp);
+
+	end = now_ns() + FLOOD_MS * 1000000ULL;
+	while (now_ns() < end) {
+		for (i = 0; i < FLOOD_CALLBACKS; i++)
+			queue_callback(&invoked);
+		queued += FLOOD_CALLBACKS;
+		rcu_thread_offline();
+		poll(NULL, 0, 1);
+		rcu_thread_online();
+	}
+	call_rcu_data_get_attr(crdp, &attr);
+	flood_delay = attr.cur_delay_us;
+	wait_invoked(&invoked, queued);
+
+	for (i = 0; i < NR_IDLE; i++) {
+		queue_callback(&invoked);
+		wait_invoked(&invoked, ++queued);
+	}
+	call_rcu_data_get_attr(crdp, &attr);
+	printf("Adaptive delay: %lu us under flood, %lu us once idle\n",
+	       flood_delay, attr.cur_delay_us);
+	if (flood_delay >= attr.max_delay_us
+			|| attr.cur_delay_us <= flood_delay) {
+		printf("FAIL: adaptive delay not adjusted\n");
+		failed = 1;
+	}
+	free_call_rcu_data(crdp);
+}
+
+static void test_batch_limit(unsigned long max_batch,
+		unsigned long batch_time_us)
+{
+	struct call_rcu_attr attr = URCU_CALL_RCU_ATTR_INIT;
+	struct call_rcu_data *crdp;
+	unsigned long invoked = 0, after_gp;
+	struct item *item;
+	int i;
+
+	attr.max_batch = max_batch;
+	attr.batch_time_us = batch_time_us;
+	crdp = create_call_rcu_data_attr(0, -1, &attr);
+	set_thread_call_rcu_data(crdp);
+	for (i = 0; i < NR_SLOW; i++) {
+		item = malloc(sizeof(*item));
+		if (!item)
+			abort();
+		item->invoked = &invoked;
+		call_rcu(&item->head, slow_item_free);
+	}
+	wait_invoked(&invoked, 1);
+	/* Must not wait for the whole batch to be invoked. */
+	synchronize_rcu();
+	after_gp = uatomic_read(&invoked);
+	wait_invoked(&invoked, NR_SLOW);
+	printf("Batch limit %lu callbacks, %lu us: %lu of %d callbacks invoked after a grace period\n",
+	       max_batch, batch_time_us, after_gp, NR_SLOW);
+	if (after_gp >= NR_SLOW) {
+		printf("FAIL: grace period held back by the batch\n");
+		failed = 1;
+	}
+	free_call_rcu_data(crdp);
+}
+
+int main(int argc, char **argv)
+{
+	rcu_register_thread();
+	test_invalid();
+	test_latency();
+	test_adaptive();
+	test_batch_limit(10, 0);
+	test_batch_limit(0, 2000);
+	rcu_unregister_thread();
+
+	if (failed)
+		return 1;
+	printf("OK\n");
+	return 0;
+}
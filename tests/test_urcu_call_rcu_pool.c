@@ -0,0 +1,248 @@
+/*
+ * test_urcu_call_rcu_pool.c
+ *
+ * Userspace RCU library - call_rcu thread pool test
+ *
+ * Creates per-CPU call_rcu queues serviced by a pool of threads, floods
+ * them with slow callbacks in small chunks and checks that several pool
+ * threads took part in invoking them, then checks rcu_barrier() and the
+ * teardown and re-creation of the pool, including teardown while
+ * rcu_barrier() waits for callbacks the pool threads have yet to invoke.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_QSBR
+#include <urcu-qsbr.h>
+#elif defined(RCU_BP)
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+
+#define NR_WORKERS	4
+#define NR_SLOW		4000
+#define SLOW_NS		20000ULL
+#define CHUNK		16
+#define NR_BARRIER	1000
+
+struct item {
+	struct rcu_head head;
+	unsigned long *invoked;
+};
+
+static pthread_mutex_t seen_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t seen[NR_WORKERS];
+static int nr_seen;
+static int failed;
+static int barrier_started;
+static unsigned long barrier_invoked;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void item_free(struct rcu_head *head)
+{
+	struct item *item = caa_container_of(head, struct item, head);
+
+	uatomic_inc(item->invoked);
+	free(item);
+}
+
+static void slow_item_free(struct rcu_head *head)
+{
+	unsigned long long end = now_ns() + SLOW_NS;
+	pthread_t self = pthread_self();
+	int i;
+
+	while (now_ns() < end)
+		caa_cpu_relax();
+	pthread_mutex_lock(&seen_mutex);
+	for (i = 0; i < nr_seen; i++) {
+		if (pthread_equal(seen[i], self))
+			break;
+	}
+	if (i == nr_seen && nr_seen < NR_WORKERS)
+		seen[nr_seen++] = self;
+	pthread_mutex_unlock(&seen_mutex);
+	item_free(head);
+}
+
+static void queue_callbacks(unsigned long *invoked, int nr,
+		void (*func)(struct rcu_head *head))
+{
+	struct item *item;
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		item = malloc(sizeof(*item));
+		if (!item)
+			abort();
+		item->invoked = invoked;
+		call_rcu(&item->head, func);
+	}
+}
+
+/* QSBR threads must be offline while waiting for the pool. */
+static void wait_invoked(unsigned long *invoked, unsigned long count)
+{
+	rcu_thread_offline();
+	while (uatomic_read(invoked) < count)
+		poll(NULL, 0, 1);
+	rcu_thread_online();
+}
+
+static void set_chunk(unsigned long max_batch)
+{
+	struct call_rcu_attr attr;
+	struct call_rcu_data *crdp;
+	long cpu, nr_cpus = sysconf(_SC_NPROCESSORS_CONF);
+
+	for (cpu = 0; cpu < nr_cpus; cpu++) {
+		rcu_read_lock();
+		crdp = get_cpu_call_rcu_data(cpu);
+		if (crdp) {
+			call_rcu_data_get_attr(crdp, &attr);
+			attr.max_batch = max_batch;
+			(void) call_rcu_data_set_attr(crdp, &attr);
+		}
+		rcu_read_unlock();
+	}
+}
+
+static void free_pool(void)
+{
+	rcu_thread_offline();
+	free_all_cpu_call_rcu_data();
+	rcu_thread_online();
+}
+
+static void *thr_barrier(void *arg)
+{
+	unsigned long *invoked = arg;
+
+	rcu_register_thread();
+	uatomic_set(&barrier_started, 1);
+	rcu_barrier();
+	uatomic_set(&barrier_invoked, uatomic_read(invoked));
+	rcu_unregister_thread();
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long invoked = 0;
+	pthread_t tid;
+	int ret;
+
+	rcu_register_thread();
+
+	if (create_all_cpu_call_rcu_data_pool(0, -1) != -EINVAL) {
+		printf("FAIL: negative number of workers accepted\n");
+		failed = 1;
+	}
+	ret = create_all_cpu_call_rcu_data_pool(0, NR_WORKERS);
+	if (ret == -EINVAL) {
+		printf("Per-CPU call_rcu threads unsupported, skipping\n");
+		rcu_unregister_thread();
+		return 0;
+	}
+	if (ret) {
+		printf("FAIL: pool creation returned %d\n", ret);
+		return 1;
+	}
+	if (create_all_cpu_call_rcu_data_pool(0, NR_WORKERS) != -EBUSY) {
+		printf("FAIL: second pool created\n");
+		failed = 1;
+	}
+
+	set_chunk(CHUNK);
+	queue_callbacks(&invoked, NR_SLOW, slow_item_free);
+	wait_invoked(&invoked, NR_SLOW);
+	printf("%d slow callbacks invoked by %d pool threads\n",
+	       NR_SLOW, nr_seen);
+	if (nr_seen < 2) {
+		printf("FAIL: chunks not shared between pool threads\n");
+		failed = 1;
+	}
+
+	queue_callbacks(&invoked, NR_BARRIER, item_free);
+	rcu_barrier();
+	if (uatomic_read(&invoked) != NR_SLOW + NR_BARRIER) {
+		printf("FAIL: rcu_barrier() returned before the pool invoked all callbacks\n");
+		failed = 1;
+	}
+
+	/* Leftover callbacks move to the default call_rcu thread. */
+	queue_callbacks(&invoked, NR_BARRIER, item_free);
+	free_pool();
+	ret = create_all_cpu_call_rcu_data_pool(0, 0);
+	if (ret) {
+		printf("FAIL: pool re-creation returned %d\n", ret);
+		failed = 1;
+	}
+	queue_callbacks(&invoked, NR_BARRIER, item_free);
+	wait_invoked(&invoked, NR_SLOW + 3 * NR_BARRIER);
+
+	/*
+	 * Free the queues while callbacks are ready to be invoked and
+	 * rcu_barrier() waits for them, its markers queued behind.
+	 */
+	set_chunk(CHUNK);
+	queue_callbacks(&invoked, NR_SLOW, slow_item_free);
+	wait_invoked(&invoked, NR_SLOW + 3 * NR_BARRIER + CHUNK);
+	ret = pthread_create(&tid, NULL, thr_barrier, &invoked);
+	if (ret) {
+		perror("pthread_create");
+		return 1;
+	}
+	while (!uatomic_read(&barrier_started))
+		caa_cpu_relax();
+	free_pool();
+	rcu_thread_offline();
+	ret = pthread_join(tid, NULL);
+	rcu_thread_online();
+	if (ret) {
+		perror("pthread_join");
+		return 1;
+	}
+	if (barrier_invoked != 2 * NR_SLOW + 3 * NR_BARRIER) {
+		printf("FAIL: rcu_barrier() returned after %lu of %d callbacks, racing with the pool teardown\n",
+		       barrier_invoked, 2 * NR_SLOW + 3 * NR_BARRIER);
+		failed = 1;
+	}
+
+	rcu_unregister_thread();
+	if (failed)
+		return 1;
+	printf("OK\n");
+	return 0;
+}
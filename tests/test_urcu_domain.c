@@ -0,0 +1,252 @@
+/*
+ * test_urcu_domain.c
+ *
+ * Userspace RCU library - RCU domain isolation benchmark
+ *
+ * Reader threads stay in long read-side critical sections of a "slow"
+ * domain, and in short ones of a "fast" domain. Measures the latency of
+ * grace periods of both domains, checks that callbacks queued on the
+ * fast domain are invoked, and uses a hash table created against the
+ * fast domain's flavor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+#include <poll.h>
+#include <time.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/rculfhash.h>
+
+#define DEFAULT_NR_GP		100
+#define DEFAULT_READ_DELAY	1000	/* us */
+#define NR_CALLBACKS		1000
+#define NR_HT_NODES		100
+
+struct test_node {
+	struct cds_lfht_node node;
+	unsigned long key;
+	struct rcu_head head;
+};
+
+static struct rcu_domain *slow_domain, *fast_domain;
+
+DEFINE_RCU_DOMAIN_FLAVOR(fast_flavor, fast_domain);
+
+static volatile int test_go, test_stop;
+
+static int num_read;
+static unsigned long read_delay = DEFAULT_READ_DELAY;
+static unsigned long nr_callbacks;
+
+static void busy_wait_us(unsigned long us)
+{
+	struct timespec ts, now;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	do {
+		caa_cpu_relax();
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	} while ((now.tv_sec - ts.tv_sec) * 1000000
+			+ (now.tv_nsec - ts.tv_nsec) / 1000 < (long) us);
+}
+
+static void *thr_reader(void *arg)
+{
+	rcu_domain_register_thread(slow_domain);
+	rcu_domain_register_thread(fast_domain);
+
+	while (!test_go)
+		caa_cpu_relax();
+
+	while (!test_stop) {
+		rcu_domain_read_lock(slow_domain);
+		busy_wait_us(read_delay);
+		rcu_domain_read_unlock(slow_domain);
+
+		rcu_domain_read_lock(fast_domain);
+		assert(rcu_domain_read_ongoing(fast_domain));
+		rcu_domain_read_unlock(fast_domain);
+	}
+
+	rcu_domain_unregister_thread(fast_domain);
+	rcu_domain_unregister_thread(slow_domain);
+	return NULL;
+}
+
+static void measure(const char *name, struct rcu_domain *domain, int nr_gp)
+{
+	cycles_t time1, time2, delta;
+	cycles_t tot_time = 0, max_time = 0;
+	int i;
+
+	for (i = 0; i < nr_gp; i++) {
+		time1 = caa_get_cycles();
+		rcu_domain_synchronize(domain);
+		time2 = caa_get_cycles();
+		delta = time2 - time1;
+		tot_time += delta;
+		if (delta > max_time)
+			max_time = delta;
+	}
+	printf("%-24s: %12g cycles avg, %12llu cycles max\n",
+	       name, (double) tot_time / nr_gp,
+	       (unsigned long long) max_time);
+}
+
+static void count_callback(struct rcu_head *head)
+{
+	uatomic_inc(&nr_callbacks);
+	free(head);
+}
+
+static void test_call_rcu(void)
+{
+	struct rcu_head *head;
+	unsigned long cookie;
+	int i;
+
+	for (i = 0; i < NR_CALLBACKS; i++) {
+		head = malloc(sizeof(*head));
+		rcu_domain_call_rcu(fast_domain, head, count_callback);
+	}
+	cookie = rcu_domain_start_poll_synchronize(fast_domain);
+	while (!rcu_domain_poll_state_synchronize(fast_domain, cookie))
+		(void) poll(NULL, 0, 1);
+	while (uatomic_read(&nr_callbacks) != NR_CALLBACKS)
+		(void) poll(NULL, 0, 1);
+	printf("%d callbacks invoked\n", NR_CALLBACKS);
+}
+
+static int test_match(struct cds_lfht_node *node, const void *key)
+{
+	return caa_container_of(node, struct test_node, node)->key
+		== *(const unsigned long *) key;
+}
+
+static void free_node(struct rcu_head *head)
+{
+	free(caa_container_of(head, struct test_node, head));
+}
+
+static void test_hash_table(void)
+{
+	struct cds_lfht *ht;
+	struct cds_lfht_iter iter;
+	struct cds_lfht_node *node;
+	struct test_node *tn;
+	unsigned long key;
+	int ret;
+
+	ht = _cds_lfht_new(1, 1, 0, CDS_LFHT_AUTO_RESIZE, NULL,
+			&fast_flavor, NULL);
+	assert(ht);
+
+	fast_flavor.register_thread();
+	for (key = 0; key < NR_HT_NODES; key++) {
+		tn = malloc(sizeof(*tn));
+		cds_lfht_node_init(&tn->node);
+		tn->key = key;
+		fast_flavor.read_lock();
+		cds_lfht_add(ht, key, &tn->node);
+		fast_flavor.read_unlock();
+	}
+	for (key = 0; key < NR_HT_NODES; key++) {
+		fast_flavor.read_lock();
+		cds_lfht_lookup(ht, key, test_match, &key, &iter);
+		node = cds_lfht_iter_get_node(&iter);
+		assert(node);
+		ret = cds_lfht_del(ht, node);
+		assert(!ret);
+		fast_flavor.read_unlock();
+		tn = caa_container_of(node, struct test_node, node);
+		fast_flavor.update_call_rcu(&tn->head, free_node);
+	}
+	fast_flavor.unregister_thread();
+
+	ret = cds_lfht_destroy(ht, NULL);
+	assert(!ret);
+	printf("hash table of %d nodes in the fast domain\n", NR_HT_NODES);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t *tid_reader;
+	void *tret;
+	int i, err, nr_gp = DEFAULT_NR_GP;
+
+	if (argc < 2) {
+		printf("Usage : %s nr_readers [nr_grace_periods] "
+		       "[read_delay_us]\n", argv[0]);
+		exit(-1);
+	}
+	num_read = atoi(argv[1]);
+	if (argc > 2)
+		nr_gp = atoi(argv[2]);
+	if (argc > 3)
+		read_delay = atol(argv[3]);
+	if (num_read < 0 || nr_gp <= 0) {
+		printf("Invalid arguments\n");
+		exit(-1);
+	}
+
+	slow_domain = rcu_domain_create();
+	fast_domain = rcu_domain_create();
+	if (!slow_domain || !fast_domain) {
+		perror("rcu_domain_create");
+		exit(1);
+	}
+
+	tid_reader = malloc(sizeof(*tid_reader) * num_read);
+
+	for (i = 0; i < num_read; i++) {
+		err = pthread_create(&tid_reader[i], NULL, thr_reader, NULL);
+		if (err != 0)
+			exit(1);
+	}
+
+	test_go = 1;
+	/* Let the readers start. */
+	sleep(1);
+
+	printf("%d readers, %d grace periods, %lu us slow read-side "
+	       "critical sections\n", num_read, nr_gp, read_delay);
+	measure("slow domain", slow_domain, nr_gp);
+	measure("fast domain", fast_domain, nr_gp);
+	test_call_rcu();
+	test_hash_table();
+
+	test_stop = 1;
+
+	for (i = 0; i < num_read; i++) {
+		err = pthread_join(tid_reader[i], &tret);
+		if (err != 0)
+			exit(1);
+	}
+	free(tid_reader);
+
+	rcu_domain_destroy(fast_domain);
+	rcu_domain_destroy(slow_domain);
+
+	return 0;
+}
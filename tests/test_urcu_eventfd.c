@@ -0,0 +1,274 @@
+/*
+ * test_urcu_eventfd.c
+ *
+ * Userspace RCU library - grace period notification through eventfd
+ *
+ * An epoll loop arms grace period notifications on an eventfd with
+ * rcu_gp_notify_eventfd() and waits for them along with a timer, while
+ * updater threads call synchronize_rcu() and a poller thread calls
+ * start_poll_synchronize_rcu() concurrently. Checks that no
+ * notification arrives while a reader is stalled in a read-side critical
+ * section, and that each armed notification eventually arrives. Also arms
+ * notifications while the poll worker starts grace periods of its own for
+ * start_poll_synchronize_rcu(), checking that both complete.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_QSBR
+#include <urcu-qsbr.h>
+#elif defined(RCU_BP)
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+
+#define DEFAULT_NR_UPDATERS	2
+#define DEFAULT_NR_NOTIFY	10000
+#define STALL_DELAY		200	/* ms */
+#define NR_POLL_RACES		1000
+
+static volatile int test_stop, reader_in_cs;
+static unsigned long nr_polls;
+static int poll_failed;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *thr_stalled_reader(void *arg)
+{
+	rcu_register_thread();
+	rcu_read_lock();
+	uatomic_set(&reader_in_cs, 1);
+	poll(NULL, 0, STALL_DELAY);
+	rcu_read_unlock();
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void *thr_updater(void *arg)
+{
+	while (!test_stop)
+		synchronize_rcu();
+	return NULL;
+}
+
+/*
+ * Have the poll worker run grace periods of its own while updaters lead
+ * theirs and notifications are armed.
+ */
+static void *thr_poller(void *arg)
+{
+	unsigned long cookie;
+	int i;
+
+	while (!test_stop) {
+		cookie = start_poll_synchronize_rcu();
+		for (i = 0; !poll_state_synchronize_rcu(cookie); i++) {
+			if (i == 1000) {
+				fprintf(stderr, "Polled grace period not completed within 1 s\n");
+				uatomic_set(&poll_failed, 1);
+				return NULL;
+			}
+			poll(NULL, 0, 1);
+		}
+		nr_polls++;
+	}
+	return NULL;
+}
+
+static void arm(int fd)
+{
+	if (rcu_gp_notify_eventfd(fd)) {
+		fprintf(stderr, "rcu_gp_notify_eventfd failed\n");
+		exit(1);
+	}
+}
+
+/* Wait for up to "timeout_ms", returns the eventfd counter read. */
+static uint64_t wait_notify(int epfd, int fd, int timeout_ms)
+{
+	struct epoll_event ev;
+	uint64_t count;
+	int ret;
+
+	ret = epoll_wait(epfd, &ev, 1, timeout_ms);
+	if (ret < 0) {
+		perror("epoll_wait");
+		exit(1);
+	}
+	if (!ret)
+		return 0;
+	if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+		perror("read");
+		exit(1);
+	}
+	return count;
+}
+
+/*
+ * Arm a notification right after asking the poll worker for a grace
+ * period, so that it may be queued while the worker starts leading one.
+ */
+static int test_poll_race(int epfd, int fd)
+{
+	unsigned long cookie;
+	int i, j;
+
+	for (i = 0; i < NR_POLL_RACES; i++) {
+		cookie = start_poll_synchronize_rcu();
+		arm(fd);
+		if (wait_notify(epfd, fd, 1000) != 1) {
+			fprintf(stderr, "No notification within 1 s racing with the poll worker\n");
+			return -1;
+		}
+		for (j = 0; !poll_state_synchronize_rcu(cookie); j++) {
+			if (j == 1000) {
+				fprintf(stderr, "Polled grace period not completed within 1 s\n");
+				return -1;
+			}
+			poll(NULL, 0, 1);
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct epoll_event ev = { .events = EPOLLIN };
+	int nr_updaters = DEFAULT_NR_UPDATERS;
+	unsigned long nr_notify = DEFAULT_NR_NOTIFY;
+	unsigned long long start, latency = 0;
+	uint64_t armed, received, count;
+	pthread_t *tid, stalled_tid, poller_tid;
+	int epfd, fd, err, i;
+
+	if (argc > 1)
+		nr_updaters = atoi(argv[1]);
+	if (argc > 2)
+		nr_notify = atol(argv[2]);
+	if (nr_updaters < 0 || nr_notify < 1) {
+		printf("Usage : %s [nr_updaters] [nr_notify]\n", argv[0]);
+		exit(-1);
+	}
+
+	fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (fd < 0 || epfd < 0) {
+		perror("eventfd/epoll");
+		exit(1);
+	}
+	ev.data.fd = fd;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev)) {
+		perror("epoll_ctl");
+		exit(1);
+	}
+
+	/* No notification while a reader is stalled. */
+	err = pthread_create(&stalled_tid, NULL, thr_stalled_reader, NULL);
+	if (err != 0)
+		exit(1);
+	while (!uatomic_read(&reader_in_cs))
+		poll(NULL, 0, 1);
+	arm(fd);
+	if (wait_notify(epfd, fd, STALL_DELAY / 4)) {
+		fprintf(stderr, "Notified while a reader is stalled\n");
+		return 1;
+	}
+	count = wait_notify(epfd, fd, 10 * STALL_DELAY);
+	if (count != 1) {
+		fprintf(stderr, "Not notified after the reader ended\n");
+		return 1;
+	}
+	err = pthread_join(stalled_tid, NULL);
+	if (err != 0)
+		exit(1);
+
+	/* Notifications racing with the poll worker's grace periods. */
+	if (test_poll_race(epfd, fd))
+		return 1;
+
+	/*
+	 * Event loop, with concurrent synchronize_rcu() and
+	 * start_poll_synchronize_rcu() callers.
+	 */
+	tid = malloc(sizeof(*tid) * nr_updaters);
+	for (i = 0; i < nr_updaters; i++) {
+		err = pthread_create(&tid[i], NULL, thr_updater, NULL);
+		if (err != 0)
+			exit(1);
+	}
+	err = pthread_create(&poller_tid, NULL, thr_poller, NULL);
+	if (err != 0)
+		exit(1);
+	armed = received = 0;
+	while (received < nr_notify) {
+		if (armed < nr_notify) {
+			start = now_ns();
+			arm(fd);
+			armed++;
+		}
+		count = wait_notify(epfd, fd, 1000);
+		if (!count) {
+			fprintf(stderr, "No notification within 1 s\n");
+			return 1;
+		}
+		latency += now_ns() - start;
+		received += count;
+	}
+	test_stop = 1;
+	for (i = 0; i < nr_updaters; i++) {
+		err = pthread_join(tid[i], NULL);
+		if (err != 0)
+			exit(1);
+	}
+	free(tid);
+	err = pthread_join(poller_tid, NULL);
+	if (err != 0)
+		exit(1);
+
+	printf("%llu notifications, %d updaters, %lu polled grace periods, avg latency %llu us\n",
+	       (unsigned long long) received, nr_updaters, nr_polls,
+	       latency / nr_notify / 1000);
+	if (poll_failed)
+		return 1;
+	if (received != armed) {
+		fprintf(stderr, "%llu notifications for %llu armed\n",
+			(unsigned long long) received,
+			(unsigned long long) armed);
+		return 1;
+	}
+	close(epfd);
+	close(fd);
+	return 0;
+}
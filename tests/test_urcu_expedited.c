@@ -0,0 +1,224 @@
+/*
+ * test_urcu_expedited.c
+ *
+ * Userspace RCU library - synchronize_rcu_expedited() latency benchmark
+ *
+ * Compares the latency of synchronize_rcu() and
+ * synchronize_rcu_expedited() while reader threads continuously enter
+ * and exit read-side critical sections. Then stresses the grace period
+ * wait queue with updater threads calling both concurrently.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+#include <urcu/arch.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_QSBR
+#include <urcu-qsbr.h>
+#elif defined(RCU_BP)
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+
+#define DEFAULT_NR_GP		1000
+#define DEFAULT_NR_MIXED	4
+
+struct test_array {
+	int a;
+};
+
+static struct test_array *test_rcu_pointer;
+
+static volatile int test_go, test_stop;
+
+static int num_read, nr_gp = DEFAULT_NR_GP;
+
+static void *thr_reader(void *arg)
+{
+	struct test_array *local_ptr;
+
+	rcu_register_thread();
+
+	while (!test_go)
+		caa_cpu_relax();
+
+	while (!test_stop) {
+		rcu_read_lock();
+		local_ptr = rcu_dereference(test_rcu_pointer);
+		if (local_ptr)
+			assert(local_ptr->a == 8);
+		rcu_read_unlock();
+#ifdef RCU_QSBR
+		rcu_quiescent_state();
+#endif
+	}
+
+	rcu_unregister_thread();
+	return NULL;
+}
+
+/*
+ * Replace the shared pointer nr_gp times, waiting for a grace period
+ * with "sync" before each free, and report the grace period latency.
+ */
+static void measure(const char *name, void (*sync)(void), int nr_gp)
+{
+	struct test_array *new, *old;
+	cycles_t time1, time2, delta;
+	cycles_t tot_time = 0, max_time = 0;
+	int i;
+
+	for (i = 0; i < nr_gp; i++) {
+		new = malloc(sizeof(*new));
+		new->a = 8;
+		old = rcu_xchg_pointer(&test_rcu_pointer, new);
+		time1 = caa_get_cycles();
+		sync();
+		time2 = caa_get_cycles();
+		if (old)
+			old->a = 0;
+		free(old);
+		delta = time2 - time1;
+		tot_time += delta;
+		if (delta > max_time)
+			max_time = delta;
+	}
+	printf("%-26s: %12g cycles avg, %12llu cycles max\n",
+	       name, (double) tot_time / nr_gp,
+	       (unsigned long long) max_time);
+}
+
+static void do_synchronize_rcu(void)
+{
+	synchronize_rcu();
+}
+
+static void do_synchronize_rcu_expedited(void)
+{
+	synchronize_rcu_expedited();
+}
+
+/*
+ * Mixed updater: replace the shared pointer nr_gp times, waiting with
+ * synchronize_rcu() or synchronize_rcu_expedited() in turn, so that
+ * expedited grace periods run while other updaters are queued for, or
+ * leading, normal ones.
+ */
+static void *thr_mixed(void *arg)
+{
+	struct test_array *new, *old;
+	long id = (long) arg;
+	int i;
+
+	for (i = 0; i < nr_gp; i++) {
+		new = malloc(sizeof(*new));
+		new->a = 8;
+		old = rcu_xchg_pointer(&test_rcu_pointer, new);
+		if ((i + id) % 3 == 0)
+			synchronize_rcu_expedited();
+		else
+			synchronize_rcu();
+		if (old)
+			old->a = 0;
+		free(old);
+	}
+	return NULL;
+}
+
+static void mixed(int nr_mixed)
+{
+	pthread_t *tid_mixed;
+	cycles_t time1, time2;
+	long i;
+	int err;
+
+	tid_mixed = malloc(sizeof(*tid_mixed) * nr_mixed);
+	time1 = caa_get_cycles();
+	for (i = 0; i < nr_mixed; i++) {
+		err = pthread_create(&tid_mixed[i], NULL, thr_mixed,
+				(void *) i);
+		if (err != 0)
+			exit(1);
+	}
+	for (i = 0; i < nr_mixed; i++) {
+		err = pthread_join(tid_mixed[i], NULL);
+		if (err != 0)
+			exit(1);
+	}
+	time2 = caa_get_cycles();
+	printf("%-26s: %12g cycles avg, %d updaters\n", "mixed",
+	       (double) (time2 - time1) / nr_gp, nr_mixed);
+	free(tid_mixed);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t *tid_reader;
+	void *tret;
+	int i, err, nr_mixed = DEFAULT_NR_MIXED;
+
+	if (argc < 2) {
+		printf("Usage : %s nr_readers [nr_grace_periods] [nr_mixed_updaters]\n",
+		       argv[0]);
+		exit(-1);
+	}
+	num_read = atoi(argv[1]);
+	if (argc > 2)
+		nr_gp = atoi(argv[2]);
+	if (argc > 3)
+		nr_mixed = atoi(argv[3]);
+	if (num_read < 0 || nr_gp <= 0 || nr_mixed < 0) {
+		printf("Invalid arguments\n");
+		exit(-1);
+	}
+
+	tid_reader = malloc(sizeof(*tid_reader) * num_read);
+
+	for (i = 0; i < num_read; i++) {
+		err = pthread_create(&tid_reader[i], NULL, thr_reader, NULL);
+		if (err != 0)
+			exit(1);
+	}
+
+	test_go = 1;
+	/* Let the readers start. */
+	sleep(1);
+
+	printf("%d readers, %d grace periods\n", num_read, nr_gp);
+	measure("synchronize_rcu", do_synchronize_rcu, nr_gp);
+	measure("synchronize_rcu_expedited", do_synchronize_rcu_expedited,
+		nr_gp);
+	if (nr_mixed)
+		mixed(nr_mixed);
+
+	test_stop = 1;
+
+	for (i = 0; i < num_read; i++) {
+		err = pthread_join(tid_reader[i], &tret);
+		if (err != 0)
+			exit(1);
+	}
+	free(test_rcu_pointer);
+	free(tid_reader);
+
+	return 0;
+}
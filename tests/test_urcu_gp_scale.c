@@ -0,0 +1,178 @@
+/*
+ * test_urcu_gp_scale.c
+ *
+ * Userspace RCU library - grace period scalability benchmark
+ *
+ * Measures the synchronize_rcu() latency as the number of registered
+ * reader threads doubles, up to thousands of threads. Readers stay
+ * registered but idle, so the measurement is dominated by the cost of
+ * scanning the reader registry.
+ *
+ * When "cpus_per_group" is given, hierarchical grace period detection is
+ * enabled with that group size (0: per NUMA node), and readers are bound
+ * to CPUs in a round-robin fashion so they can be grouped.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#define _GNU_SOURCE
+#include "../config.h"
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sched.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_QSBR
+#include <urcu-qsbr.h>
+#elif defined(RCU_BP)
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+
+#define DEFAULT_MAX_READERS	4096
+#define DEFAULT_NR_GP		200
+#define READER_STACK_SIZE	(64 * 1024)
+
+static pthread_mutex_t stop_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stop_cond = PTHREAD_COND_INITIALIZER;
+static int test_stop;
+
+static unsigned long nr_registered;
+static int use_affinity;
+static long nr_cpus;
+
+static void set_affinity(unsigned long cpu)
+{
+#if HAVE_SCHED_SETAFFINITY
+	cpu_set_t mask;
+
+	if (!use_affinity)
+		return;
+	CPU_ZERO(&mask);
+	CPU_SET(cpu % nr_cpus, &mask);
+#if SCHED_SETAFFINITY_ARGS == 2
+	sched_setaffinity(0, &mask);
+#else
+	sched_setaffinity(0, sizeof(mask), &mask);
+#endif
+#endif /* HAVE_SCHED_SETAFFINITY */
+}
+
+static void *thr_reader(void *arg)
+{
+	set_affinity((unsigned long) arg);
+	rcu_register_thread();
+	/* rcu-bp registers on first read-side critical section. */
+	rcu_read_lock();
+	rcu_read_unlock();
+	/* Don't hold back QSBR grace periods while sleeping. */
+	rcu_thread_offline();
+	uatomic_inc(&nr_registered);
+
+	pthread_mutex_lock(&stop_mutex);
+	while (!test_stop)
+		pthread_cond_wait(&stop_cond, &stop_mutex);
+	pthread_mutex_unlock(&stop_mutex);
+
+	rcu_thread_online();
+	rcu_unregister_thread();
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t *tid_reader;
+	pthread_attr_t attr;
+	cycles_t time1, time2;
+	unsigned long max_readers = DEFAULT_MAX_READERS;
+	unsigned long nr, target;
+	int i, err, nr_gp = DEFAULT_NR_GP;
+
+	if (argc > 1)
+		max_readers = atol(argv[1]);
+	if (argc > 2)
+		nr_gp = atoi(argv[2]);
+	if (max_readers < 1 || nr_gp <= 0) {
+		printf("Usage : %s [max_readers] [nr_grace_periods] "
+		       "[cpus_per_group]\n", argv[0]);
+		exit(-1);
+	}
+	if (argc > 3) {
+		err = rcu_enable_hierarchical_gp(atoi(argv[3]));
+		if (err) {
+			printf("Unable to enable hierarchical grace periods: "
+			       "%d\n", err);
+			exit(1);
+		}
+		nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		if (nr_cpus <= 0)
+			nr_cpus = 1;
+		use_affinity = 1;
+		printf("Hierarchical grace periods, %s\n",
+		       atoi(argv[3]) ? "CPU groups" : "NUMA nodes");
+	}
+
+	tid_reader = malloc(sizeof(*tid_reader) * max_readers);
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, READER_STACK_SIZE);
+
+	printf("%10s %16s\n", "readers", "cycles/gp");
+	nr = 0;
+	for (target = 1; ; target <<= 1) {
+		if (target > max_readers)
+			target = max_readers;
+		for (; nr < target; nr++) {
+			err = pthread_create(&tid_reader[nr], &attr,
+					     thr_reader, (void *) nr);
+			if (err != 0) {
+				printf("Unable to create thread %lu\n", nr);
+				exit(1);
+			}
+		}
+		while (uatomic_read(&nr_registered) < nr)
+			usleep(1000);
+
+		/* Populate the reader scan structures first. */
+		synchronize_rcu();
+		time1 = caa_get_cycles();
+		for (i = 0; i < nr_gp; i++)
+			synchronize_rcu();
+		time2 = caa_get_cycles();
+		printf("%10lu %16g\n", nr,
+		       (double) (time2 - time1) / nr_gp);
+		if (target == max_readers)
+			break;
+	}
+
+	pthread_mutex_lock(&stop_mutex);
+	test_stop = 1;
+	pthread_cond_broadcast(&stop_cond);
+	pthread_mutex_unlock(&stop_mutex);
+
+	for (nr = 0; nr < max_readers; nr++) {
+		err = pthread_join(tid_reader[nr], NULL);
+		if (err != 0)
+			exit(1);
+	}
+	pthread_attr_destroy(&attr);
+	free(tid_reader);
+
+	return 0;
+}
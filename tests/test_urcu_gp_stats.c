@@ -0,0 +1,181 @@
+/*
+ * test_urcu_gp_stats.c
+ *
+ * Userspace RCU library - grace period statistics
+ *
+ * Readers run read-side critical sections of configurable length while
+ * updaters call synchronize_rcu() in a loop, with grace period statistics
+ * enabled. Prints the statistics collected by rcu_gp_stats_get(), and
+ * checks that grace periods are no longer accounted for once disabled.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <urcu/arch.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_QSBR
+#include <urcu-qsbr.h>
+#elif defined(RCU_BP)
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+
+#define DEFAULT_NR_READERS	4
+#define DEFAULT_NR_WRITERS	2
+#define DEFAULT_DURATION	2	/* s */
+#define DEFAULT_READ_DELAY	100	/* us */
+
+static volatile int test_stop;
+
+static unsigned long read_delay = DEFAULT_READ_DELAY;
+
+static void busy_wait_us(unsigned long us)
+{
+	struct timespec ts, now;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	do {
+		caa_cpu_relax();
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	} while ((now.tv_sec - ts.tv_sec) * 1000000
+			+ (now.tv_nsec - ts.tv_nsec) / 1000 < (long) us);
+}
+
+static void *thr_reader(void *arg)
+{
+	rcu_register_thread();
+	while (!test_stop) {
+		rcu_read_lock();
+		busy_wait_us(read_delay);
+		rcu_read_unlock();
+#ifdef RCU_QSBR
+		rcu_quiescent_state();
+#endif
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void *thr_writer(void *arg)
+{
+	while (!test_stop)
+		synchronize_rcu();
+	return NULL;
+}
+
+static void print_hist(const char *name, struct rcu_gp_stats_hist *hist)
+{
+	int i;
+
+	if (!hist->count)
+		return;
+	printf("%s: count %llu, avg %g, max %llu\n", name,
+	       (unsigned long long) hist->count,
+	       (double) hist->sum / hist->count,
+	       (unsigned long long) hist->max);
+	for (i = 0; i < RCU_GP_STATS_HIST_BUCKETS; i++) {
+		if (!hist->bucket[i])
+			continue;
+		printf("  [%20llu, ...) %llu\n", i ? 1ULL << i : 0ULL,
+		       (unsigned long long) hist->bucket[i]);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t *tid;
+	struct rcu_gp_stats stats;
+	int nr_readers = DEFAULT_NR_READERS, nr_writers = DEFAULT_NR_WRITERS;
+	unsigned long duration = DEFAULT_DURATION;
+	uint64_t nr_gp;
+	int err, i;
+
+	if (argc > 1)
+		nr_readers = atoi(argv[1]);
+	if (argc > 2)
+		nr_writers = atoi(argv[2]);
+	if (argc > 3)
+		duration = atol(argv[3]);
+	if (argc > 4)
+		read_delay = atol(argv[4]);
+	if (nr_readers < 0 || nr_writers < 1) {
+		printf("Usage : %s [nr_readers] [nr_writers] [duration_s] "
+		       "[read_delay_us]\n", argv[0]);
+		exit(-1);
+	}
+
+	tid = malloc(sizeof(*tid) * (nr_readers + nr_writers));
+
+	rcu_gp_stats_enable(1);
+	for (i = 0; i < nr_readers + nr_writers; i++) {
+		err = pthread_create(&tid[i], NULL,
+				     i < nr_readers ? thr_reader : thr_writer,
+				     NULL);
+		if (err != 0)
+			exit(1);
+	}
+
+	sleep(duration);
+
+	test_stop = 1;
+	for (i = 0; i < nr_readers + nr_writers; i++) {
+		err = pthread_join(tid[i], NULL);
+		if (err != 0)
+			exit(1);
+	}
+	free(tid);
+
+	rcu_gp_stats_get(&stats);
+	printf("%d readers, %d writers, %lu us read-side critical sections\n",
+	       nr_readers, nr_writers, read_delay);
+	printf("%llu grace periods, %llu spins, %llu sleeps\n",
+	       (unsigned long long) stats.nr_gp,
+	       (unsigned long long) stats.nr_spins,
+	       (unsigned long long) stats.nr_sleeps);
+	print_hist("grace period (ns)", &stats.gp_time);
+	print_hist("first wait for readers (ns)", &stats.phase_time[0]);
+	print_hist("second wait for readers (ns)", &stats.phase_time[1]);
+	print_hist("callers per grace period", &stats.batch);
+	print_hist("readers scanned per grace period", &stats.readers);
+
+	if (!stats.nr_gp || stats.gp_time.count != stats.nr_gp) {
+		fprintf(stderr, "No grace period accounted for\n");
+		return 1;
+	}
+
+	/* Disabled statistics must not change. */
+	rcu_gp_stats_enable(0);
+	nr_gp = stats.nr_gp;
+	synchronize_rcu();
+	rcu_gp_stats_get(&stats);
+	if (stats.nr_gp != nr_gp) {
+		fprintf(stderr, "Grace period accounted for while disabled\n");
+		return 1;
+	}
+	rcu_gp_stats_reset();
+	rcu_gp_stats_get(&stats);
+	if (stats.nr_gp || stats.batch.count) {
+		fprintf(stderr, "Statistics not reset\n");
+		return 1;
+	}
+	return 0;
+}
@@ -30,10 +30,23 @@
 
 int test_mf_signal(void)
 {
+	unsigned long cookie;
+
 	rcu_register_thread();
 	rcu_read_lock();
 	rcu_read_unlock();
+	cookie = get_state_synchronize_rcu();
 	synchronize_rcu();
+	if (!poll_state_synchronize_rcu(cookie))
+		goto error;
+	cookie = start_poll_synchronize_rcu();
+	cond_synchronize_rcu(cookie);
+	if (!poll_state_synchronize_rcu(cookie))
+		goto error;
 	rcu_unregister_thread();
 	return 0;
+
+error:
+	rcu_unregister_thread();
+	return -1;
 }
@@ -0,0 +1,119 @@
+/*
+ * test_urcu_qsbr_preload.c
+ *
+ * Userspace RCU library - liburcu-qsbr-preload test
+ *
+ * QSBR readers block in poll() and read() while online, without calling
+ * rcu_thread_offline(). Linked with liburcu-qsbr-preload, grace periods
+ * must not wait for them to wake up.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <urcu/arch.h>
+
+#include <urcu-qsbr.h>
+
+#define NR_GP			20
+#define POLL_DELAY_MS		100
+#define MAX_LATENCY_MS		(POLL_DELAY_MS / 2)
+
+static volatile int test_stop;
+static int pipefd[2];
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *thr_poll_reader(void *arg)
+{
+	rcu_register_thread();
+	while (!test_stop) {
+		rcu_read_lock();
+		rcu_read_unlock();
+		rcu_quiescent_state();
+		(void) poll(NULL, 0, POLL_DELAY_MS);
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void *thr_read_reader(void *arg)
+{
+	char c;
+
+	rcu_register_thread();
+	rcu_quiescent_state();
+	/* Blocks until the end of the test. */
+	if (read(pipefd[0], &c, 1) != 1)
+		abort();
+	rcu_unregister_thread();
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t tid[2];
+	unsigned long long start, delta, max = 0, total = 0;
+	int i, err;
+
+	if (pipe(pipefd))
+		return 1;
+	err = pthread_create(&tid[0], NULL, thr_poll_reader, NULL);
+	if (err)
+		return 1;
+	err = pthread_create(&tid[1], NULL, thr_read_reader, NULL);
+	if (err)
+		return 1;
+	/* Let the readers block. */
+	(void) poll(NULL, 0, POLL_DELAY_MS / 2);
+
+	for (i = 0; i < NR_GP; i++) {
+		start = now_ns();
+		synchronize_rcu();
+		delta = now_ns() - start;
+		total += delta;
+		if (delta > max)
+			max = delta;
+	}
+
+	test_stop = 1;
+	if (write(pipefd[1], "", 1) != 1)
+		return 1;
+	for (i = 0; i < 2; i++) {
+		err = pthread_join(tid[i], NULL);
+		if (err)
+			return 1;
+	}
+
+	printf("%d grace periods, avg %llu us, max %llu us\n", NR_GP,
+	       total / NR_GP / 1000, max / 1000);
+	if (max >= MAX_LATENCY_MS * 1000000ULL) {
+		printf("FAIL: grace periods waited for blocked readers\n");
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
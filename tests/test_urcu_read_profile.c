@@ -0,0 +1,154 @@
+/*
+ * test_urcu_read_profile.c
+ *
+ * Userspace RCU library - read-side critical section profiler test
+ *
+ * One reader thread runs short read-side critical sections, another long
+ * ones, with nested sections within them. Checks that the profile has
+ * one entry per thread function, the long one first, and about one
+ * sample per "period" outermost sections.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <urcu/arch.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_BP
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+
+#define NR_SECTIONS		100000
+#define PERIOD			16
+#define SHORT_LOOPS		10
+#define LONG_LOOPS		200
+
+static void read_section(unsigned long loops)
+{
+	unsigned long i;
+
+	rcu_read_lock();
+	for (i = 0; i < loops; i++)
+		caa_cpu_relax();
+	/* Nested sections are not sampled on their own. */
+	rcu_read_lock();
+	rcu_read_unlock();
+	rcu_read_unlock();
+}
+
+/*
+ * rcu_read_lock() is inlined: the caller recorded is the return address
+ * of these functions, in thr_reader().
+ */
+static void __attribute__((noinline)) short_section(void)
+{
+	read_section(SHORT_LOOPS);
+}
+
+static void __attribute__((noinline)) long_section(void)
+{
+	read_section(LONG_LOOPS);
+}
+
+static void *thr_reader(void *arg)
+{
+	int i, is_long = (int) (long) arg;
+
+	rcu_register_thread();
+	for (i = 0; i < NR_SECTIONS; i++) {
+		if (is_long)
+			long_section();
+		else
+			short_section();
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void run(void)
+{
+	pthread_t tid[2];
+	int i;
+
+	if (pthread_create(&tid[0], NULL, thr_reader, (void *) 0L)
+			|| pthread_create(&tid[1], NULL, thr_reader, (void *) 1L))
+		exit(1);
+	for (i = 0; i < 2; i++) {
+		if (pthread_join(tid[i], NULL))
+			exit(1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct rcu_read_profile_entry entry[8];
+	unsigned long long min, max;
+	int nr, i;
+
+	if (rcu_read_profile_enable(PERIOD) == -ENOSYS) {
+		printf("not configured with --enable-rcu-read-profile, "
+		       "skipping\n");
+		return 0;
+	}
+	run();
+
+	nr = rcu_read_profile_get(entry, 8);
+	for (i = 0; i < nr && i < 8; i++)
+		printf("caller %p samples %llu avg %llu max %llu cycles\n",
+		       entry[i].caller,
+		       (unsigned long long) entry[i].nr_samples,
+		       (unsigned long long) (entry[i].total_cycles
+			       / entry[i].nr_samples),
+		       (unsigned long long) entry[i].max_cycles);
+	if (nr != 2) {
+		printf("FAIL: expected 2 callers, got %d\n", nr);
+		return 1;
+	}
+	if (entry[0].total_cycles / entry[0].nr_samples
+			<= entry[1].total_cycles / entry[1].nr_samples) {
+		printf("FAIL: long sections not reported first\n");
+		return 1;
+	}
+	min = NR_SECTIONS / PERIOD * 9 / 10;
+	max = NR_SECTIONS / PERIOD * 11 / 10;
+	for (i = 0; i < 2; i++) {
+		if (entry[i].nr_samples < min || entry[i].nr_samples > max) {
+			printf("FAIL: %llu samples, expected about %d\n",
+			       (unsigned long long) entry[i].nr_samples,
+			       NR_SECTIONS / PERIOD);
+			return 1;
+		}
+	}
+
+	rcu_read_profile_reset();
+	if (rcu_read_profile_get(entry, 8) != 0) {
+		printf("FAIL: entries left after reset\n");
+		return 1;
+	}
+	rcu_read_profile_enable(0);
+	run();
+	if (rcu_read_profile_get(entry, 8) != 0) {
+		printf("FAIL: sampled while disabled\n");
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * test_urcu_spin_policy.c
+ *
+ * Userspace RCU library - spin-then-sleep policy benchmark
+ *
+ * Readers run back-to-back read-side critical sections of configurable
+ * length while updaters call synchronize_rcu() in a loop. Runs the same
+ * load with updaters always sleeping, always spinning for a long time,
+ * and with the default adaptive policy, and reports for each the grace
+ * period latency seen by the updaters, the CPU time the updaters burned
+ * per grace period, and the reader throughput left over.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_QSBR
+#include <urcu-qsbr.h>
+#elif defined(RCU_BP)
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+
+#define DEFAULT_NR_READERS	2
+#define DEFAULT_NR_UPDATERS	2
+#define DEFAULT_DURATION	2	/* s */
+#define DEFAULT_READ_DELAY	20	/* us */
+
+struct totals {
+	unsigned long long nr_gp;
+	unsigned long long latency_ns, max_latency_ns;
+	unsigned long long cpu_ns;
+	unsigned long long nr_reads;
+};
+
+static volatile int test_stop;
+
+static unsigned long read_delay = DEFAULT_READ_DELAY;
+static struct totals totals;
+
+static unsigned long long now_ns(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void busy_wait_us(unsigned long us)
+{
+	unsigned long long end;
+
+	end = now_ns(CLOCK_MONOTONIC) + us * 1000ULL;
+	while (now_ns(CLOCK_MONOTONIC) < end)
+		caa_cpu_relax();
+}
+
+static void *thr_reader(void *arg)
+{
+	unsigned long long nr_reads = 0;
+
+	rcu_register_thread();
+	while (!test_stop) {
+		rcu_read_lock();
+		busy_wait_us(read_delay);
+		rcu_read_unlock();
+#ifdef RCU_QSBR
+		rcu_quiescent_state();
+#endif
+		nr_reads++;
+	}
+	rcu_unregister_thread();
+	uatomic_add(&totals.nr_reads, nr_reads);
+	return NULL;
+}
+
+static void *thr_updater(void *arg)
+{
+	unsigned long long nr_gp = 0, latency = 0, max_latency = 0;
+	unsigned long long start, delta, cpu;
+
+	cpu = now_ns(CLOCK_THREAD_CPUTIME_ID);
+	while (!test_stop) {
+		start = now_ns(CLOCK_MONOTONIC);
+		synchronize_rcu();
+		delta = now_ns(CLOCK_MONOTONIC) - start;
+		latency += delta;
+		if (delta > max_latency)
+			max_latency = delta;
+		nr_gp++;
+	}
+	cpu = now_ns(CLOCK_THREAD_CPUTIME_ID) - cpu;
+
+	uatomic_add(&totals.nr_gp, nr_gp);
+	uatomic_add(&totals.latency_ns, latency);
+	uatomic_add(&totals.cpu_ns, cpu);
+	start = uatomic_read(&totals.max_latency_ns);
+	while (max_latency > start) {
+		if (uatomic_cmpxchg(&totals.max_latency_ns, start,
+				max_latency) == start)
+			break;
+		start = uatomic_read(&totals.max_latency_ns);
+	}
+	return NULL;
+}
+
+static void run(const char *name, const struct rcu_spin_policy *policy,
+		int nr_readers, int nr_updaters, unsigned long duration)
+{
+	struct rcu_spin_policy current;
+	pthread_t *tid;
+	int err, i;
+
+	err = rcu_set_spin_policy(policy);
+	if (err) {
+		fprintf(stderr, "rcu_set_spin_policy: %d\n", err);
+		exit(1);
+	}
+	memset(&totals, 0, sizeof(totals));
+	test_stop = 0;
+
+	tid = malloc(sizeof(*tid) * (nr_readers + nr_updaters));
+	for (i = 0; i < nr_readers + nr_updaters; i++) {
+		err = pthread_create(&tid[i], NULL,
+				     i < nr_readers ? thr_reader : thr_updater,
+				     NULL);
+		if (err != 0)
+			exit(1);
+	}
+	sleep(duration);
+	test_stop = 1;
+	for (i = 0; i < nr_readers + nr_updaters; i++) {
+		err = pthread_join(tid[i], NULL);
+		if (err != 0)
+			exit(1);
+	}
+	free(tid);
+
+	rcu_get_spin_policy(&current);
+	printf("%-10s %10llu %12.1f %12.1f %14.1f %12.0f %8lu %8lu\n", name,
+	       totals.nr_gp,
+	       totals.nr_gp ? (double) totals.latency_ns / totals.nr_gp
+			/ 1000 : 0,
+	       (double) totals.max_latency_ns / 1000,
+	       totals.nr_gp ? (double) totals.cpu_ns / totals.nr_gp / 1000 : 0,
+	       (double) totals.nr_reads / duration,
+	       current.gp_spin_ns / 1000, current.waiter_spin_ns / 1000);
+}
+
+int main(int argc, char **argv)
+{
+	struct rcu_spin_policy park = { .min_ns = 0, .max_ns = 0 };
+	struct rcu_spin_policy spin = { .min_ns = 0, .max_ns = 1000000 };
+	struct rcu_spin_policy adaptive;
+	int nr_readers = DEFAULT_NR_READERS, nr_updaters = DEFAULT_NR_UPDATERS;
+	unsigned long duration = DEFAULT_DURATION;
+
+	if (argc > 1)
+		nr_readers = atoi(argv[1]);
+	if (argc > 2)
+		nr_updaters = atoi(argv[2]);
+	if (argc > 3)
+		duration = atol(argv[3]);
+	if (argc > 4)
+		read_delay = atol(argv[4]);
+	if (nr_readers < 0 || nr_updaters < 1 || duration < 1) {
+		printf("Usage : %s [nr_readers] [nr_updaters] [duration_s] "
+		       "[read_delay_us]\n", argv[0]);
+		exit(-1);
+	}
+
+	/* Default policy, as set up by the library. */
+	rcu_get_spin_policy(&adaptive);
+
+	printf("%d readers, %d updaters, %lu us read-side critical sections, "
+	       "%ld CPUs\n", nr_readers, nr_updaters, read_delay,
+	       sysconf(_SC_NPROCESSORS_ONLN));
+	printf("%-10s %10s %12s %12s %14s %12s %8s %8s\n", "policy",
+	       "gp", "avg lat us", "max lat us", "cpu us per gp",
+	       "reads/s", "gp spin", "wt spin");
+	run("park", &park, nr_readers, nr_updaters, duration);
+	run("spin", &spin, nr_readers, nr_updaters, duration);
+	run("adaptive", &adaptive, nr_readers, nr_updaters, duration);
+	return 0;
+}
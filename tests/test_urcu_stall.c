@@ -0,0 +1,168 @@
+/*
+ * test_urcu_stall.c
+ *
+ * Userspace RCU library - reader stall detection test
+ *
+ * A reader stays in a read-side critical section (or, with rcu-qsbr,
+ * online without quiescent state) for a configurable time while the main
+ * thread waits for a grace period. Checks that the stall detector reports
+ * that reader, and only it, about every stall timeout.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_QSBR
+#include <urcu-qsbr.h>
+#elif defined(RCU_BP)
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+
+#define DEFAULT_STALL_TIMEOUT	100	/* ms */
+#define DEFAULT_READ_DELAY	550	/* ms */
+#define NR_IDLE_READERS		4
+
+static volatile int test_stop, reader_in_cs;
+
+static pthread_t stalled_tid;
+static unsigned long nr_reports, nr_wrong_reports;
+static uint64_t max_stall_ms;
+
+static void stall_func(const struct rcu_stall_info *info, void *priv)
+{
+	if (!pthread_equal(info->tid, stalled_tid)) {
+		nr_wrong_reports++;
+		return;
+	}
+	printf("reader stalled for %llu ms, ctr %lx, gp ctr %lx\n",
+	       (unsigned long long) info->stall_ms, info->ctr, info->gp_ctr);
+	nr_reports++;
+	max_stall_ms = info->stall_ms;
+}
+
+static void *thr_stalled_reader(void *arg)
+{
+	unsigned long read_delay = *(unsigned long *) arg;
+
+	rcu_register_thread();
+	rcu_read_lock();
+	uatomic_set(&reader_in_cs, 1);
+	poll(NULL, 0, read_delay);
+	rcu_read_unlock();
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void *thr_idle_reader(void *arg)
+{
+	rcu_register_thread();
+	while (!test_stop) {
+		rcu_read_lock();
+		rcu_read_unlock();
+#ifdef RCU_QSBR
+		rcu_quiescent_state();
+#endif
+		poll(NULL, 0, 1);
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t tid_idle[NR_IDLE_READERS];
+	unsigned long timeout = DEFAULT_STALL_TIMEOUT;
+	unsigned long read_delay = DEFAULT_READ_DELAY;
+	unsigned long expected;
+	int err, i;
+
+	if (argc > 1)
+		timeout = atol(argv[1]);
+	if (argc > 2)
+		read_delay = atol(argv[2]);
+	if (timeout < 1 || read_delay < timeout) {
+		printf("Usage : %s [stall_timeout_ms] [read_delay_ms]\n",
+		       argv[0]);
+		exit(-1);
+	}
+
+	if (rcu_set_stall_detector(0, stall_func, NULL) != -EINVAL) {
+		fprintf(stderr, "Zero timeout accepted\n");
+		return 1;
+	}
+	err = rcu_set_stall_detector(timeout, stall_func, NULL);
+	if (err)
+		exit(1);
+
+	for (i = 0; i < NR_IDLE_READERS; i++) {
+		err = pthread_create(&tid_idle[i], NULL, thr_idle_reader, NULL);
+		if (err != 0)
+			exit(1);
+	}
+	err = pthread_create(&stalled_tid, NULL, thr_stalled_reader,
+			     &read_delay);
+	if (err != 0)
+		exit(1);
+	while (!uatomic_read(&reader_in_cs))
+		poll(NULL, 0, 1);
+
+	synchronize_rcu();
+
+	err = pthread_join(stalled_tid, NULL);
+	if (err != 0)
+		exit(1);
+
+	/* Reports stop once the detector is disabled. */
+	rcu_set_stall_detector(0, NULL, NULL);
+	reader_in_cs = 0;
+	err = pthread_create(&stalled_tid, NULL, thr_stalled_reader,
+			     &read_delay);
+	if (err != 0)
+		exit(1);
+	while (!uatomic_read(&reader_in_cs))
+		poll(NULL, 0, 1);
+	synchronize_rcu();
+	err = pthread_join(stalled_tid, NULL);
+	if (err != 0)
+		exit(1);
+
+	test_stop = 1;
+	for (i = 0; i < NR_IDLE_READERS; i++) {
+		err = pthread_join(tid_idle[i], NULL);
+		if (err != 0)
+			exit(1);
+	}
+
+	expected = read_delay / timeout;
+	printf("%lu reports (%lu expected), %lu for other readers\n",
+	       nr_reports, expected, nr_wrong_reports);
+	if (nr_wrong_reports || nr_reports < 1 || nr_reports > expected
+			|| max_stall_ms < timeout) {
+		fprintf(stderr, "Unexpected stall reports\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * test_urcu_thread_churn.c
+ *
+ * Userspace RCU library - thread registration churn benchmark
+ *
+ * Short-lived worker threads register, run a single read-side critical
+ * section, and unregister, while an updater keeps a grace period in
+ * progress at all times, held back by a reader in long read-side
+ * critical sections. Measures the latency of registration (up to the
+ * end of the first read-side critical section) and of unregistration,
+ * and the worker throughput. With rcu-bp, registration happens on the
+ * first read-side critical section, and the registry slot is reclaimed
+ * after the thread exits.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_QSBR
+#include <urcu-qsbr.h>
+#elif defined(RCU_BP)
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+
+#define DEFAULT_NR_WORKERS	1000
+#define DEFAULT_CONCURRENCY	4
+#define DEFAULT_READ_DELAY	1000	/* us */
+
+struct latency {
+	unsigned long long tot;
+	unsigned long long max;
+};
+
+static volatile int test_stop;
+
+static unsigned long read_delay = DEFAULT_READ_DELAY;
+static unsigned long nr_gp;
+
+static struct latency register_latency, unregister_latency;
+
+static void busy_wait_us(unsigned long us)
+{
+	struct timespec ts, now;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	do {
+		caa_cpu_relax();
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	} while ((now.tv_sec - ts.tv_sec) * 1000000
+			+ (now.tv_nsec - ts.tv_nsec) / 1000 < (long) us);
+}
+
+static void account(struct latency *lat, cycles_t delta)
+{
+	unsigned long long old;
+
+	uatomic_add(&lat->tot, delta);
+	old = uatomic_read(&lat->max);
+	while (delta > old) {
+		if (uatomic_cmpxchg(&lat->max, old, delta) == old)
+			break;
+		old = uatomic_read(&lat->max);
+	}
+}
+
+static void *thr_slow_reader(void *arg)
+{
+	rcu_register_thread();
+	while (!test_stop) {
+		rcu_read_lock();
+		busy_wait_us(read_delay);
+		rcu_read_unlock();
+#ifdef RCU_QSBR
+		/* QSBR readers are in a critical section until here. */
+		rcu_quiescent_state();
+#endif
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void *thr_updater(void *arg)
+{
+	while (!test_stop) {
+		synchronize_rcu();
+		nr_gp++;
+	}
+	return NULL;
+}
+
+static void *thr_worker(void *arg)
+{
+	cycles_t time1, time2, time3;
+
+	time1 = caa_get_cycles();
+	rcu_register_thread();
+	rcu_read_lock();
+	rcu_read_unlock();
+	time2 = caa_get_cycles();
+	rcu_unregister_thread();
+	time3 = caa_get_cycles();
+
+	account(&register_latency, time2 - time1);
+	account(&unregister_latency, time3 - time2);
+	return NULL;
+}
+
+static void print_latency(const char *name, struct latency *lat,
+		unsigned long nr)
+{
+	printf("%-16s: %12g cycles avg, %12llu cycles max\n",
+	       name, (double) lat->tot / nr, lat->max);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t tid_slow_reader, tid_updater, *tid_worker;
+	struct timespec start, end;
+	unsigned long nr_workers = DEFAULT_NR_WORKERS, i, j, batch;
+	int err, concurrency = DEFAULT_CONCURRENCY;
+	double elapsed;
+
+	if (argc > 1)
+		nr_workers = atol(argv[1]);
+	if (argc > 2)
+		concurrency = atoi(argv[2]);
+	if (argc > 3)
+		read_delay = atol(argv[3]);
+	if (nr_workers < 1 || concurrency < 1) {
+		printf("Usage : %s [nr_workers] [concurrency] "
+		       "[read_delay_us]\n", argv[0]);
+		exit(-1);
+	}
+
+	tid_worker = malloc(sizeof(*tid_worker) * concurrency);
+
+	err = pthread_create(&tid_slow_reader, NULL, thr_slow_reader, NULL);
+	if (err != 0)
+		exit(1);
+	err = pthread_create(&tid_updater, NULL, thr_updater, NULL);
+	if (err != 0)
+		exit(1);
+
+	printf("%lu workers, %d at a time, %lu us read-side critical "
+	       "sections holding back grace periods\n",
+	       nr_workers, concurrency, read_delay);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nr_workers; i += batch) {
+		batch = caa_min(nr_workers - i, (unsigned long) concurrency);
+		for (j = 0; j < batch; j++) {
+			err = pthread_create(&tid_worker[j], NULL,
+					     thr_worker, NULL);
+			if (err != 0)
+				exit(1);
+		}
+		for (j = 0; j < batch; j++) {
+			err = pthread_join(tid_worker[j], NULL);
+			if (err != 0)
+				exit(1);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	test_stop = 1;
+	err = pthread_join(tid_updater, NULL);
+	if (err != 0)
+		exit(1);
+	err = pthread_join(tid_slow_reader, NULL);
+	if (err != 0)
+		exit(1);
+	free(tid_worker);
+
+	elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) / 1e9;
+	print_latency("register", &register_latency, nr_workers);
+	print_latency("unregister", &unregister_latency, nr_workers);
+	printf("%g workers/s, %lu grace periods\n",
+	       nr_workers / elapsed, nr_gp);
+
+	return 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * test_urcu_timeout.c
+ *
+ * Userspace RCU library - grace period wait timeout test
+ *
+ * A reader stays in a read-side critical section (or, with rcu-qsbr,
+ * online without quiescent state) for a configurable time. Checks that
+ * synchronize_rcu_timeout() and rcu_defer_barrier_timeout() give up after
+ * about their timeout while it does, that the reclamation can then be
+ * handed over to call_rcu(), and that both succeed once the reader is
+ * quiescent.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_QSBR
+#include <urcu-qsbr.h>
+#elif defined(RCU_BP)
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+#include <urcu-defer.h>
+
+#define DEFAULT_TIMEOUT		50	/* ms */
+#define DEFAULT_READ_DELAY	500	/* ms */
+
+struct test_node {
+	struct rcu_head rcu;
+};
+
+static volatile int reader_in_cs;
+static unsigned long nr_freed;
+
+static unsigned long long now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+static void free_node_cb(struct rcu_head *head)
+{
+	free(caa_container_of(head, struct test_node, rcu));
+	uatomic_inc(&nr_freed);
+}
+
+static void free_node(void *p)
+{
+	free(p);
+	uatomic_inc(&nr_freed);
+}
+
+static void *thr_stalled_reader(void *arg)
+{
+	unsigned long read_delay = *(unsigned long *) arg;
+
+	rcu_register_thread();
+	rcu_read_lock();
+	uatomic_set(&reader_in_cs, 1);
+	poll(NULL, 0, read_delay);
+	rcu_read_unlock();
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static int check(const char *name, int ret, int expected,
+		unsigned long long start, unsigned long long max_ms)
+{
+	unsigned long long delta = now_ms() - start;
+
+	printf("%s: %d after %llu ms\n", name, ret, delta);
+	if (ret != expected || delta > max_ms) {
+		fprintf(stderr, "%s: expected %d within %llu ms\n", name,
+			expected, max_ms);
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t tid;
+	struct timespec ts;
+	struct test_node *node;
+	unsigned long timeout = DEFAULT_TIMEOUT;
+	unsigned long read_delay = DEFAULT_READ_DELAY;
+	unsigned long long start;
+	int err, ret, fail = 0;
+
+	if (argc > 1)
+		timeout = atol(argv[1]);
+	if (argc > 2)
+		read_delay = atol(argv[2]);
+	if (timeout < 1 || read_delay < 4 * timeout) {
+		printf("Usage : %s [timeout_ms] [read_delay_ms]\n", argv[0]);
+		exit(-1);
+	}
+	ts.tv_sec = timeout / 1000;
+	ts.tv_nsec = (timeout % 1000) * 1000000;
+
+	rcu_register_thread();
+	rcu_defer_register_thread();
+	/*
+	 * rcu-bp registers threads on first use, which waits for the grace
+	 * period in progress: do it before the reader stalls, so that
+	 * call_rcu() does not.
+	 */
+	rcu_read_lock();
+	rcu_read_unlock();
+
+	/* No reader: the grace period completes well within the timeout. */
+	start = now_ms();
+	ret = synchronize_rcu_timeout(&ts);
+	fail |= check("no reader", ret, 0, start, timeout);
+
+	err = pthread_create(&tid, NULL, thr_stalled_reader, &read_delay);
+	if (err != 0)
+		exit(1);
+	while (!uatomic_read(&reader_in_cs))
+		poll(NULL, 0, 1);
+
+	/* Stalled reader: give up, and let call_rcu() reclaim instead. */
+	node = malloc(sizeof(*node));
+	start = now_ms();
+	ret = synchronize_rcu_timeout(&ts);
+	fail |= check("stalled reader", ret, -ETIMEDOUT, start,
+		      read_delay / 2);
+	if (now_ms() - start < timeout) {
+		fprintf(stderr, "timed out early\n");
+		fail = 1;
+	}
+	if (ret)
+		call_rcu(&node->rcu, free_node_cb);
+	else
+		free_node(node);
+
+	defer_rcu(free_node, malloc(sizeof(*node)));
+	start = now_ms();
+	ret = rcu_defer_barrier_timeout(&ts);
+	fail |= check("defer barrier, stalled reader", ret, -ETIMEDOUT,
+		      start, read_delay / 2);
+
+	err = pthread_join(tid, NULL);
+	if (err != 0)
+		exit(1);
+
+	/* Reader gone: both succeed. */
+	start = now_ms();
+	ret = synchronize_rcu_timeout(&ts);
+	fail |= check("reader gone", ret, 0, start, timeout);
+	start = now_ms();
+	ret = rcu_defer_barrier_timeout(&ts);
+	fail |= check("defer barrier, reader gone", ret, 0, start, timeout);
+
+	rcu_defer_unregister_thread();
+	rcu_unregister_thread();
+
+	/* Leave call_rcu() some time to reclaim the node. */
+	start = now_ms();
+	while (uatomic_read(&nr_freed) < 2 && now_ms() - start < 5000)
+		poll(NULL, 0, 10);
+	printf("%lu of 2 nodes freed\n", nr_freed);
+	if (nr_freed != 2)
+		fail = 1;
+	return fail;
+}
@@ -0,0 +1,197 @@
+/*
+ * test_urcu_trace.c
+ *
+ * Userspace RCU library - built-in event trace test
+ *
+ * Enables the trace, runs grace periods, call_rcu() and defer_rcu()
+ * callbacks and a hash table resize, and dumps the trace to the file
+ * given as argument (urcu-trace.bin by default), which rcu_trace_decode
+ * prints. Checks that the dump holds each kind of event.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+
+#define _LGPL_SOURCE
+#ifdef RCU_QSBR
+#include <urcu-qsbr.h>
+#elif defined(RCU_BP)
+#include <urcu-bp.h>
+#else
+#include <urcu.h>
+#endif
+#include <urcu/rculfhash.h>
+#include <urcu/trace.h>
+
+#define NR_GP		10
+#define NR_CALLBACKS	100
+#define NR_NODES	1024
+
+static unsigned long nr_called;
+static struct cds_lfht_node nodes[NR_NODES];
+
+static void callback(struct rcu_head *head)
+{
+	uatomic_inc(&nr_called);
+}
+
+static void deferred(void *p)
+{
+	uatomic_inc(&nr_called);
+}
+
+static int check_dump(const char *path)
+{
+	struct rcu_trace_header hdr;
+	struct rcu_trace_record rec;
+	unsigned long long count[RCU_TRACE_NR_TYPES] = { 0 }, i;
+	static const enum rcu_trace_type expected[] = {
+		RCU_TRACE_GP_START, RCU_TRACE_GP_END,
+		RCU_TRACE_CALL_RCU_BATCH, RCU_TRACE_DEFER_BATCH,
+		RCU_TRACE_LFHT_RESIZE_START, RCU_TRACE_LFHT_RESIZE_END,
+	};
+	uint64_t last = 0;
+	FILE *f;
+	int ret = 0;
+
+	f = fopen(path, "rb");
+	if (!f || fread(&hdr, sizeof(hdr), 1, f) != 1
+			|| strcmp(hdr.magic, RCU_TRACE_MAGIC)) {
+		printf("FAIL: bad trace header\n");
+		return 1;
+	}
+	for (i = 0; i < hdr.nr_records; i++) {
+		if (fread(&rec, sizeof(rec), 1, f) != 1) {
+			printf("FAIL: truncated trace\n");
+			return 1;
+		}
+		if (rec.ts_ns < last) {
+			printf("FAIL: records not sorted\n");
+			return 1;
+		}
+		last = rec.ts_ns;
+		if (rec.type < RCU_TRACE_NR_TYPES)
+			count[rec.type]++;
+	}
+	fclose(f);
+	for (i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+		if (!count[expected[i]]) {
+			printf("FAIL: no event of type %u\n", expected[i]);
+			ret = 1;
+		}
+	}
+	if (count[RCU_TRACE_GP_START] < NR_GP) {
+		printf("FAIL: %llu grace periods traced, expected %d\n",
+		       count[RCU_TRACE_GP_START], NR_GP);
+		ret = 1;
+	}
+	printf("%llu events, %llu grace periods\n",
+	       (unsigned long long) hdr.nr_records, count[RCU_TRACE_GP_START]);
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = argc > 1 ? argv[1] : "urcu-trace.bin";
+	struct rcu_head *heads;
+	struct cds_lfht *ht;
+	int fd, i, ret;
+
+	rcu_trace_enable(1);
+	rcu_register_thread();
+	rcu_defer_register_thread();
+
+	for (i = 0; i < NR_GP; i++)
+		synchronize_rcu();
+
+	heads = calloc(NR_CALLBACKS, sizeof(*heads));
+	if (!heads)
+		return 1;
+	for (i = 0; i < NR_CALLBACKS; i++)
+		call_rcu(&heads[i], callback);
+	for (i = 0; i < NR_CALLBACKS; i++)
+		defer_rcu(deferred, NULL);
+	rcu_defer_barrier();
+#ifdef RCU_QSBR
+	rcu_thread_offline();
+#endif
+	while (uatomic_read(&nr_called) < 2 * NR_CALLBACKS)
+		(void) poll(NULL, 0, 10);
+#ifdef RCU_QSBR
+	rcu_thread_online();
+#endif
+
+	/*
+	 * Adding nodes makes the table grow from call_rcu(): the callback
+	 * queued next runs once the resize is done.
+	 */
+	ht = cds_lfht_new(1, 1, 0, CDS_LFHT_AUTO_RESIZE, NULL);
+	if (!ht)
+		return 1;
+	for (i = 0; i < NR_NODES; i++) {
+		cds_lfht_node_init(&nodes[i]);
+		rcu_read_lock();
+		cds_lfht_add(ht, i, &nodes[i]);
+		rcu_read_unlock();
+	}
+	call_rcu(&heads[0], callback);
+#ifdef RCU_QSBR
+	rcu_thread_offline();
+#endif
+	while (uatomic_read(&nr_called) < 2 * NR_CALLBACKS + 1)
+		(void) poll(NULL, 0, 10);
+#ifdef RCU_QSBR
+	rcu_thread_online();
+#endif
+	for (i = 0; i < NR_NODES; i++) {
+		rcu_read_lock();
+		ret = cds_lfht_del(ht, &nodes[i]);
+		rcu_read_unlock();
+		if (ret)
+			return 1;
+	}
+	ret = cds_lfht_destroy(ht, NULL);
+	if (ret)
+		return 1;
+
+	rcu_trace_enable(0);
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		perror(path);
+		return 1;
+	}
+	ret = rcu_trace_dump(fd);
+	close(fd);
+	if (ret) {
+		printf("FAIL: rcu_trace_dump: %d\n", ret);
+		return 1;
+	}
+
+	rcu_defer_unregister_thread();
+	rcu_unregister_thread();
+	free(heads);
+	ret = check_dump(path);
+	if (!ret)
+		printf("OK, decode with: rcu_trace_decode %s\n", path);
+	return ret;
+}
@@ -30,6 +30,7 @@
 #include <signal.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <errno.h>
 #include <poll.h>
@@ -43,60 +44,32 @@
 #include "urcu/tls-compat.h"
 
 #include "urcu-die.h"
+#include "urcu-spin.h"
+#include "urcu-trace.h"
 
 /* Do not #define _LGPL_SOURCE to ensure we can emit the wrapper symbols */
 #undef _LGPL_SOURCE
 #include "urcu-bp.h"
 #define _LGPL_SOURCE
 
+#include "urcu-poll-impl.h"
+#include "urcu-scan-impl.h"
+#include "urcu-gp-stats-impl.h"
+#include "urcu-stall-impl.h"
+#include "urcu-gp-replica-impl.h"
+#include "urcu-read-profile-impl.h"
+#include "urcu-membarrier-impl.h"
+
 #ifndef MAP_ANONYMOUS
 #define MAP_ANONYMOUS MAP_ANON
 #endif
 
-#ifdef __linux__
-static
-void *mremap_wrapper(void *old_address, size_t old_size,
-		size_t new_size, int flags)
-{
-	return mremap(old_address, old_size, new_size, flags);
-}
-#else
-
-#define MREMAP_MAYMOVE	1
-#define MREMAP_FIXED	2
-
-/*
- * mremap wrapper for non-Linux systems. Maps a RW, anonymous private mapping.
- * This is not generic.
-*/
-static
-void *mremap_wrapper(void *old_address, size_t old_size,
-		size_t new_size, int flags)
-{
-	void *new_address;
-
-	assert(flags & MREMAP_MAYMOVE);
-	assert(!(flags & MREMAP_FIXED));
-	new_address = mmap(old_address, new_size,
-			   PROT_READ | PROT_WRITE,
-			   MAP_ANONYMOUS | MAP_PRIVATE,
-			   -1, 0);
-	if (new_address == MAP_FAILED)
-		return MAP_FAILED;
-	if (old_address) {
-		memcpy(new_address, old_address, old_size);
-		munmap(old_address, old_size);
-	}
-	return new_address;
-}
-#endif
-
 /* Sleep delay in us */
 #define RCU_SLEEP_DELAY		1000
-#define ARENA_INIT_ALLOC	16
+#define ARENA_INIT_ALLOC	4096	/* bytes, doubled for each new chunk */
 
 /*
- * Active attempts to check for reader Q.S. before calling sleep().
+ * Loops between reader kicks on incoherent cache architectures.
  */
 #define RCU_QS_ACTIVE_ATTEMPTS 100
 
@@ -111,6 +84,20 @@ DEFINE_URCU_TLS(unsigned int, rcu_rand_yield);
 
 struct rcu_gp rcu_gp = { .ctr = RCU_GP_COUNT };
 
+#ifdef CONFIG_RCU_GP_REPLICAS
+DEFINE_RCU_GP_REPLICAS(RCU_GP_COUNT);
+#endif
+
+/* Selected by rcu_bp_init(), used by smp_mb_master(). */
+static int init_done;
+int rcu_has_sys_membarrier;
+static int membarrier_cmd;
+
+/* Notifies thread exit, with the thread's registry slot as value. */
+static pthread_key_t rcu_bp_key;
+
+static void rcu_bp_thread_exit(void *arg);
+
 /*
  * Pointer to registry elements. Written to only by each individual reader. Read
  * by both the reader and the writers.
@@ -118,14 +105,41 @@ struct rcu_gp rcu_gp = { .ctr = RCU_GP_COUNT };
 DEFINE_URCU_TLS(struct rcu_reader *, rcu_reader);
 
 static CDS_LIST_HEAD(registry);
+static DEFINE_READER_SCAN(registry_scan);
 
-struct registry_arena {
-	void *p;
-	size_t len;
+static struct gp_stats gp_stats = GP_STATS_INIT;
+static struct stall_detector stall_detector;
+
+/* Busy-waiting budget before calling sleep(). */
+static DEFINE_URCU_SPIN(gp_spin);
+
+/*
+ * The registry slots are allocated from chunks which are never moved nor
+ * unmapped before the library is, since readers keep a pointer to their
+ * slot.
+ */
+struct registry_chunk {
+	struct cds_list_head node;	/* In registry_arena chunk_list. */
+	size_t len;			/* Length of the mapping. */
+	size_t data_len;
 	size_t used;
+	char data[] __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+};
+
+struct registry_arena {
+	struct cds_list_head chunk_list;
+	/* Slots reclaimed by rcu_gc_registry(), reused first. */
+	struct rcu_reader *free_slots;
+	/*
+	 * Slots of exited threads, pushed without locking by the thread
+	 * exit notifier, and reclaimed by the next grace period.
+	 */
+	struct rcu_reader *exited;
 };
 
-static struct registry_arena registry_arena;
+static struct registry_arena registry_arena = {
+	.chunk_list = CDS_LIST_HEAD_INIT(registry_arena.chunk_list),
+};
 
 /* Saved fork signal mask, protected by rcu_gp_lock */
 static sigset_t saved_fork_signal_mask;
@@ -158,12 +172,47 @@ static void mutex_unlock(pthread_mutex_t *mutex)
 		urcu_die(ret);
 }
 
-static void wait_for_readers(struct cds_list_head *input_readers,
-			struct cds_list_head *cur_snap_readers,
-			struct cds_list_head *qsreaders)
+/*
+ * Called with rcu_gp_lock held, so that rcu_has_sys_membarrier does not
+ * change during a grace period. Readers registering before the first
+ * grace period are the only ones which may have seen it unset.
+ */
+static void rcu_bp_init(void)
 {
-	int wait_loops = 0;
-	struct rcu_reader *index, *tmp;
+	int ret;
+
+	if (init_done)
+		return;
+	init_done = 1;
+
+	ret = pthread_key_create(&rcu_bp_key, rcu_bp_thread_exit);
+	if (ret)
+		urcu_die(ret);
+	membarrier_cmd = membarrier_select_cmd();
+	if (membarrier_cmd != MEMBARRIER_CMD_QUERY)
+		CMM_STORE_SHARED(rcu_has_sys_membarrier, 1);
+}
+
+static void smp_mb_master(void)
+{
+	if (caa_likely(rcu_has_sys_membarrier))
+		(void) membarrier(membarrier_cmd, 0);
+	else
+		cmm_smp_mb();
+}
+
+/*
+ * Non-expedited grace periods busy-wait for the budget of gp_spin, then
+ * sleep between reader scans until readers are quiescent, and adapt the
+ * budget to the duration of the wait. Expedited grace periods never
+ * sleep: they keep busy-looping until all readers are quiescent.
+ */
+static void wait_for_readers(unsigned long *input_readers,
+			unsigned long *cur_snap_readers,
+			int expedited)
+{
+	struct urcu_spin_wait spin_wait = { 0 };
+	int wait_loops = 0, parked = 0, empty;
 
 	/*
 	 * Wait for each thread URCU_TLS(rcu_reader).ctr to either
@@ -171,54 +220,44 @@ static void wait_for_readers(struct cds_list_head *input_readers,
 	 * rcu_gp.ctr value.
 	 */
 	for (;;) {
-		wait_loops++;
-		cds_list_for_each_entry_safe(index, tmp, input_readers, node) {
-			switch (rcu_reader_state(&index->ctr)) {
-			case RCU_READER_ACTIVE_CURRENT:
-				if (cur_snap_readers) {
-					cds_list_move(&index->node,
-						cur_snap_readers);
-					break;
-				}
-				/* Fall-through */
-			case RCU_READER_INACTIVE:
-				cds_list_move(&index->node, qsreaders);
-				break;
-			case RCU_READER_ACTIVE_OLD:
-				/*
-				 * Old snapshot. Leaving node in
-				 * input_readers will make us busy-loop
-				 * until the snapshot becomes current or
-				 * the reader becomes inactive.
-				 */
-				break;
-			}
-		}
-
-		if (cds_list_empty(input_readers)) {
+		empty = reader_scan_pass(&registry_scan, input_readers,
+				cur_snap_readers);
+		if (empty)
 			break;
+		stall_check(&stall_detector, &registry_scan, input_readers);
+		if (!expedited && !wait_loops)
+			urcu_spin_wait_start(&gp_spin, &spin_wait);
+		wait_loops++;
+#ifdef HAS_INCOHERENT_CACHES
+		/*
+		 * Readers relying on sys_membarrier() do not commit
+		 * their ctr update to memory by themselves.
+		 */
+		if (!(wait_loops % RCU_QS_ACTIVE_ATTEMPTS))
+			smp_mb_master();
+#endif /* #ifdef HAS_INCOHERENT_CACHES */
+		if (!parked && !expedited
+				&& urcu_spin_wait_expired(&spin_wait))
+			parked = 1;
+		if (parked) {
+			gp_stats_sleep(&gp_stats);
+			usleep(RCU_SLEEP_DELAY);
 		} else {
-			if (wait_loops == RCU_QS_ACTIVE_ATTEMPTS)
-				usleep(RCU_SLEEP_DELAY);
-			else
-				caa_cpu_relax();
+			gp_stats_spin(&gp_stats);
+			caa_cpu_relax();
 		}
 	}
+	if (!expedited && wait_loops)
+		urcu_spin_wait_end(&gp_spin, &spin_wait);
 }
 
-void synchronize_rcu(void)
+/*
+ * Called with rcu_gp_lock held and signals blocked.
+ */
+static void do_grace_period(int expedited)
 {
-	CDS_LIST_HEAD(cur_snap_readers);
-	CDS_LIST_HEAD(qsreaders);
-	sigset_t newmask, oldmask;
-	int ret;
-
-	ret = sigfillset(&newmask);
-	assert(!ret);
-	ret = pthread_sigmask(SIG_BLOCK, &newmask, &oldmask);
-	assert(!ret);
-
-	mutex_lock(&rcu_gp_lock);
+	rcu_gp_seq_start();
+	urcu_trace(RCU_TRACE_GP_START, rcu_gp_seq, expedited);
 
 	if (cds_list_empty(&registry))
 		goto out;
@@ -226,15 +265,22 @@ void synchronize_rcu(void)
 	/* All threads should read qparity before accessing data structure
 	 * where new ptr points to. */
 	/* Write new ptr before changing the qparity */
-	cmm_smp_mb();
+	smp_mb_master();
 
 	/* Remove old registry elements */
 	rcu_gc_registry();
 
+	reader_scan_start(&registry_scan, &registry);
+	gp_stats_readers(&gp_stats, &registry_scan);
+	stall_gp_start(&stall_detector);
+
 	/*
 	 * Wait for readers to observe original parity or be quiescent.
 	 */
-	wait_for_readers(&registry, &cur_snap_readers, &qsreaders);
+	gp_stats_phase_start(&gp_stats);
+	wait_for_readers(registry_scan.pending, registry_scan.cur_snap,
+			expedited);
+	gp_stats_phase_end(&gp_stats);
 
 	/*
 	 * Adding a cmm_smp_mb() which is _not_ formally required, but makes the
@@ -245,6 +291,9 @@ void synchronize_rcu(void)
 
 	/* Switch parity: 0 -> 1, 1 -> 0 */
 	CMM_STORE_SHARED(rcu_gp.ctr, rcu_gp.ctr ^ RCU_GP_CTR_PHASE);
+#ifdef CONFIG_RCU_GP_REPLICAS
+	gp_replica_update(rcu_gp.ctr);
+#endif
 
 	/*
 	 * Must commit qparity update to memory before waiting for other parity
@@ -263,24 +312,169 @@ void synchronize_rcu(void)
 	/*
 	 * Wait for readers to observe new parity or be quiescent.
 	 */
-	wait_for_readers(&cur_snap_readers, NULL, &qsreaders);
-
-	/*
-	 * Put quiescent reader list back into registry.
-	 */
-	cds_list_splice(&qsreaders, &registry);
+	gp_stats_phase_start(&gp_stats);
+	wait_for_readers(registry_scan.cur_snap, NULL, expedited);
+	gp_stats_phase_end(&gp_stats);
+	stall_gp_end(&stall_detector);
 
 	/*
 	 * Finish waiting for reader threads before letting the old ptr being
 	 * freed.
 	 */
-	cmm_smp_mb();
+	smp_mb_master();
 out:
+	urcu_trace(RCU_TRACE_GP_END, rcu_gp_seq, expedited);
+	rcu_gp_seq_end();
+}
+
+static void __synchronize_rcu(int expedited)
+{
+	sigset_t newmask, oldmask;
+	unsigned long cookie;
+	int ret;
+
+	ret = sigfillset(&newmask);
+	assert(!ret);
+	ret = pthread_sigmask(SIG_BLOCK, &newmask, &oldmask);
+	assert(!ret);
+
+	/*
+	 * A grace period starting after this point and completed by the
+	 * time we get rcu_gp_lock is enough: callers arriving during a
+	 * grace period, such as call_rcu threads woken up together by
+	 * rcu_barrier(), share the next one.
+	 */
+	cookie = get_state_synchronize_rcu();
+	mutex_lock(&rcu_gp_lock);
+	if (!poll_state_synchronize_rcu(cookie)) {
+		gp_stats_gp_start(&gp_stats);
+		do_grace_period(expedited);
+		gp_stats_gp_end(&gp_stats, NULL, 1);
+	}
 	mutex_unlock(&rcu_gp_lock);
+
 	ret = pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
 	assert(!ret);
 }
 
+void synchronize_rcu(void)
+{
+	__synchronize_rcu(0);
+}
+
+/*
+ * Expedited grace periods busy-wait for readers instead of sleeping
+ * between reader scans.
+ */
+void synchronize_rcu_expedited(void)
+{
+	__synchronize_rcu(1);
+}
+
+int synchronize_rcu_timeout(const struct timespec *timeout)
+{
+	return gp_poll_synchronize_timeout(timeout);
+}
+
+/*
+ * Callers of synchronize_rcu() do not queue in urcu-bp, so
+ * rcu_gp_notify_eventfd() waiters queue on their own, always led by the
+ * poll worker.
+ */
+static DEFINE_URCU_WAIT_QUEUE(gp_notify_waiters);
+
+static void rcu_gp_lead_waiters(void)
+{
+	struct urcu_waiters waiters;
+
+	/* Only the poll worker pops waiters. */
+	urcu_move_waiters(&waiters, &gp_notify_waiters);
+	if (!waiters.head)
+		return;
+	synchronize_rcu();
+	urcu_wake_all_waiters(&waiters);
+}
+
+/* synchronize_rcu() does not queue in urcu-bp. */
+static void rcu_gp_poll_synchronize(void)
+{
+	synchronize_rcu();
+}
+
+int rcu_gp_notify_eventfd(int fd)
+{
+	return gp_notify_eventfd(&gp_notify_waiters, fd);
+}
+
+/*
+ * Opt in to hierarchical grace period detection.
+ */
+int rcu_enable_hierarchical_gp(int cpus_per_group)
+{
+	sigset_t newmask, oldmask;
+	int ret, ret2;
+
+	ret2 = sigfillset(&newmask);
+	assert(!ret2);
+	ret2 = pthread_sigmask(SIG_BLOCK, &newmask, &oldmask);
+	assert(!ret2);
+
+	mutex_lock(&rcu_gp_lock);
+	ret = reader_scan_enable_tree(&registry_scan, cpus_per_group);
+	mutex_unlock(&rcu_gp_lock);
+
+	ret2 = pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+	assert(!ret2);
+	return ret;
+}
+
+void rcu_gp_stats_enable(int enable)
+{
+	gp_stats_enable(&gp_stats, enable);
+}
+
+void rcu_gp_stats_get(struct rcu_gp_stats *stats)
+{
+	gp_stats_get(&gp_stats, stats);
+}
+
+void rcu_gp_stats_reset(void)
+{
+	gp_stats_reset(&gp_stats);
+}
+
+int rcu_set_stall_detector(unsigned long timeout_ms, rcu_stall_func_t func,
+		void *priv)
+{
+	sigset_t newmask, oldmask;
+	int ret, ret2;
+
+	ret2 = sigfillset(&newmask);
+	assert(!ret2);
+	ret2 = pthread_sigmask(SIG_BLOCK, &newmask, &oldmask);
+	assert(!ret2);
+
+	mutex_lock(&rcu_gp_lock);
+	ret = stall_detector_set(&stall_detector, timeout_ms, func, priv);
+	mutex_unlock(&rcu_gp_lock);
+
+	ret2 = pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+	assert(!ret2);
+	return ret;
+}
+
+int rcu_set_spin_policy(const struct rcu_spin_policy *policy)
+{
+	return urcu_spin_set(&gp_spin, policy);
+}
+
+void rcu_get_spin_policy(struct rcu_spin_policy *policy)
+{
+	urcu_spin_get(&gp_spin, policy);
+	policy->gp_spin_ns = CMM_LOAD_SHARED(gp_spin.spin_ns);
+	policy->waiter_spin_ns = 0;
+}
+
 /*
  * library wrappers to be used by non-LGPL compatible source code.
  */
@@ -300,82 +494,113 @@ int rcu_read_ongoing(void)
 	return _rcu_read_ongoing();
 }
 
-/*
- * only grow for now.
- */
-static void resize_arena(struct registry_arena *arena, size_t len)
+/* Called with signals off and mutex locked */
+static struct rcu_reader *arena_alloc(struct registry_arena *arena)
 {
-	void *new_arena;
-
-	if (!arena->p)
-		new_arena = mmap(arena->p, len,
-				 PROT_READ | PROT_WRITE,
-				 MAP_ANONYMOUS | MAP_PRIVATE,
-				 -1, 0);
-	else
-		new_arena = mremap_wrapper(arena->p, arena->len,
-				   	len, MREMAP_MAYMOVE);
-	assert(new_arena != MAP_FAILED);
-
-	/*
-	 * re-used the same region ?
-	 */
-	if (new_arena == arena->p)
-		return;
+	struct registry_chunk *chunk = NULL;
+	struct rcu_reader *rcu_reader_reg;
+	size_t len = ARENA_INIT_ALLOC;
+	void *p;
 
-	bzero(new_arena + arena->len, len - arena->len);
-	arena->p = new_arena;
+	rcu_reader_reg = arena->free_slots;
+	if (rcu_reader_reg) {
+		arena->free_slots = rcu_reader_reg->next_free;
+		rcu_reader_reg->next_free = NULL;
+		return rcu_reader_reg;
+	}
+	if (!cds_list_empty(&arena->chunk_list)) {
+		chunk = cds_list_entry(arena->chunk_list.prev,
+				struct registry_chunk, node);
+		len = chunk->len << 1;
+	}
+	if (!chunk || chunk->used + sizeof(*rcu_reader_reg) > chunk->data_len) {
+		p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+			 MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (p == MAP_FAILED)
+			urcu_die(errno);
+		chunk = p;
+		chunk->len = len;
+		chunk->data_len = len - offsetof(struct registry_chunk, data);
+		cds_list_add_tail(&chunk->node, &arena->chunk_list);
+	}
+	rcu_reader_reg = (struct rcu_reader *) (chunk->data + chunk->used);
+	chunk->used += sizeof(*rcu_reader_reg);
+	return rcu_reader_reg;
 }
 
 /* Called with signals off and mutex locked */
 static void add_thread(void)
 {
 	struct rcu_reader *rcu_reader_reg;
+	int ret;
 
-	if (registry_arena.len
-	    < registry_arena.used + sizeof(struct rcu_reader))
-		resize_arena(&registry_arena,
-		caa_max(registry_arena.len << 1, ARENA_INIT_ALLOC));
-	/*
-	 * Find a free spot.
-	 */
-	for (rcu_reader_reg = registry_arena.p;
-	     (void *)rcu_reader_reg < registry_arena.p + registry_arena.len;
-	     rcu_reader_reg++) {
-		if (!rcu_reader_reg->alloc)
-			break;
-	}
+	rcu_reader_reg = arena_alloc(&registry_arena);
 	rcu_reader_reg->alloc = 1;
-	registry_arena.used += sizeof(struct rcu_reader);
 
 	/* Add to registry */
 	rcu_reader_reg->tid = pthread_self();
 	assert(rcu_reader_reg->ctr == 0);
+#ifdef CONFIG_RCU_GP_REPLICAS
+	rcu_reader_reg->gp_replica = gp_replica_select();
+#endif
 	cds_list_add(&rcu_reader_reg->node, &registry);
+	reader_scan_mark_stale(&registry_scan);
 	URCU_TLS(rcu_reader) = rcu_reader_reg;
+
+	/* Get rcu_bp_thread_exit() called when the thread exits. */
+	ret = pthread_setspecific(rcu_bp_key, rcu_reader_reg);
+	if (ret)
+		urcu_die(ret);
+}
+
+/*
+ * Thread exit notifier. Does not take rcu_gp_lock, so that exiting
+ * threads never wait for grace periods: the slot is left in the registry,
+ * inactive, until the next grace period reclaims it. A thread using RCU
+ * again from another thread-specific data destructor registers again.
+ */
+static void rcu_bp_thread_exit(void *arg)
+{
+	struct rcu_reader *rcu_reader_reg = arg, *old, *head;
+
+	assert(!(rcu_reader_reg->ctr & RCU_GP_CTR_NEST_MASK));
+	URCU_TLS(rcu_reader) = NULL;
+	cmm_barrier();	/* Signal handlers use a new slot from now on. */
+
+	head = CMM_LOAD_SHARED(registry_arena.exited);
+	do {
+		old = head;
+		rcu_reader_reg->next_free = old;
+		head = uatomic_cmpxchg(&registry_arena.exited, old,
+				rcu_reader_reg);
+	} while (head != old);
 }
 
 /* Called with signals off and mutex locked */
+static void free_slot(struct rcu_reader *rcu_reader_reg)
+{
+	cds_list_del(&rcu_reader_reg->node);
+	reader_scan_mark_stale(&registry_scan);
+	rcu_reader_reg->ctr = 0;
+	rcu_reader_reg->alloc = 0;
+	rcu_reader_reg->next_free = registry_arena.free_slots;
+	registry_arena.free_slots = rcu_reader_reg;
+}
+
+/*
+ * Reclaim the slots of the threads which exited since the last call.
+ * Called with signals off and mutex locked.
+ */
 static void rcu_gc_registry(void)
 {
-	struct rcu_reader *rcu_reader_reg;
-	pthread_t tid;
-	int ret;
+	struct rcu_reader *rcu_reader_reg, *next;
 
-	for (rcu_reader_reg = registry_arena.p;
-	     (void *)rcu_reader_reg < registry_arena.p + registry_arena.len;
-	     rcu_reader_reg++) {
-		if (!rcu_reader_reg->alloc)
-			continue;
-		tid = rcu_reader_reg->tid;
-		ret = pthread_kill(tid, 0);
-		assert(ret != EINVAL);
-		if (ret == ESRCH) {
-			cds_list_del(&rcu_reader_reg->node);
-			rcu_reader_reg->ctr = 0;
-			rcu_reader_reg->alloc = 0;
-			registry_arena.used -= sizeof(struct rcu_reader);
-		}
+	if (!CMM_LOAD_SHARED(registry_arena.exited))
+		return;
+	rcu_reader_reg = uatomic_xchg(&registry_arena.exited, NULL);
+	for (; rcu_reader_reg; rcu_reader_reg = next) {
+		next = rcu_reader_reg->next_free;
+		free_slot(rcu_reader_reg);
 	}
 }
 
@@ -397,6 +622,7 @@ void rcu_bp_register(void)
 		goto end;
 
 	mutex_lock(&rcu_gp_lock);
+	rcu_bp_init();
 	add_thread();
 	mutex_unlock(&rcu_gp_lock);
 end:
@@ -406,8 +632,14 @@ end:
 
 void rcu_bp_exit(void)
 {
-	if (registry_arena.p)
-		munmap(registry_arena.p, registry_arena.len);
+	struct registry_chunk *chunk, *tmp;
+
+	/* The notifier is about to be unmapped. */
+	if (init_done)
+		(void) pthread_key_delete(rcu_bp_key);
+	cds_list_for_each_entry_safe(chunk, tmp, &registry_arena.chunk_list,
+			node)
+		munmap(chunk, chunk->len);
 }
 
 /*
@@ -441,10 +673,16 @@ void rcu_bp_after_fork_parent(void)
 
 void rcu_bp_after_fork_child(void)
 {
+	struct rcu_reader *rcu_reader_reg, *tmp;
 	sigset_t oldmask;
 	int ret;
 
+	/* Only the current thread survives in the child. */
 	rcu_gc_registry();
+	cds_list_for_each_entry_safe(rcu_reader_reg, tmp, &registry, node) {
+		if (rcu_reader_reg != URCU_TLS(rcu_reader))
+			free_slot(rcu_reader_reg);
+	}
 	oldmask = saved_fork_signal_mask;
 	mutex_unlock(&rcu_gp_lock);
 	ret = pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
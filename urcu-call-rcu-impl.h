@@ -29,11 +29,13 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <limits.h>
 #include <errno.h>
 #include <poll.h>
 #include <sys/time.h>
 #include <unistd.h>
 #include <sched.h>
+#include <time.h>
 
 #include "config.h"
 #include "urcu/wfcqueue.h"
@@ -43,6 +45,45 @@
 #include "urcu/futex.h"
 #include "urcu/tls-compat.h"
 #include "urcu-die.h"
+#include "urcu-wait.h"
+#include "urcu-trace.h"
+
+/*
+ * Grace period primitives used by call_rcu threads which do not serve
+ * the flavor's own grace periods, such as those of RCU domains. The
+ * thread registers to them in addition to the flavor.
+ */
+struct call_rcu_gp_ops {
+	void (*register_thread)(void *arg);
+	void (*unregister_thread)(void *arg);
+	void (*synchronize)(void *arg);
+};
+
+#if defined(HAVE_SCHED_SETAFFINITY) && defined(HAVE_CPU_SET) \
+	&& (SCHED_SETAFFINITY_ARGS == 3)
+#define CALL_RCU_HAVE_AFFINITY_MASK
+#endif
+
+struct call_rcu_pool;
+
+/*
+ * Segments of the callbacks spliced by a call_rcu thread, after the
+ * kernel's rcu_segcblist: callbacks ready to be invoked, callbacks
+ * waiting for the grace period sequence "seq", and callbacks waiting
+ * for a later one. The callbacks not spliced yet form the next segment.
+ */
+enum call_rcu_seg_idx {
+	CALL_RCU_DONE_SEG,
+	CALL_RCU_WAIT_SEG,
+	CALL_RCU_NEXT_READY_SEG,
+	CALL_RCU_NR_SEGS,
+};
+
+struct call_rcu_seg {
+	struct cds_wfcq_head head;
+	struct cds_wfcq_tail tail;
+	unsigned long seq;
+};
 
 /* Data structure that identifies a call_rcu thread. */
 
@@ -61,9 +102,31 @@ struct call_rcu_data {
 	unsigned long qlen; /* maintained for debugging. */
 	pthread_t tid;
 	int cpu_affinity;
+	const struct call_rcu_gp_ops *gp_ops;	/* NULL for the flavor's. */
+	void *gp_arg;
+	struct call_rcu_attr attr;	/* Set by call_rcu_data_set_attr(). */
+	unsigned long delay_us;	/* Batching delay, written by the thread. */
+	/* Only used by the thread. */
+	struct call_rcu_seg seg[CALL_RCU_NR_SEGS];
+	uint64_t gp_start_ns;	/* Last grace period requested. */
+	struct call_rcu_pool *pool;	/* Serviced by a pool, not a thread. */
+	/*
+	 * Pool queues only, protected by the pool mutex: callbacks waiting
+	 * for the grace period of a round, callbacks ready to be invoked,
+	 * and workers using the queue.
+	 */
+	struct cds_wfcq_head gp_head;
+	struct cds_wfcq_tail gp_tail;
+	struct cds_wfcq_head ready_head;
+	struct cds_wfcq_tail ready_tail;
+	unsigned int busy;
+	int removing;
 	struct cds_list_head list;
 } __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
 
+/* Smallest delay adaptive threads grow back from when idle. */
+#define CALL_RCU_DELAY_STEP_US	100
+
 /*
  * List of all call_rcu_data structures to keep valgrind happy.
  * Protected by call_rcu_mutex.
@@ -236,11 +299,238 @@ static void call_rcu_wake_up(struct call_rcu_data *crdp)
 	}
 }
 
-/* This is the code run by each call_rcu thread. */
+/*
+ * Pick the delay before the next batch: "idle" when the queue was found
+ * empty, "invoked" callbacks in the batch just done. Adaptive threads
+ * shorten it while batches are large, and lengthen it while idle.
+ */
+static void call_rcu_delay_update(struct call_rcu_data *crdp, int idle,
+		unsigned long invoked)
+{
+	unsigned long min_delay, max_delay, delay;
+
+	min_delay = CMM_LOAD_SHARED(crdp->attr.min_delay_us);
+	max_delay = CMM_LOAD_SHARED(crdp->attr.max_delay_us);
+	if (!CMM_LOAD_SHARED(crdp->attr.adaptive)) {
+		delay = max_delay;
+	} else {
+		delay = crdp->delay_us;
+		if (invoked >= CMM_LOAD_SHARED(crdp->attr.qlen_high))
+			delay /= 2;
+		else if (idle)
+			delay = caa_max(2 * delay, CALL_RCU_DELAY_STEP_US);
+		delay = caa_max(caa_min(delay, max_delay), min_delay);
+	}
+	CMM_STORE_SHARED(crdp->delay_us, delay);
+}
+
+static void call_rcu_sleep_us(unsigned long delay_us)
+{
+	struct timespec ts;
+
+	if (!delay_us)
+		return;
+	ts.tv_sec = delay_us / 1000000;
+	ts.tv_nsec = (delay_us % 1000000) * 1000;
+	(void) nanosleep(&ts, NULL);
+}
+
+/* Let callbacks accumulate before splicing the next batch. */
+static void call_rcu_delay(struct call_rcu_data *crdp)
+{
+	call_rcu_sleep_us(crdp->delay_us);
+}
+
+static void call_rcu_thread_register(struct call_rcu_data *crdp)
+{
+	rcu_register_thread();
+	if (crdp->gp_ops)
+		crdp->gp_ops->register_thread(crdp->gp_arg);
+}
+
+static void call_rcu_thread_unregister(struct call_rcu_data *crdp)
+{
+	if (crdp->gp_ops)
+		crdp->gp_ops->unregister_thread(crdp->gp_arg);
+	rcu_unregister_thread();
+}
+
+static void call_rcu_thread_synchronize(struct call_rcu_data *crdp)
+{
+	if (crdp->gp_ops)
+		crdp->gp_ops->synchronize(crdp->gp_arg);
+	else
+		synchronize_rcu();
+}
+
+/*
+ * Invoke the callbacks of "head", whose grace period has elapsed, within
+ * the thread's max_batch and batch_time_us limits. Returns the number of
+ * callbacks invoked; the others are left in "head".
+ */
+static unsigned long call_rcu_invoke(struct call_rcu_data *crdp,
+		struct cds_wfcq_head *head, struct cds_wfcq_tail *tail)
+{
+	unsigned long max_batch, batch_time_us, invoked = 0;
+	struct cds_wfcq_node *cbs;
+	uint64_t deadline = 0;
+
+	max_batch = CMM_LOAD_SHARED(crdp->attr.max_batch);
+	batch_time_us = CMM_LOAD_SHARED(crdp->attr.batch_time_us);
+	if (batch_time_us)
+		deadline = urcu_spin_now() + batch_time_us * 1000ULL;
+	while ((cbs = __cds_wfcq_dequeue_blocking(head, tail)) != NULL) {
+		struct rcu_head *rhp;
+
+		rhp = caa_container_of(cbs, struct rcu_head, next);
+		rhp->func(rhp);
+		invoked++;
+		if (max_batch && invoked >= max_batch)
+			break;
+		if (deadline && urcu_spin_now() >= deadline)
+			break;
+	}
+	uatomic_sub(&crdp->qlen, invoked);
+	urcu_trace(RCU_TRACE_CALL_RCU_BATCH, invoked,
+		uatomic_read(&crdp->qlen));
+	return invoked;
+}
+
+static int call_rcu_seg_empty(struct call_rcu_data *crdp,
+		enum call_rcu_seg_idx idx)
+{
+	return cds_wfcq_empty(&crdp->seg[idx].head, &crdp->seg[idx].tail);
+}
+
+/* Append segment "from" to segment "to". */
+static void call_rcu_seg_move(struct call_rcu_data *crdp,
+		enum call_rcu_seg_idx from, enum call_rcu_seg_idx to)
+{
+	(void) __cds_wfcq_splice_blocking(&crdp->seg[to].head,
+		&crdp->seg[to].tail, &crdp->seg[from].head,
+		&crdp->seg[from].tail);
+	crdp->seg[to].seq = crdp->seg[from].seq;
+}
+
+/* Move the callbacks whose grace period has elapsed to the done segment. */
+static void call_rcu_segcb_advance(struct call_rcu_data *crdp)
+{
+	if (crdp->gp_ops)
+		return;
+	if (!call_rcu_seg_empty(crdp, CALL_RCU_WAIT_SEG)
+			&& poll_state_synchronize_rcu(
+				crdp->seg[CALL_RCU_WAIT_SEG].seq))
+		call_rcu_seg_move(crdp, CALL_RCU_WAIT_SEG, CALL_RCU_DONE_SEG);
+	if (!call_rcu_seg_empty(crdp, CALL_RCU_NEXT_READY_SEG)
+			&& poll_state_synchronize_rcu(
+				crdp->seg[CALL_RCU_NEXT_READY_SEG].seq))
+		call_rcu_seg_move(crdp, CALL_RCU_NEXT_READY_SEG,
+			CALL_RCU_DONE_SEG);
+	if (call_rcu_seg_empty(crdp, CALL_RCU_WAIT_SEG))
+		call_rcu_seg_move(crdp, CALL_RCU_NEXT_READY_SEG,
+			CALL_RCU_WAIT_SEG);
+}
+
+/*
+ * Splice the callbacks queued since the last call into a waiting
+ * segment, tagged with the grace period they need, and request that
+ * grace period from the poll worker. Grace periods are requested at
+ * most every delay_us, so that callbacks keep accumulating meanwhile;
+ * callbacks needing a grace period not requested yet stay queued.
+ * Threads with their own grace period primitives wait for one segment
+ * at a time.
+ */
+static void call_rcu_segcb_accelerate(struct call_rcu_data *crdp)
+{
+	enum call_rcu_seg_idx idx;
+	unsigned long seq;
+	uint64_t now;
+	int throttled, fresh;
+
+	if (cds_wfcq_empty(&crdp->cbs_head, &crdp->cbs_tail))
+		return;
+	now = urcu_spin_now();
+	throttled = crdp->delay_us
+		&& now - crdp->gp_start_ns < crdp->delay_us * 1000ULL;
+	if (crdp->gp_ops) {
+		if (throttled || !call_rcu_seg_empty(crdp, CALL_RCU_WAIT_SEG))
+			return;
+		(void) __cds_wfcq_splice_blocking(
+			&crdp->seg[CALL_RCU_WAIT_SEG].head,
+			&crdp->seg[CALL_RCU_WAIT_SEG].tail,
+			&crdp->cbs_head, &crdp->cbs_tail);
+		crdp->gp_start_ns = now;
+		return;
+	}
+
+	/* Merge into the last waiting segment if it needs the same one. */
+	if (!call_rcu_seg_empty(crdp, CALL_RCU_NEXT_READY_SEG))
+		idx = CALL_RCU_NEXT_READY_SEG;
+	else if (!call_rcu_seg_empty(crdp, CALL_RCU_WAIT_SEG))
+		idx = CALL_RCU_WAIT_SEG;
+	else
+		idx = CALL_RCU_DONE_SEG;
+	if (idx != CALL_RCU_DONE_SEG
+			&& crdp->seg[idx].seq == rcu_gp_seq_snap()) {
+		fresh = 0;
+	} else {
+		if (throttled)
+			return;
+		/* Otherwise, the last segment waits longer. */
+		fresh = idx != CALL_RCU_NEXT_READY_SEG;
+		if (fresh)
+			idx++;
+	}
+	(void) __cds_wfcq_splice_blocking(&crdp->seg[idx].head,
+		&crdp->seg[idx].tail, &crdp->cbs_head, &crdp->cbs_tail);
+	/* Order the splice before reading the sequence. */
+	seq = get_state_synchronize_rcu();
+	if (!fresh && seq == crdp->seg[idx].seq)
+		return;
+	crdp->seg[idx].seq = seq;
+	crdp->gp_start_ns = now;
+	if (!rcu_gp_seq_done(seq))
+		gp_poll_worker_request(seq);
+}
+
+/*
+ * Wait for the grace period of the waiting segment. QSBR call_rcu
+ * threads are offline meanwhile.
+ */
+static void call_rcu_segcb_wait(struct call_rcu_data *crdp)
+{
+	if (crdp->gp_ops) {
+		call_rcu_thread_synchronize(crdp);
+		call_rcu_seg_move(crdp, CALL_RCU_WAIT_SEG, CALL_RCU_DONE_SEG);
+		return;
+	}
+	rcu_thread_offline();
+	(void) gp_poll_wait(crdp->seg[CALL_RCU_WAIT_SEG].seq, 0);
+	rcu_thread_online();
+	call_rcu_segcb_advance(crdp);
+}
+
+/* Wait until the next grace period may be requested. */
+static void call_rcu_segcb_throttle(struct call_rcu_data *crdp)
+{
+	uint64_t next, now;
+
+	next = crdp->gp_start_ns + crdp->delay_us * 1000ULL;
+	now = urcu_spin_now();
+	if (now < next)
+		call_rcu_sleep_us((next - now + 999) / 1000);
+}
+
+/*
+ * This is the code run by each call_rcu thread. Callbacks go through
+ * the segments of the thread: the grace period of the waiting segments
+ * is performed by the poll worker while the thread invokes the
+ * callbacks of the done segment.
+ */
 
 static void *call_rcu_thread(void *arg)
 {
-	unsigned long cbcount;
+	unsigned long cbcount = 0;
 	struct call_rcu_data *crdp = (struct call_rcu_data *) arg;
 	int rt = !!(uatomic_read(&crdp->flags) & URCU_CALL_RCU_RT);
 	int ret;
@@ -252,20 +542,20 @@ static void *call_rcu_thread(void *arg)
 	/*
 	 * If callbacks take a read-side lock, we need to be registered.
 	 */
-	rcu_register_thread();
+	call_rcu_thread_register(crdp);
 
-	URCU_TLS(thread_call_rcu_data) = crdp;
+	/*
+	 * call_rcu() invoked from callbacks waits for the flavor's grace
+	 * periods, so it can only be handed to flavor call_rcu threads.
+	 */
+	if (!crdp->gp_ops)
+		URCU_TLS(thread_call_rcu_data) = crdp;
 	if (!rt) {
 		uatomic_dec(&crdp->futex);
 		/* Decrement futex before reading call_rcu list */
 		cmm_smp_mb();
 	}
 	for (;;) {
-		struct cds_wfcq_head cbs_tmp_head;
-		struct cds_wfcq_tail cbs_tmp_tail;
-		struct cds_wfcq_node *cbs, *cbs_tmp_n;
-		enum cds_wfcq_ret splice_ret;
-
 		if (uatomic_read(&crdp->flags) & URCU_CALL_RCU_PAUSE) {
 			/*
 			 * Pause requested. Become quiescent: remove
@@ -273,52 +563,60 @@ static void *call_rcu_thread(void *arg)
 			 * process any callback. The callback lists may
 			 * still be non-empty though.
 			 */
-			rcu_unregister_thread();
+			call_rcu_thread_unregister(crdp);
 			cmm_smp_mb__before_uatomic_or();
 			uatomic_or(&crdp->flags, URCU_CALL_RCU_PAUSED);
 			while ((uatomic_read(&crdp->flags) & URCU_CALL_RCU_PAUSE) != 0)
 				poll(NULL, 0, 1);
-			rcu_register_thread();
+			call_rcu_thread_register(crdp);
 		}
 
-		cds_wfcq_init(&cbs_tmp_head, &cbs_tmp_tail);
-		splice_ret = __cds_wfcq_splice_blocking(&cbs_tmp_head,
-			&cbs_tmp_tail, &crdp->cbs_head, &crdp->cbs_tail);
-		assert(splice_ret != CDS_WFCQ_RET_WOULDBLOCK);
-		assert(splice_ret != CDS_WFCQ_RET_DEST_NON_EMPTY);
-		if (splice_ret != CDS_WFCQ_RET_SRC_EMPTY) {
-			synchronize_rcu();
-			cbcount = 0;
-			__cds_wfcq_for_each_blocking_safe(&cbs_tmp_head,
-					&cbs_tmp_tail, cbs, cbs_tmp_n) {
-				struct rcu_head *rhp;
-
-				rhp = caa_container_of(cbs,
-					struct rcu_head, next);
-				rhp->func(rhp);
-				cbcount++;
+		call_rcu_segcb_advance(crdp);
+		call_rcu_segcb_accelerate(crdp);
+		if (!call_rcu_seg_empty(crdp, CALL_RCU_DONE_SEG)) {
+			cbcount += call_rcu_invoke(crdp,
+				&crdp->seg[CALL_RCU_DONE_SEG].head,
+				&crdp->seg[CALL_RCU_DONE_SEG].tail);
+			if (call_rcu_seg_empty(crdp, CALL_RCU_DONE_SEG)) {
+				call_rcu_delay_update(crdp,
+					cds_wfcq_empty(&crdp->cbs_head,
+						&crdp->cbs_tail)
+					&& call_rcu_seg_empty(crdp,
+						CALL_RCU_WAIT_SEG),
+					cbcount);
+				cbcount = 0;
 			}
-			uatomic_sub(&crdp->qlen, cbcount);
+			/*
+			 * Report a quiescent state, so that the grace
+			 * periods requested meanwhile are not held back
+			 * by the next callbacks, and let other threads
+			 * run if the batch limit was reached.
+			 */
+			rcu_thread_offline();
+			if (!call_rcu_seg_empty(crdp, CALL_RCU_DONE_SEG))
+				sched_yield();
+			rcu_thread_online();
+			continue;
+		}
+		if (!call_rcu_seg_empty(crdp, CALL_RCU_WAIT_SEG)) {
+			call_rcu_segcb_wait(crdp);
+			continue;
 		}
 		if (uatomic_read(&crdp->flags) & URCU_CALL_RCU_STOP)
 			break;
 		rcu_thread_offline();
-		if (!rt) {
-			if (cds_wfcq_empty(&crdp->cbs_head,
-					&crdp->cbs_tail)) {
-				call_rcu_wait(crdp);
-				poll(NULL, 0, 10);
-				uatomic_dec(&crdp->futex);
-				/*
-				 * Decrement futex before reading
-				 * call_rcu list.
-				 */
-				cmm_smp_mb();
-			} else {
-				poll(NULL, 0, 10);
-			}
+		if (!cds_wfcq_empty(&crdp->cbs_head, &crdp->cbs_tail)) {
+			call_rcu_segcb_throttle(crdp);
+		} else if (!rt) {
+			urcu_trace(RCU_TRACE_CALL_RCU_SLEEP, 0, 0);
+			call_rcu_wait(crdp);
+			urcu_trace(RCU_TRACE_CALL_RCU_WAKE, 0, 0);
+			call_rcu_delay(crdp);
+			uatomic_dec(&crdp->futex);
+			/* Decrement futex before reading call_rcu list. */
+			cmm_smp_mb();
 		} else {
-			poll(NULL, 0, 10);
+			call_rcu_delay(crdp);
 		}
 		rcu_thread_online();
 	}
@@ -330,38 +628,462 @@ static void *call_rcu_thread(void *arg)
 		uatomic_set(&crdp->futex, 0);
 	}
 	uatomic_or(&crdp->flags, URCU_CALL_RCU_STOPPED);
+	call_rcu_thread_unregister(crdp);
+	return NULL;
+}
+
+static void call_rcu_thread_create(struct call_rcu_data *crdp)
+{
+	int ret;
+
+	ret = pthread_create(&crdp->tid, NULL, call_rcu_thread, crdp);
+	if (ret)
+		urcu_die(ret);
+}
+
+/*
+ * Pool of threads servicing the per-CPU call_rcu_data queues created by
+ * create_all_cpu_call_rcu_data_pool(), in place of a thread per queue.
+ * One worker at a time runs a round: it moves the callbacks of every
+ * queue to their gp list, waits for a single grace period for all of
+ * them, and makes them ready. Workers invoke ready callbacks by chunks,
+ * taken from the queues of their own CPUs first, and otherwise stolen
+ * from the most loaded queue. Chunks of a queue are invoked concurrently,
+ * except rcu_barrier() markers, which wait for the callbacks before them.
+ */
+
+/* Callbacks taken at once from a queue, unless limited by max_batch. */
+#define CALL_RCU_POOL_CHUNK	256
+
+struct call_rcu_pool_worker {
+	struct call_rcu_pool *pool;
+	pthread_t tid;
+	int index;
+};
+
+struct call_rcu_pool {
+	pthread_mutex_t mutex;
+	/* Protected by mutex. */
+	struct call_rcu_data **queues;	/* Indexed by CPU, nr_cpus entries. */
+	long nr_cpus;
+	unsigned long nr_queues;
+	unsigned long flags;		/* URCU_CALL_RCU_RT, _STOP, _PAUSE. */
+	int gp_running;			/* A worker is running a round. */
+	int nr_paused;
+	int32_t futex;
+	struct call_rcu_pool_worker *workers;
+	int nr_workers;
+};
+
+/* Protected by call_rcu_mutex. */
+static struct call_rcu_pool *call_rcu_pool;
+
+static DEFINE_URCU_TLS(int, call_rcu_pool_worker_thread);
+
+static void call_rcu_barrier_func(struct rcu_head *head);
+
+static int call_rcu_is_barrier(struct cds_wfcq_node *node)
+{
+	return caa_container_of(node, struct rcu_head, next)->func
+		== call_rcu_barrier_func;
+}
+
+/*
+ * Whether "crdp" has ready callbacks a worker may take: not a barrier
+ * marker while other workers invoke callbacks queued before it. Pool
+ * mutex held.
+ */
+static int call_rcu_pool_can_take(struct call_rcu_data *crdp)
+{
+	struct cds_wfcq_node *node;
+
+	if (crdp->removing)
+		return 0;
+	node = __cds_wfcq_first_blocking(&crdp->ready_head,
+			&crdp->ready_tail);
+	return node && !(crdp->busy && call_rcu_is_barrier(node));
+}
+
+static void call_rcu_pool_wake(struct call_rcu_pool *pool)
+{
+	/* Write to call_rcu list before reading/writing futex */
+	cmm_smp_mb();
+	if (caa_unlikely(uatomic_read(&pool->futex) == -1)) {
+		uatomic_set(&pool->futex, 0);
+		futex_async(&pool->futex, FUTEX_WAKE, INT_MAX,
+		      NULL, NULL, 0);
+	}
+}
+
+/* Queue to take ready callbacks from, or NULL. Pool mutex held. */
+static struct call_rcu_data *call_rcu_pool_pick(
+		struct call_rcu_pool_worker *worker)
+{
+	struct call_rcu_pool *pool = worker->pool;
+	struct call_rcu_data *crdp, *best = NULL;
+	long cpu;
+
+	for (cpu = 0; cpu < pool->nr_cpus; cpu++) {
+		crdp = pool->queues[cpu];
+		if (!crdp || !call_rcu_pool_can_take(crdp))
+			continue;
+		if (cpu % pool->nr_workers == worker->index)
+			return crdp;
+		if (!best || uatomic_read(&crdp->qlen)
+				> uatomic_read(&best->qlen))
+			best = crdp;
+	}
+	return best;
+}
+
+/*
+ * Move a chunk of ready callbacks of "crdp" to "head", ending before a
+ * barrier marker, which is taken on its own. Pool mutex held.
+ */
+static void call_rcu_pool_take(struct call_rcu_data *crdp,
+		struct cds_wfcq_head *head, struct cds_wfcq_tail *tail)
+{
+	struct cds_wfcq_node *node;
+	unsigned long chunk, i;
+
+	chunk = CMM_LOAD_SHARED(crdp->attr.max_batch);
+	if (!chunk)
+		chunk = CALL_RCU_POOL_CHUNK;
+	for (i = 0; i < chunk; i++) {
+		node = __cds_wfcq_first_blocking(&crdp->ready_head,
+				&crdp->ready_tail);
+		if (!node || (i && call_rcu_is_barrier(node)))
+			break;
+		node = __cds_wfcq_dequeue_blocking(&crdp->ready_head,
+				&crdp->ready_tail);
+		cds_wfcq_node_init(node);
+		cds_wfcq_enqueue(head, tail, node);
+		if (call_rcu_is_barrier(node))
+			break;
+	}
+}
+
+/* Whether a round has callbacks to wait for. Pool mutex held. */
+static int call_rcu_pool_pending(struct call_rcu_pool *pool)
+{
+	struct call_rcu_data *crdp;
+	long cpu;
+
+	for (cpu = 0; cpu < pool->nr_cpus; cpu++) {
+		crdp = pool->queues[cpu];
+		if (crdp && !crdp->removing
+				&& !cds_wfcq_empty(&crdp->cbs_head,
+					&crdp->cbs_tail))
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Delay before each round: the shortest max_delay_us of the queues.
+ * Adaptive delays are not supported by pools. Pool mutex held.
+ */
+static unsigned long call_rcu_pool_delay_us(struct call_rcu_pool *pool)
+{
+	unsigned long delay_us = ULONG_MAX;
+	struct call_rcu_data *crdp;
+	long cpu;
+
+	for (cpu = 0; cpu < pool->nr_cpus; cpu++) {
+		crdp = pool->queues[cpu];
+		if (crdp)
+			delay_us = caa_min(delay_us,
+				CMM_LOAD_SHARED(crdp->attr.max_delay_us));
+	}
+	return delay_us == ULONG_MAX ? 0 : delay_us;
+}
+
+/*
+ * Wait for one grace period for the callbacks of all queues. Called and
+ * returns with the pool mutex held, which is released meanwhile.
+ */
+static void call_rcu_pool_round(struct call_rcu_pool *pool)
+{
+	struct call_rcu_data *crdp;
+	unsigned long delay_us;
+	long cpu;
+
+	pool->gp_running = 1;
+	delay_us = call_rcu_pool_delay_us(pool);
+	if (delay_us) {
+		call_rcu_unlock(&pool->mutex);
+		call_rcu_sleep_us(delay_us);
+		call_rcu_lock(&pool->mutex);
+	}
+	for (cpu = 0; cpu < pool->nr_cpus; cpu++) {
+		crdp = pool->queues[cpu];
+		if (!crdp || crdp->removing)
+			continue;
+		(void) __cds_wfcq_splice_blocking(&crdp->gp_head,
+			&crdp->gp_tail, &crdp->cbs_head, &crdp->cbs_tail);
+	}
+	call_rcu_unlock(&pool->mutex);
+	synchronize_rcu();
+	call_rcu_lock(&pool->mutex);
+	/* Queues are not removed while a round is running. */
+	for (cpu = 0; cpu < pool->nr_cpus; cpu++) {
+		crdp = pool->queues[cpu];
+		if (!crdp)
+			continue;
+		(void) __cds_wfcq_splice_blocking(&crdp->ready_head,
+			&crdp->ready_tail, &crdp->gp_head, &crdp->gp_tail);
+	}
+	pool->gp_running = 0;
+}
+
+/*
+ * Pool workers are registered, and stay offline except while invoking
+ * callbacks, so that QSBR workers never hold back grace periods while
+ * idle or between chunks.
+ */
+static void *call_rcu_pool_thread(void *arg)
+{
+	struct call_rcu_pool_worker *worker = arg;
+	struct call_rcu_pool *pool = worker->pool;
+	int rt = !!(pool->flags & URCU_CALL_RCU_RT);
+	struct cds_wfcq_head cbs_head;
+	struct cds_wfcq_tail cbs_tail;
+	struct call_rcu_data *crdp;
+	unsigned long delay_us;
+
+	URCU_TLS(call_rcu_pool_worker_thread) = 1;
+	rcu_register_thread();
+	rcu_thread_offline();
+	cds_wfcq_init(&cbs_head, &cbs_tail);
+	call_rcu_lock(&pool->mutex);
+	for (;;) {
+		if (pool->flags & URCU_CALL_RCU_STOP)
+			break;
+		if (pool->flags & URCU_CALL_RCU_PAUSE) {
+			/* Same as call_rcu threads, see call_rcu_thread(). */
+			pool->nr_paused++;
+			call_rcu_unlock(&pool->mutex);
+			rcu_unregister_thread();
+			while ((uatomic_read(&pool->flags) & URCU_CALL_RCU_PAUSE) != 0)
+				poll(NULL, 0, 1);
+			rcu_register_thread();
+			rcu_thread_offline();
+			call_rcu_lock(&pool->mutex);
+			pool->nr_paused--;
+			continue;
+		}
+		crdp = call_rcu_pool_pick(worker);
+		if (crdp) {
+			call_rcu_pool_take(crdp, &cbs_head, &cbs_tail);
+			crdp->busy++;
+			call_rcu_unlock(&pool->mutex);
+			rcu_thread_online();
+			for (;;) {
+				(void) call_rcu_invoke(crdp, &cbs_head, &cbs_tail);
+				if (cds_wfcq_empty(&cbs_head, &cbs_tail))
+					break;
+				rcu_thread_offline();
+				sched_yield();
+				rcu_thread_online();
+			}
+			rcu_thread_offline();
+			call_rcu_lock(&pool->mutex);
+			crdp->busy--;
+			continue;
+		}
+		if (!pool->gp_running && call_rcu_pool_pending(pool)) {
+			call_rcu_pool_round(pool);
+			/* Share the ready callbacks with the other workers. */
+			call_rcu_pool_wake(pool);
+			continue;
+		}
+		if (rt) {
+			delay_us = call_rcu_pool_delay_us(pool);
+			call_rcu_unlock(&pool->mutex);
+			call_rcu_sleep_us(delay_us ? delay_us : 1000);
+			call_rcu_lock(&pool->mutex);
+			continue;
+		}
+		uatomic_set(&pool->futex, -1);
+		/* Set futex before reading the queues again. */
+		cmm_smp_mb();
+		if (call_rcu_pool_pick(worker)
+				|| (!pool->gp_running
+					&& call_rcu_pool_pending(pool)))
+			continue;
+		call_rcu_unlock(&pool->mutex);
+		futex_async(&pool->futex, FUTEX_WAIT, -1, NULL, NULL, 0);
+		call_rcu_lock(&pool->mutex);
+	}
+	call_rcu_unlock(&pool->mutex);
 	rcu_unregister_thread();
 	return NULL;
 }
 
+/* Mark the CPUs the process may run on, and return their number. */
+static long call_rcu_pool_allowed_cpus(char *allowed, long nr_cpus)
+{
+	long cpu, nr = 0;
+#ifdef CALL_RCU_HAVE_AFFINITY_MASK
+	cpu_set_t mask;
+
+	if (!sched_getaffinity(0, sizeof(mask), &mask)) {
+		for (cpu = 0; cpu < nr_cpus; cpu++) {
+			allowed[cpu] = cpu < CPU_SETSIZE && CPU_ISSET(cpu, &mask);
+			nr += allowed[cpu];
+		}
+		if (nr)
+			return nr;
+	}
+#endif
+	for (cpu = 0; cpu < nr_cpus; cpu++)
+		allowed[cpu] = 1;
+	return nr_cpus;
+}
+
+static struct call_rcu_pool *call_rcu_pool_alloc(unsigned long flags,
+		long nr_cpus, int nr_workers)
+{
+	struct call_rcu_pool *pool;
+	int ret;
+
+	pool = calloc(1, sizeof(*pool));
+	if (!pool)
+		return NULL;
+	pool->queues = calloc(nr_cpus, sizeof(*pool->queues));
+	pool->workers = calloc(nr_workers, sizeof(*pool->workers));
+	if (!pool->queues || !pool->workers) {
+		free(pool->queues);
+		free(pool->workers);
+		free(pool);
+		return NULL;
+	}
+	ret = pthread_mutex_init(&pool->mutex, NULL);
+	if (ret)
+		urcu_die(ret);
+	pool->nr_cpus = nr_cpus;
+	pool->nr_workers = nr_workers;
+	pool->flags = flags & URCU_CALL_RCU_RT;
+	return pool;
+}
+
+static void call_rcu_pool_free(struct call_rcu_pool *pool)
+{
+	int ret;
+
+	ret = pthread_mutex_destroy(&pool->mutex);
+	if (ret)
+		urcu_die(ret);
+	free(pool->queues);
+	free(pool->workers);
+	free(pool);
+}
+
+static void call_rcu_pool_start(struct call_rcu_pool *pool)
+{
+	int i, ret;
+
+	for (i = 0; i < pool->nr_workers; i++) {
+		pool->workers[i].pool = pool;
+		pool->workers[i].index = i;
+		ret = pthread_create(&pool->workers[i].tid, NULL,
+				call_rcu_pool_thread, &pool->workers[i]);
+		if (ret)
+			urcu_die(ret);
+	}
+}
+
+/*
+ * Stop servicing "crdp", once no worker uses it. Removing the last queue
+ * stops the workers and frees the pool.
+ */
+static void call_rcu_pool_remove(struct call_rcu_data *crdp)
+{
+	struct call_rcu_pool *pool = crdp->pool;
+	int i, ret, last;
+
+	call_rcu_lock(&pool->mutex);
+	crdp->removing = 1;
+	while (crdp->busy || pool->gp_running) {
+		call_rcu_unlock(&pool->mutex);
+		poll(NULL, 0, 1);
+		call_rcu_lock(&pool->mutex);
+	}
+	pool->queues[crdp->cpu_affinity] = NULL;
+	last = !--pool->nr_queues;
+	if (last)
+		pool->flags |= URCU_CALL_RCU_STOP;
+	call_rcu_unlock(&pool->mutex);
+	crdp->pool = NULL;
+	if (!last)
+		return;
+
+	call_rcu_lock(&call_rcu_mutex);
+	if (call_rcu_pool == pool)
+		call_rcu_pool = NULL;
+	call_rcu_unlock(&call_rcu_mutex);
+	call_rcu_pool_wake(pool);
+	for (i = 0; i < pool->nr_workers; i++) {
+		ret = pthread_join(pool->workers[i].tid, NULL);
+		if (ret)
+			urcu_die(ret);
+	}
+	call_rcu_pool_free(pool);
+}
+
+/* Wait for the workers to be paused, across fork. */
+static void call_rcu_pool_pause(struct call_rcu_pool *pool)
+{
+	call_rcu_lock(&pool->mutex);
+	uatomic_or(&pool->flags, URCU_CALL_RCU_PAUSE);
+	call_rcu_unlock(&pool->mutex);
+	call_rcu_pool_wake(pool);
+	while (uatomic_read(&pool->nr_paused) != pool->nr_workers)
+		poll(NULL, 0, 1);
+}
+
 /*
  * Create both a call_rcu thread and the corresponding call_rcu_data
  * structure, linking the structure in as specified.  Caller must hold
- * call_rcu_mutex.
+ * call_rcu_mutex. Queues serviced by a pool get no thread of their own.
  */
 
 static void call_rcu_data_init(struct call_rcu_data **crdpp,
 			       unsigned long flags,
-			       int cpu_affinity)
+			       int cpu_affinity,
+			       const struct call_rcu_attr *attr,
+			       const struct call_rcu_gp_ops *gp_ops,
+			       void *gp_arg,
+			       struct call_rcu_pool *pool)
 {
+	static const struct call_rcu_attr default_attr =
+		URCU_CALL_RCU_ATTR_INIT;
 	struct call_rcu_data *crdp;
-	int ret;
+	int i;
 
 	crdp = malloc(sizeof(*crdp));
 	if (crdp == NULL)
 		urcu_die(errno);
 	memset(crdp, '\0', sizeof(*crdp));
 	cds_wfcq_init(&crdp->cbs_head, &crdp->cbs_tail);
+	for (i = 0; i < CALL_RCU_NR_SEGS; i++)
+		cds_wfcq_init(&crdp->seg[i].head, &crdp->seg[i].tail);
 	crdp->qlen = 0;
 	crdp->futex = 0;
 	crdp->flags = flags;
 	cds_list_add(&crdp->list, &call_rcu_data_list);
 	crdp->cpu_affinity = cpu_affinity;
+	crdp->gp_ops = gp_ops;
+	crdp->gp_arg = gp_arg;
+	crdp->attr = attr ? *attr : default_attr;
+	crdp->delay_us = crdp->attr.max_delay_us;
+	cds_wfcq_init(&crdp->gp_head, &crdp->gp_tail);
+	cds_wfcq_init(&crdp->ready_head, &crdp->ready_tail);
+	crdp->pool = pool;
 	cmm_smp_mb();  /* Structure initialized before pointer is planted. */
 	*crdpp = crdp;
-	ret = pthread_create(&crdp->tid, NULL, call_rcu_thread, crdp);
-	if (ret)
-		urcu_die(ret);
+	if (!pool)
+		call_rcu_thread_create(crdp);
 }
 
 /*
@@ -393,7 +1115,8 @@ struct call_rcu_data *get_cpu_call_rcu_data(int cpu)
 
 /*
  * Return the tid corresponding to the call_rcu thread whose
- * call_rcu_data structure is specified.
+ * call_rcu_data structure is specified. For queues serviced by a pool,
+ * this is one of the pool's threads.
  */
 
 pthread_t get_call_rcu_thread(struct call_rcu_data *crdp)
@@ -406,21 +1129,90 @@ pthread_t get_call_rcu_thread(struct call_rcu_data *crdp)
  */
 
 static struct call_rcu_data *__create_call_rcu_data(unsigned long flags,
-						    int cpu_affinity)
+						    int cpu_affinity,
+						    const struct call_rcu_attr *attr)
 {
 	struct call_rcu_data *crdp;
 
-	call_rcu_data_init(&crdp, flags, cpu_affinity);
+	call_rcu_data_init(&crdp, flags, cpu_affinity, attr, NULL, NULL, NULL);
 	return crdp;
 }
 
 struct call_rcu_data *create_call_rcu_data(unsigned long flags,
 					   int cpu_affinity)
+{
+	return create_call_rcu_data_attr(flags, cpu_affinity, NULL);
+}
+
+static int call_rcu_attr_check(const struct call_rcu_attr *attr)
+{
+	if (attr && attr->min_delay_us > attr->max_delay_us)
+		return -EINVAL;
+	return 0;
+}
+
+/*
+ * Same as create_call_rcu_data(), tuned by "attr", or with the default
+ * attributes if NULL. Returns NULL with errno set to EINVAL if "attr"
+ * is invalid.
+ */
+struct call_rcu_data *create_call_rcu_data_attr(unsigned long flags,
+		int cpu_affinity, const struct call_rcu_attr *attr)
+{
+	struct call_rcu_data *crdp;
+
+	if (call_rcu_attr_check(attr)) {
+		errno = EINVAL;
+		return NULL;
+	}
+	call_rcu_lock(&call_rcu_mutex);
+	crdp = __create_call_rcu_data(flags, cpu_affinity, attr);
+	call_rcu_unlock(&call_rcu_mutex);
+	return crdp;
+}
+
+/*
+ * Change the tuning of a call_rcu thread, such as the default or a
+ * per-CPU one. Takes effect after its current batch.
+ */
+int call_rcu_data_set_attr(struct call_rcu_data *crdp,
+		const struct call_rcu_attr *attr)
+{
+	if (!crdp || !attr || call_rcu_attr_check(attr))
+		return -EINVAL;
+	call_rcu_lock(&call_rcu_mutex);
+	CMM_STORE_SHARED(crdp->attr.min_delay_us, attr->min_delay_us);
+	CMM_STORE_SHARED(crdp->attr.max_delay_us, attr->max_delay_us);
+	CMM_STORE_SHARED(crdp->attr.adaptive, attr->adaptive);
+	CMM_STORE_SHARED(crdp->attr.qlen_high, attr->qlen_high);
+	CMM_STORE_SHARED(crdp->attr.max_batch, attr->max_batch);
+	CMM_STORE_SHARED(crdp->attr.batch_time_us, attr->batch_time_us);
+	call_rcu_unlock(&call_rcu_mutex);
+	return 0;
+}
+
+void call_rcu_data_get_attr(struct call_rcu_data *crdp,
+		struct call_rcu_attr *attr)
+{
+	call_rcu_lock(&call_rcu_mutex);
+	*attr = crdp->attr;
+	call_rcu_unlock(&call_rcu_mutex);
+	attr->cur_delay_us = CMM_LOAD_SHARED(crdp->delay_us);
+}
+
+/*
+ * Create a call_rcu_data structure (with thread) waiting for grace
+ * periods through "gp_ops" instead of the flavor's synchronize_rcu().
+ * It is only used by the call_rcu_data_enqueue() callers holding it.
+ */
+static __attribute__((unused))
+struct call_rcu_data *create_call_rcu_data_gp(unsigned long flags,
+		const struct call_rcu_gp_ops *gp_ops, void *gp_arg)
 {
 	struct call_rcu_data *crdp;
 
 	call_rcu_lock(&call_rcu_mutex);
-	crdp = __create_call_rcu_data(flags, cpu_affinity);
+	call_rcu_data_init(&crdp, flags, -1, NULL, gp_ops, gp_arg, NULL);
 	call_rcu_unlock(&call_rcu_mutex);
 	return crdp;
 }
@@ -486,7 +1278,8 @@ struct call_rcu_data *get_default_call_rcu_data(void)
 		call_rcu_unlock(&call_rcu_mutex);
 		return default_call_rcu_data;
 	}
-	call_rcu_data_init(&default_call_rcu_data, 0, -1);
+	call_rcu_data_init(&default_call_rcu_data, 0, -1, NULL, NULL, NULL,
+			   NULL);
 	call_rcu_unlock(&call_rcu_mutex);
 	return default_call_rcu_data;
 }
@@ -574,7 +1367,7 @@ int create_all_cpu_call_rcu_data(unsigned long flags)
 			call_rcu_unlock(&call_rcu_mutex);
 			continue;
 		}
-		crdp = __create_call_rcu_data(flags, i);
+		crdp = __create_call_rcu_data(flags, i, NULL);
 		if (crdp == NULL) {
 			call_rcu_unlock(&call_rcu_mutex);
 			errno = ENOMEM;
@@ -594,13 +1387,93 @@ int create_all_cpu_call_rcu_data(unsigned long flags)
 	return 0;
 }
 
+/*
+ * Same as create_all_cpu_call_rcu_data(), but for the CPUs the calling
+ * process may run on only, and with a pool of "nr_workers" threads
+ * servicing all of the per-CPU call_rcu_data structures created, rather
+ * than one thread each. If "nr_workers" is 0, the pool has one thread
+ * per CPU the process may run on. Only one pool may exist at a time;
+ * free_all_cpu_call_rcu_data() also frees the pool.
+ */
+
+int create_all_cpu_call_rcu_data_pool(unsigned long flags, int nr_workers)
+{
+	struct call_rcu_pool *pool;
+	struct call_rcu_data *crdp;
+	char *allowed;
+	long cpu, nr_allowed;
+	int ret = 0;
+
+	if (nr_workers < 0) {
+		errno = EINVAL;
+		return -EINVAL;
+	}
+	call_rcu_lock(&call_rcu_mutex);
+	alloc_cpu_call_rcu_data();
+	if (maxcpus <= 0) {
+		ret = -EINVAL;
+		goto end;
+	}
+	if (per_cpu_call_rcu_data == NULL) {
+		ret = -ENOMEM;
+		goto end;
+	}
+	if (call_rcu_pool) {
+		ret = -EBUSY;
+		goto end;
+	}
+	allowed = malloc(maxcpus);
+	if (!allowed) {
+		ret = -ENOMEM;
+		goto end;
+	}
+	nr_allowed = call_rcu_pool_allowed_cpus(allowed, maxcpus);
+	if (!nr_workers)
+		nr_workers = nr_allowed;
+	pool = call_rcu_pool_alloc(flags, maxcpus, nr_workers);
+	if (!pool) {
+		free(allowed);
+		ret = -ENOMEM;
+		goto end;
+	}
+	for (cpu = 0; cpu < maxcpus; cpu++) {
+		if (!allowed[cpu] || per_cpu_call_rcu_data[cpu])
+			continue;
+		call_rcu_data_init(&crdp, flags, cpu, NULL, NULL, NULL, pool);
+		pool->queues[cpu] = crdp;
+		pool->nr_queues++;
+	}
+	free(allowed);
+	if (!pool->nr_queues) {
+		/* Every CPU already has its call_rcu_data. */
+		call_rcu_pool_free(pool);
+		goto end;
+	}
+	call_rcu_pool_start(pool);
+	call_rcu_pool = pool;
+	for (cpu = 0; cpu < maxcpus; cpu++) {
+		crdp = pool->queues[cpu];
+		if (!crdp)
+			continue;
+		crdp->tid = pool->workers[0].tid;
+		rcu_set_pointer(&per_cpu_call_rcu_data[cpu], crdp);
+	}
+end:
+	call_rcu_unlock(&call_rcu_mutex);
+	if (ret)
+		errno = -ret;
+	return ret;
+}
+
 /*
  * Wake up the call_rcu thread corresponding to the specified
  * call_rcu_data structure.
  */
 static void wake_call_rcu_thread(struct call_rcu_data *crdp)
 {
-	if (!(_CMM_LOAD_SHARED(crdp->flags) & URCU_CALL_RCU_RT))
+	if (crdp->pool)
+		call_rcu_pool_wake(crdp->pool);
+	else if (!(_CMM_LOAD_SHARED(crdp->flags) & URCU_CALL_RCU_RT))
 		call_rcu_wake_up(crdp);
 }
 
@@ -619,22 +1492,120 @@ static void wake_call_rcu_thread(struct call_rcu_data *crdp)
  * call_rcu must be called by registered RCU read-side threads.
  */
 
-void call_rcu(struct rcu_head *head,
-	      void (*func)(struct rcu_head *head))
+static void call_rcu_data_enqueue(struct call_rcu_data *crdp,
+		struct rcu_head *head,
+		void (*func)(struct rcu_head *head))
 {
-	struct call_rcu_data *crdp;
-
 	cds_wfcq_node_init(&head->next);
 	head->func = func;
-	/* Holding rcu read-side lock across use of per-cpu crdp */
-	rcu_read_lock();
-	crdp = get_call_rcu_data();
 	cds_wfcq_enqueue(&crdp->cbs_head, &crdp->cbs_tail, &head->next);
 	uatomic_inc(&crdp->qlen);
 	wake_call_rcu_thread(crdp);
+}
+
+void call_rcu(struct rcu_head *head,
+	      void (*func)(struct rcu_head *head))
+{
+	/* Holding rcu read-side lock across use of per-cpu crdp */
+	rcu_read_lock();
+	call_rcu_data_enqueue(get_call_rcu_data(), head, func);
 	rcu_read_unlock();
 }
 
+/*
+ * rcu_barrier() queues one marker on each call_rcu_data. The last
+ * marker invoked wakes it up.
+ */
+struct call_rcu_barrier {
+	struct urcu_wait_node wait;
+	unsigned long count;	/* Markers not invoked yet. */
+};
+
+struct call_rcu_barrier_marker {
+	struct rcu_head head;
+	struct call_rcu_barrier *barrier;
+};
+
+static DEFINE_URCU_SPIN(barrier_spin);
+
+static void call_rcu_barrier_func(struct rcu_head *head)
+{
+	struct call_rcu_barrier_marker *marker =
+		caa_container_of(head, struct call_rcu_barrier_marker, head);
+	struct call_rcu_barrier *barrier = marker->barrier;
+
+	if (!uatomic_sub_return(&barrier->count, 1))
+		urcu_adaptative_wake_up(&barrier->wait);
+}
+
+/*
+ * Wait for all callbacks queued by call_rcu() and rcu_domain_call_rcu()
+ * before the call to be invoked. The markers are queued back to back
+ * and the call_rcu threads woken up together, so that the grace periods
+ * they wait for are shared rather than one per call_rcu thread.
+ *
+ * Must not be called from a read-side critical section, nor from a
+ * call_rcu callback, which would wait for itself. QSBR threads are put
+ * offline while waiting.
+ */
+void rcu_barrier(void)
+{
+	struct call_rcu_barrier barrier;
+	struct call_rcu_barrier_marker *markers;
+	struct call_rcu_data *crdp;
+	unsigned long nr = 0;
+	int was_online;
+
+	was_online = rcu_read_ongoing();
+	if (was_online)
+		rcu_thread_offline();
+	if (rcu_read_ongoing()) {
+		static int warned = 0;
+
+		if (!warned)
+			fprintf(stderr, "[error] liburcu: rcu_barrier() called from within RCU read-side critical section.\n");
+		warned = 1;
+		goto online;
+	}
+
+	/* Where call_rcu_data_free() moves the markers of freed threads. */
+	(void) get_default_call_rcu_data();
+
+	call_rcu_lock(&call_rcu_mutex);
+	cds_list_for_each_entry(crdp, &call_rcu_data_list, list) {
+		if (pthread_equal(crdp->tid, pthread_self())
+				|| URCU_TLS(call_rcu_pool_worker_thread)) {
+			static int warned = 0;
+
+			if (!warned)
+				fprintf(stderr, "[error] liburcu: rcu_barrier() called from a call_rcu callback.\n");
+			warned = 1;
+			call_rcu_unlock(&call_rcu_mutex);
+			goto online;
+		}
+		nr++;
+	}
+	markers = calloc(nr, sizeof(*markers));
+	if (!markers)
+		urcu_die(errno);
+	urcu_wait_node_init(&barrier.wait, URCU_WAIT_WAITING);
+	barrier.count = nr;
+	nr = 0;
+	cds_list_for_each_entry(crdp, &call_rcu_data_list, list) {
+		markers[nr].barrier = &barrier;
+		call_rcu_data_enqueue(crdp, &markers[nr].head,
+				call_rcu_barrier_func);
+		nr++;
+	}
+	call_rcu_unlock(&call_rcu_mutex);
+
+	urcu_adaptative_busy_wait(&barrier.wait, &barrier_spin);
+	free(markers);
+online:
+	if (was_online)
+		rcu_thread_online();
+}
+
 /*
  * Free up the specified call_rcu_data structure, terminating the
  * associated call_rcu thread.  The caller must have previously
@@ -663,18 +1634,52 @@ void call_rcu(struct rcu_head *head,
  */
 void call_rcu_data_free(struct call_rcu_data *crdp)
 {
+	int i;
+
 	if (crdp == NULL || crdp == default_call_rcu_data) {
 		return;
 	}
-	if ((uatomic_read(&crdp->flags) & URCU_CALL_RCU_STOPPED) == 0) {
+	if (crdp->pool) {
+		call_rcu_pool_remove(crdp);
+		/*
+		 * Ready callbacks go through another grace period, ahead
+		 * of the newer ones, which may be rcu_barrier() markers.
+		 */
+		(void) __cds_wfcq_splice_blocking(
+			&crdp->seg[CALL_RCU_DONE_SEG].head,
+			&crdp->seg[CALL_RCU_DONE_SEG].tail,
+			&crdp->ready_head, &crdp->ready_tail);
+	} else if ((uatomic_read(&crdp->flags) & URCU_CALL_RCU_STOPPED) == 0) {
 		uatomic_or(&crdp->flags, URCU_CALL_RCU_STOP);
 		wake_call_rcu_thread(crdp);
 		while ((uatomic_read(&crdp->flags) & URCU_CALL_RCU_STOPPED) == 0)
 			poll(NULL, 0, 1);
 	}
-	if (!cds_wfcq_empty(&crdp->cbs_head, &crdp->cbs_tail)) {
-		/* Create default call rcu data if need be */
+	/*
+	 * Callbacks left in the segments of a thread paused across fork(),
+	 * or ready in a pool queue, go first, through another grace period.
+	 */
+	for (i = CALL_RCU_WAIT_SEG; i < CALL_RCU_NR_SEGS; i++)
+		call_rcu_seg_move(crdp, i, CALL_RCU_DONE_SEG);
+	(void) __cds_wfcq_splice_blocking(&crdp->seg[CALL_RCU_DONE_SEG].head,
+		&crdp->seg[CALL_RCU_DONE_SEG].tail,
+		&crdp->cbs_head, &crdp->cbs_tail);
+	(void) __cds_wfcq_splice_blocking(&crdp->cbs_head, &crdp->cbs_tail,
+		&crdp->seg[CALL_RCU_DONE_SEG].head,
+		&crdp->seg[CALL_RCU_DONE_SEG].tail);
+
+	/* Create default call rcu data if need be */
+	if (!cds_wfcq_empty(&crdp->cbs_head, &crdp->cbs_tail))
 		(void) get_default_call_rcu_data();
+
+	/*
+	 * Move leftover callbacks and leave the list at once, so that
+	 * rcu_barrier() markers are either moved or never queued.
+	 * rcu_barrier() creates the default call_rcu_data before
+	 * queueing.
+	 */
+	call_rcu_lock(&call_rcu_mutex);
+	if (!cds_wfcq_empty(&crdp->cbs_head, &crdp->cbs_tail)) {
 		__cds_wfcq_splice_blocking(&default_call_rcu_data->cbs_head,
 			&default_call_rcu_data->cbs_tail,
 			&crdp->cbs_head, &crdp->cbs_tail);
@@ -682,8 +1687,6 @@ void call_rcu_data_free(struct call_rcu_data *crdp)
 			    uatomic_read(&crdp->qlen));
 		wake_call_rcu_thread(default_call_rcu_data);
 	}
-
-	call_rcu_lock(&call_rcu_mutex);
 	cds_list_del(&crdp->list);
 	call_rcu_unlock(&call_rcu_mutex);
 
@@ -743,11 +1746,17 @@ void call_rcu_before_fork(void)
 	call_rcu_lock(&call_rcu_mutex);
 
 	cds_list_for_each_entry(crdp, &call_rcu_data_list, list) {
+		if (crdp->pool)
+			continue;
 		uatomic_or(&crdp->flags, URCU_CALL_RCU_PAUSE);
 		cmm_smp_mb__after_uatomic_or();
 		wake_call_rcu_thread(crdp);
 	}
+	if (call_rcu_pool)
+		call_rcu_pool_pause(call_rcu_pool);
 	cds_list_for_each_entry(crdp, &call_rcu_data_list, list) {
+		if (crdp->pool)
+			continue;
 		while ((uatomic_read(&crdp->flags) & URCU_CALL_RCU_PAUSED) == 0)
 			poll(NULL, 0, 1);
 	}
@@ -764,6 +1773,8 @@ void call_rcu_after_fork_parent(void)
 
 	cds_list_for_each_entry(crdp, &call_rcu_data_list, list)
 		uatomic_and(&crdp->flags, ~URCU_CALL_RCU_PAUSE);
+	if (call_rcu_pool)
+		uatomic_and(&call_rcu_pool->flags, ~URCU_CALL_RCU_PAUSE);
 	call_rcu_unlock(&call_rcu_mutex);
 }
 
@@ -783,6 +1794,13 @@ void call_rcu_after_fork_child(void)
 	if (cds_list_empty(&call_rcu_data_list))
 		return;
 
+	/* Pool workers are gone: the pool is freed with its queues. */
+	if (call_rcu_pool) {
+		call_rcu_pool->nr_workers = 0;
+		call_rcu_pool->nr_paused = 0;
+		uatomic_and(&call_rcu_pool->flags, ~URCU_CALL_RCU_PAUSE);
+	}
+
 	/*
 	 * Allocate a new default call_rcu_data structure in order
 	 * to get a working call_rcu thread to go with it.
@@ -799,11 +1817,20 @@ void call_rcu_after_fork_child(void)
 	/*
 	 * Dispose of all of the rest of the call_rcu_data structures.
 	 * Leftover call_rcu callbacks will be merged into the new
-	 * default call_rcu thread queue.
+	 * default call_rcu thread queue. Callbacks of threads with their
+	 * own grace period primitives cannot move to the default queue:
+	 * give them a new thread instead.
 	 */
 	cds_list_for_each_entry_safe(crdp, next, &call_rcu_data_list, list) {
 		if (crdp == default_call_rcu_data)
 			continue;
+		if (crdp->gp_ops) {
+			uatomic_and(&crdp->flags,
+				~(URCU_CALL_RCU_PAUSE | URCU_CALL_RCU_PAUSED));
+			crdp->futex = 0;
+			call_rcu_thread_create(crdp);
+			continue;
+		}
 		uatomic_set(&crdp->flags, URCU_CALL_RCU_STOPPED);
 		call_rcu_data_free(crdp);
 	}
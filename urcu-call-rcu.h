@@ -51,6 +51,33 @@ struct call_rcu_data;
 #define URCU_CALL_RCU_PAUSE	(1U << 4)
 #define URCU_CALL_RCU_PAUSED	(1U << 5)
 
+/*
+ * Tuning of a call_rcu thread. The thread starts a grace period for
+ * the callbacks queued so far at most once per delay, letting more
+ * callbacks accumulate meanwhile: max_delay_us, or, if adaptive, a
+ * delay halved down to min_delay_us after each batch of at least
+ * qlen_high callbacks, and doubled back up to max_delay_us while the
+ * thread is idle. The grace period of the next callbacks runs while
+ * the thread invokes those whose grace period has elapsed.
+ * Each batch invokes at most max_batch callbacks, for at most
+ * batch_time_us, the rest being invoked by the next ones (0: no limit).
+ * Initialize with URCU_CALL_RCU_ATTR_INIT.
+ */
+struct call_rcu_attr {
+	unsigned long min_delay_us;
+	unsigned long max_delay_us;
+	int adaptive;
+	unsigned long qlen_high;
+	unsigned long max_batch;
+	unsigned long batch_time_us;
+	/* Only filled by call_rcu_data_get_attr(). */
+	unsigned long cur_delay_us;
+};
+
+#define URCU_CALL_RCU_ATTR_INIT			\
+	{ .min_delay_us = 1000, .max_delay_us = 10000, .adaptive = 0,	\
+	  .qlen_high = 1000 }
+
 /*
  * The rcu_head data structure is placed in the structure to be freed
  * via call_rcu().
@@ -71,9 +98,16 @@ struct rcu_head {
 
 void call_rcu(struct rcu_head *head,
 	      void (*func)(struct rcu_head *head));
+void rcu_barrier(void);
 
 struct call_rcu_data *create_call_rcu_data(unsigned long flags,
 					   int cpu_affinity);
+struct call_rcu_data *create_call_rcu_data_attr(unsigned long flags,
+		int cpu_affinity, const struct call_rcu_attr *attr);
+int call_rcu_data_set_attr(struct call_rcu_data *crdp,
+		const struct call_rcu_attr *attr);
+void call_rcu_data_get_attr(struct call_rcu_data *crdp,
+		struct call_rcu_attr *attr);
 void call_rcu_data_free(struct call_rcu_data *crdp);
 
 struct call_rcu_data *get_default_call_rcu_data(void);
@@ -86,6 +120,7 @@ void set_thread_call_rcu_data(struct call_rcu_data *crdp);
 int set_cpu_call_rcu_data(int cpu, struct call_rcu_data *crdp);
 
 int create_all_cpu_call_rcu_data(unsigned long flags);
+int create_all_cpu_call_rcu_data_pool(unsigned long flags, int nr_workers);
 void free_all_cpu_call_rcu_data(void);
 
 void call_rcu_before_fork(void);
@@ -50,6 +50,7 @@
 #include <urcu/system.h>
 #include <urcu/tls-compat.h>
 #include "urcu-die.h"
+#include "urcu-trace.h"
 
 /*
  * Number of entries in the per-thread defer queue. Must be power of 2.
@@ -293,10 +294,72 @@ void rcu_defer_barrier(void)
 	synchronize_rcu();
 	cds_list_for_each_entry(index, &registry_defer, list)
 		rcu_defer_barrier_queue(index, index->last_head);
+	urcu_trace(RCU_TRACE_DEFER_BATCH, num_items, 0);
 end:
 	mutex_unlock(&rcu_defer_mutex);
 }
 
+/*
+ * Lock "mutex" unless "deadline" (urcu_spin_now() time) passes first.
+ */
+static int mutex_timedlock_defer(pthread_mutex_t *mutex, uint64_t deadline)
+{
+	struct timespec abs;
+	uint64_t now;
+	int ret;
+
+	now = urcu_spin_now();
+	(void) clock_gettime(CLOCK_REALTIME, &abs);
+	rcu_ns_to_timespec(rcu_timespec_to_ns(&abs)
+			+ (deadline > now ? deadline - now : 0), &abs);
+	ret = pthread_mutex_timedlock(mutex, &abs);
+	if (ret == ETIMEDOUT)
+		return -ETIMEDOUT;
+	if (ret)
+		urcu_die(ret);
+	return 0;
+}
+
+/*
+ * rcu_defer_barrier_timeout - rcu_defer_barrier() waiting at most "timeout".
+ *
+ * Returns -ETIMEDOUT if the grace period did not complete in time, in which
+ * case the callbacks are left queued, to be executed by the defer thread or
+ * by a later barrier.
+ */
+int rcu_defer_barrier_timeout(const struct timespec *timeout)
+{
+	struct defer_queue *index;
+	struct timespec left;
+	unsigned long num_items = 0;
+	uint64_t deadline, now;
+	int ret;
+
+	if (cds_list_empty(&registry_defer))
+		return 0;
+
+	deadline = urcu_spin_now() + rcu_timespec_to_ns(timeout);
+	ret = mutex_timedlock_defer(&rcu_defer_mutex, deadline);
+	if (ret)
+		return ret;
+	cds_list_for_each_entry(index, &registry_defer, list) {
+		index->last_head = CMM_LOAD_SHARED(index->head);
+		num_items += index->last_head - index->tail;
+	}
+	if (caa_likely(!num_items))
+		goto end;
+	now = urcu_spin_now();
+	rcu_ns_to_timespec(deadline > now ? deadline - now : 0, &left);
+	ret = synchronize_rcu_timeout(&left);
+	if (ret)
+		goto end;
+	cds_list_for_each_entry(index, &registry_defer, list)
+		rcu_defer_barrier_queue(index, index->last_head);
+end:
+	mutex_unlock(&rcu_defer_mutex);
+	return ret;
+}
+
 /*
  * _defer_rcu - Queue a RCU callback.
  */
@@ -371,7 +434,9 @@ static void *thr_defer(void *args)
 		 * to perform whatsoever. Aims at saving laptop battery life by
 		 * leaving the processor in sleep state when idle.
 		 */
+		urcu_trace(RCU_TRACE_DEFER_SLEEP, 0, 0);
 		wait_defer();
+		urcu_trace(RCU_TRACE_DEFER_WAKE, 0, 0);
 		/* Sleeping after wait_defer to let many callbacks enqueue */
 		poll(NULL,0,100);	/* wait for 100ms */
 		rcu_defer_barrier();
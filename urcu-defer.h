@@ -31,6 +31,7 @@
 
 #include <stdlib.h>
 #include <pthread.h>
+#include <time.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -60,6 +61,12 @@ extern void rcu_defer_unregister_thread(void);
 extern void rcu_defer_barrier(void);
 extern void rcu_defer_barrier_thread(void);
 
+/*
+ * rcu_defer_barrier() waiting at most "timeout". Returns 0, or -ETIMEDOUT
+ * leaving the callbacks queued for a later barrier.
+ */
+extern int rcu_defer_barrier_timeout(const struct timespec *timeout);
+
 #ifdef __cplusplus 
 }
 #endif
@@ -41,6 +41,13 @@ struct rcu_flavor_struct {
 	void (*thread_online)(void);
 	void (*register_thread)(void);
 	void (*unregister_thread)(void);
+
+	unsigned long (*update_get_state_synchronize_rcu)(void);
+	unsigned long (*update_start_poll_synchronize_rcu)(void);
+	int (*update_poll_state_synchronize_rcu)(unsigned long cookie);
+	void (*update_cond_synchronize_rcu)(unsigned long cookie);
+	void (*update_synchronize_rcu_expedited)(void);
+	void (*update_rcu_barrier)(void);
 };
 
 #define DEFINE_RCU_FLAVOR(x)				\
@@ -56,6 +63,95 @@ const struct rcu_flavor_struct x = {			\
 	.thread_online		= rcu_thread_online,	\
 	.register_thread	= rcu_register_thread,	\
 	.unregister_thread	= rcu_unregister_thread,\
+	.update_get_state_synchronize_rcu = get_state_synchronize_rcu,	\
+	.update_start_poll_synchronize_rcu = start_poll_synchronize_rcu, \
+	.update_poll_state_synchronize_rcu = poll_state_synchronize_rcu, \
+	.update_cond_synchronize_rcu = cond_synchronize_rcu,		\
+	.update_synchronize_rcu_expedited = synchronize_rcu_expedited,	\
+	.update_rcu_barrier	= rcu_barrier,		\
+}
+
+/*
+ * Define flavor "x" performing the grace periods of an RCU domain of the
+ * urcu.h flavors, so that data structures created against a flavor,
+ * such as cds_lfht, can be used within the domain. "domain" is
+ * evaluated on each call, e.g. a global struct rcu_domain pointer.
+ * defer_rcu() waits for a grace period of the domain, then invokes the
+ * function directly.
+ */
+#define DEFINE_RCU_DOMAIN_FLAVOR(x, domain)				\
+static void x##_read_lock(void)						\
+{									\
+	rcu_domain_read_lock(domain);					\
+}									\
+static void x##_read_unlock(void)					\
+{									\
+	rcu_domain_read_unlock(domain);					\
+}									\
+static int x##_read_ongoing(void)					\
+{									\
+	return rcu_domain_read_ongoing(domain);				\
+}									\
+static void x##_call_rcu(struct rcu_head *head,				\
+		void (*func)(struct rcu_head *head))			\
+{									\
+	rcu_domain_call_rcu(domain, head, func);			\
+}									\
+static void x##_synchronize_rcu(void)					\
+{									\
+	rcu_domain_synchronize(domain);					\
+}									\
+static void x##_defer_rcu(void (*fct)(void *p), void *p)		\
+{									\
+	rcu_domain_synchronize(domain);					\
+	fct(p);								\
+}									\
+static void x##_register_thread(void)					\
+{									\
+	rcu_domain_register_thread(domain);				\
+}									\
+static void x##_unregister_thread(void)					\
+{									\
+	rcu_domain_unregister_thread(domain);				\
+}									\
+static unsigned long x##_get_state_synchronize_rcu(void)		\
+{									\
+	return rcu_domain_get_state_synchronize(domain);		\
+}									\
+static unsigned long x##_start_poll_synchronize_rcu(void)		\
+{									\
+	return rcu_domain_start_poll_synchronize(domain);		\
+}									\
+static int x##_poll_state_synchronize_rcu(unsigned long cookie)		\
+{									\
+	return rcu_domain_poll_state_synchronize(domain, cookie);	\
+}									\
+static void x##_cond_synchronize_rcu(unsigned long cookie)		\
+{									\
+	rcu_domain_cond_synchronize(domain, cookie);			\
+}									\
+static void x##_synchronize_rcu_expedited(void)				\
+{									\
+	rcu_domain_synchronize_expedited(domain);			\
+}									\
+const struct rcu_flavor_struct x = {					\
+	.read_lock		= x##_read_lock,			\
+	.read_unlock		= x##_read_unlock,			\
+	.read_ongoing		= x##_read_ongoing,			\
+	.read_quiescent_state	= rcu_quiescent_state,			\
+	.update_call_rcu	= x##_call_rcu,				\
+	.update_synchronize_rcu	= x##_synchronize_rcu,			\
+	.update_defer_rcu	= x##_defer_rcu,			\
+	.thread_offline		= rcu_thread_offline,			\
+	.thread_online		= rcu_thread_online,			\
+	.register_thread	= x##_register_thread,			\
+	.unregister_thread	= x##_unregister_thread,		\
+	.update_get_state_synchronize_rcu = x##_get_state_synchronize_rcu, \
+	.update_start_poll_synchronize_rcu = x##_start_poll_synchronize_rcu, \
+	.update_poll_state_synchronize_rcu = x##_poll_state_synchronize_rcu, \
+	.update_cond_synchronize_rcu = x##_cond_synchronize_rcu,	\
+	.update_synchronize_rcu_expedited = x##_synchronize_rcu_expedited, \
+	.update_rcu_barrier	= rcu_barrier,				\
 }
 
 extern const struct rcu_flavor_struct rcu_flavor;
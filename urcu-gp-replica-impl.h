@@ -0,0 +1,70 @@
+#ifndef _URCU_GP_REPLICA_IMPL_H
+#define _URCU_GP_REPLICA_IMPL_H
+
+/*
+ * urcu-gp-replica-impl.h
+ *
+ * Userspace RCU library - per-node copies of the grace period counter
+ *
+ * TO BE INCLUDED ONLY FROM URCU LIBRARY CODE, by urcu.c, urcu-qsbr.c and
+ * urcu-bp.c.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <urcu/system.h>
+#include <urcu/static/gp-replica.h>
+
+#ifdef CONFIG_RCU_GP_REPLICAS
+
+#define DEFINE_RCU_GP_REPLICAS(_ctr)					\
+	struct rcu_gp_replica rcu_gp_replica[RCU_GP_NR_REPLICAS] = {	\
+		[0 ... RCU_GP_NR_REPLICAS - 1] = { .ctr = (_ctr) },	\
+	}
+
+/*
+ * Copy to be read by the calling thread: the one of the node it runs on.
+ * Threads migrating to other nodes keep theirs, which is only slower.
+ */
+static unsigned int gp_replica_select(void)
+{
+#ifdef SYS_getcpu
+	unsigned int cpu, node;
+
+	if (!syscall(SYS_getcpu, &cpu, &node, NULL))
+		return node % RCU_GP_NR_REPLICAS;
+#endif
+	return 0;
+}
+
+/*
+ * Called by the writer after updating rcu_gp.ctr, before the memory
+ * barrier preceding the wait for readers: readers see the new counter
+ * through their copy no later than through rcu_gp.ctr itself.
+ */
+static void gp_replica_update(unsigned long ctr)
+{
+	int i;
+
+	for (i = 0; i < RCU_GP_NR_REPLICAS; i++)
+		CMM_STORE_SHARED(rcu_gp_replica[i].ctr, ctr);
+}
+
+#endif /* CONFIG_RCU_GP_REPLICAS */
+
+#endif /* _URCU_GP_REPLICA_IMPL_H */
@@ -0,0 +1,201 @@
+#ifndef _URCU_GP_STATS_IMPL_H
+#define _URCU_GP_STATS_IMPL_H
+
+/*
+ * urcu-gp-stats-impl.h
+ *
+ * Userspace RCU library - grace period statistics
+ *
+ * TO BE INCLUDED ONLY FROM URCU LIBRARY CODE, after urcu-scan-impl.h.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include <urcu/compiler.h>
+#include <urcu/system.h>
+#include <urcu/gp-stats.h>
+#include "urcu-die.h"
+#include "urcu-wait.h"
+
+/*
+ * The grace period thread accumulates the statistics of the grace period
+ * in progress in "cur", with the grace period lock held, and adds them to
+ * "total" when the grace period ends. When disabled, grace periods only
+ * check "enabled" once.
+ */
+struct gp_stats {
+	int enabled;
+	struct {
+		int active;		/* Grace period in progress sampled. */
+		uint64_t start, phase_start;
+		int phase;
+		uint64_t phase_time[2];
+		uint64_t spins, sleeps, readers;
+	} cur;
+	pthread_mutex_t lock;		/* Protects total. */
+	struct rcu_gp_stats total;
+};
+
+#define GP_STATS_INIT	{ .lock = PTHREAD_MUTEX_INITIALIZER }
+
+static inline int gp_stats_active(struct gp_stats *stats)
+{
+	return stats && caa_unlikely(stats->cur.active);
+}
+
+static inline uint64_t gp_stats_now(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void gp_stats_hist_add(struct rcu_gp_stats_hist *hist,
+		uint64_t v)
+{
+	int i = 0;
+
+	if (v)
+		i = 63 - __builtin_clzll(v);
+	hist->bucket[i]++;
+	hist->count++;
+	hist->sum += v;
+	if (v > hist->max)
+		hist->max = v;
+}
+
+static inline void gp_stats_gp_start(struct gp_stats *stats)
+{
+	if (!stats || caa_likely(!CMM_LOAD_SHARED(stats->enabled)))
+		return;
+	memset(&stats->cur, 0, sizeof(stats->cur));
+	stats->cur.active = 1;
+	stats->cur.start = gp_stats_now();
+}
+
+static inline void gp_stats_phase_start(struct gp_stats *stats)
+{
+	if (!gp_stats_active(stats))
+		return;
+	stats->cur.phase_start = gp_stats_now();
+}
+
+static inline void gp_stats_phase_end(struct gp_stats *stats)
+{
+	if (!gp_stats_active(stats))
+		return;
+	stats->cur.phase_time[stats->cur.phase++] =
+		gp_stats_now() - stats->cur.phase_start;
+}
+
+static inline void gp_stats_spin(struct gp_stats *stats)
+{
+	if (gp_stats_active(stats))
+		stats->cur.spins++;
+}
+
+static inline void gp_stats_sleep(struct gp_stats *stats)
+{
+	if (gp_stats_active(stats))
+		stats->cur.sleeps++;
+}
+
+/* Called right after reader_scan_start(). */
+static inline void gp_stats_readers(struct gp_stats *stats,
+		struct reader_scan *scan)
+{
+	unsigned long i;
+
+	if (!gp_stats_active(stats))
+		return;
+	for (i = 0; i < READER_SCAN_WORDS(scan->nr); i++)
+		stats->cur.readers += __builtin_popcountl(scan->pending[i]);
+}
+
+/*
+ * End of the grace period performed on behalf of "waiters", if not NULL,
+ * and of its caller if "self" is set, i.e. if it is not one of them.
+ */
+static void gp_stats_gp_end(struct gp_stats *stats,
+		struct urcu_waiters *waiters, int self)
+{
+	struct rcu_gp_stats *total = &stats->total;
+	struct cds_wfs_node *iter;
+	uint64_t batch = self, gp_time;
+	int i, ret;
+
+	if (!gp_stats_active(stats))
+		return;
+	gp_time = gp_stats_now() - stats->cur.start;
+	if (waiters) {
+		cds_wfs_for_each_blocking(waiters->head, iter)
+			batch++;
+	}
+
+	ret = pthread_mutex_lock(&stats->lock);
+	if (ret)
+		urcu_die(ret);
+	total->nr_gp++;
+	total->nr_spins += stats->cur.spins;
+	total->nr_sleeps += stats->cur.sleeps;
+	gp_stats_hist_add(&total->gp_time, gp_time);
+	for (i = 0; i < stats->cur.phase; i++)
+		gp_stats_hist_add(&total->phase_time[i],
+				stats->cur.phase_time[i]);
+	gp_stats_hist_add(&total->batch, batch);
+	gp_stats_hist_add(&total->readers, stats->cur.readers);
+	ret = pthread_mutex_unlock(&stats->lock);
+	if (ret)
+		urcu_die(ret);
+	stats->cur.active = 0;
+}
+
+static void gp_stats_enable(struct gp_stats *stats, int enable)
+{
+	CMM_STORE_SHARED(stats->enabled, !!enable);
+}
+
+static void gp_stats_get(struct gp_stats *stats, struct rcu_gp_stats *out)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(&stats->lock);
+	if (ret)
+		urcu_die(ret);
+	*out = stats->total;
+	ret = pthread_mutex_unlock(&stats->lock);
+	if (ret)
+		urcu_die(ret);
+}
+
+static void gp_stats_reset(struct gp_stats *stats)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(&stats->lock);
+	if (ret)
+		urcu_die(ret);
+	memset(&stats->total, 0, sizeof(stats->total));
+	ret = pthread_mutex_unlock(&stats->lock);
+	if (ret)
+		urcu_die(ret);
+}
+
+#endif /* _URCU_GP_STATS_IMPL_H */
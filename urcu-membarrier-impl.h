@@ -0,0 +1,81 @@
+#ifndef _URCU_MEMBARRIER_IMPL_H
+#define _URCU_MEMBARRIER_IMPL_H
+
+/*
+ * urcu-membarrier-impl.h
+ *
+ * Userspace RCU library - sys_membarrier() command selection
+ *
+ * TO BE INCLUDED ONLY FROM URCU LIBRARY CODE.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+
+/*
+ * sys_membarrier() is only possibly available on Linux.
+ */
+#ifdef __linux__
+#include <syscall.h>
+#endif
+
+/* If the headers do not support SYS_membarrier, fall back on barriers */
+#ifdef SYS_membarrier
+# define membarrier(...)		syscall(SYS_membarrier, __VA_ARGS__)
+#else
+# define membarrier(...)		-ENOSYS
+#endif
+
+/*
+ * sys_membarrier() commands, as found in Linux's <linux/membarrier.h>,
+ * which older system headers lack.
+ */
+#define MEMBARRIER_CMD_QUERY				0
+#define MEMBARRIER_CMD_GLOBAL				(1 << 0)
+#define MEMBARRIER_CMD_GLOBAL_EXPEDITED			(1 << 1)
+#define MEMBARRIER_CMD_REGISTER_GLOBAL_EXPEDITED	(1 << 2)
+#define MEMBARRIER_CMD_PRIVATE_EXPEDITED		(1 << 3)
+#define MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED	(1 << 4)
+
+/*
+ * Return the cheapest sys_membarrier() command supported by the kernel,
+ * or MEMBARRIER_CMD_QUERY if there is none, in which case readers must
+ * use memory barriers. Private expedited barriers only IPI the CPUs
+ * running our threads; global expedited ones IPI every CPU running a
+ * registered process; plain global barriers wait for a scheduler grace
+ * period, which takes milliseconds, but still allow barrier-free
+ * readers. Registration is process-wide, so this only needs to be
+ * called once.
+ */
+static inline int membarrier_select_cmd(void)
+{
+	int mask;
+
+	mask = membarrier(MEMBARRIER_CMD_QUERY, 0);
+	if (mask < 0)
+		return MEMBARRIER_CMD_QUERY;
+	if ((mask & MEMBARRIER_CMD_PRIVATE_EXPEDITED)
+			&& !membarrier(MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0))
+		return MEMBARRIER_CMD_PRIVATE_EXPEDITED;
+	if ((mask & MEMBARRIER_CMD_GLOBAL_EXPEDITED)
+			&& !membarrier(MEMBARRIER_CMD_REGISTER_GLOBAL_EXPEDITED, 0))
+		return MEMBARRIER_CMD_GLOBAL_EXPEDITED;
+	if (mask & MEMBARRIER_CMD_GLOBAL)
+		return MEMBARRIER_CMD_GLOBAL;
+	return MEMBARRIER_CMD_QUERY;
+}
+
+#endif /* _URCU_MEMBARRIER_IMPL_H */
@@ -0,0 +1,437 @@
+#ifndef _URCU_POLL_IMPL_H
+#define _URCU_POLL_IMPL_H
+
+/*
+ * urcu-poll-impl.h
+ *
+ * Userspace RCU library - grace period polling API
+ *
+ * TO BE INCLUDED ONLY FROM URCU LIBRARY CODE.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+
+#include <urcu/compiler.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+#include <urcu/system.h>
+#include <urcu/futex.h>
+#include "urcu-die.h"
+#include "urcu-spin.h"
+#include "urcu-wait.h"
+
+/*
+ * Grace period sequence number. The low-order bit is set while a grace
+ * period is in progress, so each grace period increments it by 2.
+ * Written to only by the writer holding rcu_gp_lock. Read by threads
+ * polling for grace period completion.
+ */
+static unsigned long rcu_gp_seq __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+
+/* Wrap-around safe "a >= b" comparison of sequence numbers. */
+#define RCU_GP_SEQ_GE(a, b)	(ULONG_MAX / 2 >= (unsigned long) ((a) - (b)))
+
+/*
+ * Sequence number helpers, also used by the flavors which maintain
+ * other grace period sequences than rcu_gp_seq.
+ *
+ * Called by the writer, with rcu_gp_lock held, before it starts
+ * waiting for readers.
+ */
+static inline void rcu_seq_start(unsigned long *seq)
+{
+	CMM_STORE_SHARED(*seq, *seq + 1);
+	/* Write seq before the grace period reads reader state. */
+	cmm_smp_mb();
+}
+
+/*
+ * Called by the writer, with rcu_gp_lock held, once the grace period
+ * has completed.
+ */
+static inline void rcu_seq_end(unsigned long *seq)
+{
+	/* Complete the grace period before publishing its end. */
+	cmm_smp_mb();
+	CMM_STORE_SHARED(*seq, *seq + 1);
+}
+
+/*
+ * Return the sequence number the grace period counter must reach for a
+ * full grace period to have elapsed since now. If a grace period is
+ * currently in progress, it may have started before the caller's
+ * updates, so wait for the following one.
+ */
+static inline unsigned long rcu_seq_snap(unsigned long *seq)
+{
+	return (CMM_LOAD_SHARED(*seq) + 3) & ~1UL;
+}
+
+static inline int rcu_seq_done(unsigned long *seq, unsigned long cookie)
+{
+	return RCU_GP_SEQ_GE(CMM_LOAD_SHARED(*seq), cookie);
+}
+
+static inline void rcu_gp_seq_start(void)
+{
+	rcu_seq_start(&rcu_gp_seq);
+}
+
+static inline void rcu_gp_seq_end(void)
+{
+	rcu_seq_end(&rcu_gp_seq);
+}
+
+static inline unsigned long rcu_gp_seq_snap(void)
+{
+	return rcu_seq_snap(&rcu_gp_seq);
+}
+
+static inline int rcu_gp_seq_done(unsigned long cookie)
+{
+	return rcu_seq_done(&rcu_gp_seq, cookie);
+}
+
+/*
+ * Performs a grace period on behalf of the waiters queued so far in the
+ * flavor's grace period wait queue, if any. Only called when the first
+ * of them is asynchronous: the queue then has no synchronous leader, the
+ * only other thread allowed to move it. Defined by each flavor.
+ */
+static void rcu_gp_lead_waiters(void);
+
+/*
+ * Performs a grace period for the poll worker only, without queueing in
+ * or moving the flavor's grace period wait queue. Defined by each
+ * flavor.
+ */
+static void rcu_gp_poll_synchronize(void);
+
+static inline uint64_t rcu_timespec_to_ns(const struct timespec *ts)
+{
+	return (uint64_t) ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+static inline void rcu_ns_to_timespec(uint64_t ns, struct timespec *ts)
+{
+	ts->tv_sec = ns / 1000000000ULL;
+	ts->tv_nsec = ns % 1000000000ULL;
+}
+
+/*
+ * Threads waiting for a grace period sequence to reach a cookie sleep on
+ * "done", which is bumped whenever grace periods they may wait for end.
+ */
+struct gp_poll_waiters {
+	long nr_waiters;	/* Threads waiting on done. */
+	int32_t done;
+};
+
+/* Called once the sequence waited for has been updated. */
+static void gp_poll_waiters_wake(struct gp_poll_waiters *waiters)
+{
+	/* Read seq before read nr_waiters. */
+	cmm_smp_mb();
+	if (!uatomic_read(&waiters->nr_waiters))
+		return;
+	uatomic_inc(&waiters->done);
+	futex_async(&waiters->done, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Called before requesting the grace periods to wait for. */
+static void gp_poll_waiters_add(struct gp_poll_waiters *waiters)
+{
+	uatomic_inc(&waiters->nr_waiters);
+	/* Write nr_waiters before the grace periods are requested. */
+	cmm_smp_mb();
+}
+
+/*
+ * Wait for "*seq" to reach "cookie", or until "deadline" (urcu_spin_now()
+ * time) when not 0, after gp_poll_waiters_add(). Returns 0 once reached,
+ * -ETIMEDOUT otherwise.
+ */
+static int gp_poll_waiters_wait(struct gp_poll_waiters *waiters,
+		unsigned long *seq, unsigned long cookie, uint64_t deadline)
+{
+	struct timespec left;
+	uint64_t now;
+	int32_t done;
+	int ret = 0;
+
+	for (;;) {
+		done = uatomic_read(&waiters->done);
+		/* Read done before read seq. */
+		cmm_smp_mb();
+		if (rcu_seq_done(seq, cookie))
+			break;
+		if (deadline) {
+			now = urcu_spin_now();
+			if (now >= deadline) {
+				ret = -ETIMEDOUT;
+				break;
+			}
+			rcu_ns_to_timespec(deadline - now, &left);
+		}
+		futex_async(&waiters->done, FUTEX_WAIT, done,
+			deadline ? &left : NULL, NULL, 0);
+	}
+	uatomic_dec(&waiters->nr_waiters);
+	/* Order grace period end before the caller's following accesses. */
+	cmm_smp_mb();
+	return ret;
+}
+
+/*
+ * Grace periods requested through start_poll_synchronize_rcu() are
+ * performed by a worker thread created on first use, so the caller
+ * never blocks. Threads in synchronize_rcu_timeout() wait on "waiters",
+ * woken up whenever grace periods the worker waits for end.
+ * The worker also leads the grace periods of wait queues whose first
+ * waiter is asynchronous, when "lead" is set.
+ */
+struct gp_poll_worker {
+	pthread_mutex_t lock;	/* Guards worker thread creation. */
+	pid_t pid;		/* Process owning the worker, 0 if none. */
+	unsigned long target;	/* Newest cookie requested. */
+	int32_t lead;
+	int32_t futex;
+	struct gp_poll_waiters waiters;
+};
+
+static struct gp_poll_worker gp_poll_worker = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void *gp_poll_worker_thread(void *arg)
+{
+	struct gp_poll_worker *worker = arg;
+
+	for (;;) {
+		uatomic_set(&worker->futex, -1);
+		/* Write futex before read lead and target. */
+		cmm_smp_mb();
+		if (uatomic_xchg(&worker->lead, 0)) {
+			uatomic_set(&worker->futex, 0);
+			rcu_gp_lead_waiters();
+			gp_poll_waiters_wake(&worker->waiters);
+			continue;
+		}
+		if (!rcu_gp_seq_done(uatomic_read(&worker->target))) {
+			uatomic_set(&worker->futex, 0);
+			/*
+			 * Not synchronize_rcu(): an asynchronous waiter
+			 * queued first meanwhile would make us wait for a
+			 * leader which can only be ourself.
+			 */
+			rcu_gp_poll_synchronize();
+			gp_poll_waiters_wake(&worker->waiters);
+			continue;
+		}
+		/* Target reached by grace periods of other threads. */
+		gp_poll_waiters_wake(&worker->waiters);
+		if (uatomic_read(&worker->futex) == -1)
+			futex_async(&worker->futex, FUTEX_WAIT, -1,
+				NULL, NULL, 0);
+	}
+	return NULL;
+}
+
+static void gp_poll_worker_wake_up(struct gp_poll_worker *worker)
+{
+	/* Write target or lead before read futex. */
+	cmm_smp_mb();
+	if (caa_unlikely(uatomic_read(&worker->futex) == -1)) {
+		uatomic_set(&worker->futex, 0);
+		futex_async(&worker->futex, FUTEX_WAKE, 1,
+			NULL, NULL, 0);
+	}
+}
+
+/*
+ * Wake up the worker, spawning it if this process does not have one yet
+ * (first use, or first use since fork()).
+ */
+static void gp_poll_worker_start(struct gp_poll_worker *worker)
+{
+	pthread_attr_t attr;
+	pthread_t tid;
+	int ret;
+
+	if (caa_unlikely(CMM_LOAD_SHARED(worker->pid) != getpid())) {
+		ret = pthread_mutex_lock(&worker->lock);
+		if (ret)
+			urcu_die(ret);
+		if (worker->pid != getpid()) {
+			ret = pthread_attr_init(&attr);
+			if (ret)
+				urcu_die(ret);
+			ret = pthread_attr_setdetachstate(&attr,
+					PTHREAD_CREATE_DETACHED);
+			if (ret)
+				urcu_die(ret);
+			worker->futex = 0;
+			ret = pthread_create(&tid, &attr,
+					gp_poll_worker_thread, worker);
+			if (ret)
+				urcu_die(ret);
+			pthread_attr_destroy(&attr);
+			CMM_STORE_SHARED(worker->pid, getpid());
+		}
+		ret = pthread_mutex_unlock(&worker->lock);
+		if (ret)
+			urcu_die(ret);
+	}
+	gp_poll_worker_wake_up(worker);
+}
+
+/*
+ * Ask the worker to run grace periods until "cookie" is reached.
+ */
+static void gp_poll_worker_request(unsigned long cookie)
+{
+	struct gp_poll_worker *worker = &gp_poll_worker;
+	unsigned long old, target;
+
+	target = uatomic_read(&worker->target);
+	do {
+		old = target;
+		if (RCU_GP_SEQ_GE(old, cookie))
+			break;
+		target = uatomic_cmpxchg(&worker->target, old, cookie);
+	} while (target != old);
+	gp_poll_worker_start(worker);
+}
+
+unsigned long get_state_synchronize_rcu(void)
+{
+	/* Order prior updates before reading the sequence number. */
+	cmm_smp_mb();
+	return rcu_gp_seq_snap();
+}
+
+unsigned long start_poll_synchronize_rcu(void)
+{
+	unsigned long cookie;
+
+	cookie = get_state_synchronize_rcu();
+	if (!rcu_gp_seq_done(cookie))
+		gp_poll_worker_request(cookie);
+	return cookie;
+}
+
+int poll_state_synchronize_rcu(unsigned long cookie)
+{
+	if (!rcu_gp_seq_done(cookie))
+		return 0;
+	/* Order grace period end before the caller's following accesses. */
+	cmm_smp_mb();
+	return 1;
+}
+
+void cond_synchronize_rcu(unsigned long cookie)
+{
+	if (!poll_state_synchronize_rcu(cookie))
+		synchronize_rcu();
+}
+
+/*
+ * Wait for "cookie" to be reached, having the worker run grace periods
+ * until then if needed, or until "deadline" (urcu_spin_now() time) when
+ * not 0. Returns 0 once reached, -ETIMEDOUT otherwise. The caller must
+ * not hold back grace periods: QSBR threads must be offline.
+ */
+static int gp_poll_wait(unsigned long cookie, uint64_t deadline)
+{
+	struct gp_poll_worker *worker = &gp_poll_worker;
+
+	gp_poll_waiters_add(&worker->waiters);
+	gp_poll_worker_request(cookie);
+	return gp_poll_waiters_wait(&worker->waiters, &rcu_gp_seq, cookie,
+			deadline);
+}
+
+/*
+ * Wait for a grace period for at most "timeout", relative. The grace
+ * period is performed by the worker, so a caller giving up leaves no
+ * grace period half-done, and no waiter behind. Returns 0 once a full
+ * grace period has elapsed since the call, -ETIMEDOUT otherwise.
+ */
+static int gp_poll_synchronize_timeout(const struct timespec *timeout)
+{
+	unsigned long cookie;
+	uint64_t deadline;
+
+	deadline = urcu_spin_now() + rcu_timespec_to_ns(timeout);
+	cookie = get_state_synchronize_rcu();
+	if (poll_state_synchronize_rcu(cookie))
+		return 0;
+	return gp_poll_wait(cookie, deadline);
+}
+
+struct gp_notify_node {
+	struct urcu_wait_async_node async;
+	int fd;
+};
+
+static void gp_notify_eventfd_func(struct urcu_wait_async_node *async)
+{
+	struct gp_notify_node *node =
+		caa_container_of(async, struct gp_notify_node, async);
+	uint64_t one = 1;
+	int saved_errno = errno;
+	ssize_t ret;
+
+	/* Runs in the grace period leader: preserve its errno. */
+	do {
+		ret = write(node->fd, &one, sizeof(one));
+	} while (ret < 0 && errno == EINTR);
+	errno = saved_errno;
+	free(node);
+}
+
+/*
+ * Queue an asynchronous waiter writing to "fd" once a grace period has
+ * elapsed. If it is first in "queue", no thread is about to perform the
+ * grace period, so the worker leads it.
+ */
+static int gp_notify_eventfd(struct urcu_wait_queue *queue, int fd)
+{
+	struct gp_poll_worker *worker = &gp_poll_worker;
+	struct gp_notify_node *node;
+
+	node = malloc(sizeof(*node));
+	if (!node)
+		return -ENOMEM;
+	urcu_wait_node_init(&node->async.wait, URCU_WAIT_ASYNC);
+	node->async.func = gp_notify_eventfd_func;
+	node->fd = fd;
+	/* Implicit memory barrier orders prior accesses before the push. */
+	if (urcu_wait_add(queue, &node->async.wait) != 0)
+		return 0;
+	uatomic_set(&worker->lead, 1);
+	gp_poll_worker_start(worker);
+	return 0;
+}
+
+#endif /* _URCU_POLL_IMPL_H */
@@ -0,0 +1,222 @@
+/*
+ * urcu-qsbr-preload.c
+ *
+ * Userspace RCU QSBR library - offline/online around blocking calls
+ *
+ * Interposes on well-known blocking library calls and system calls, either
+ * with LD_PRELOAD=liburcu-qsbr-preload.so or by linking the application
+ * with -lurcu-qsbr-preload. Registered QSBR reader threads which are
+ * online are put offline for the duration of the call, and back online,
+ * which is a quiescent state, when it returns. Threads which are not
+ * registered, or offline, go straight to the real call.
+ *
+ * This is only correct for threads that do not hold references to
+ * RCU-protected data across these calls.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+#include <urcu/compiler.h>
+#include <urcu/system.h>
+#include "urcu-qsbr.h"
+
+#ifndef FUTEX_WAIT
+#define FUTEX_WAIT		0
+#endif
+#ifndef FUTEX_WAIT_BITSET
+#define FUTEX_WAIT_BITSET	9
+#endif
+/* Masks FUTEX_PRIVATE_FLAG and FUTEX_CLOCK_REALTIME out of the op. */
+#define FUTEX_CMD_MASK		0x7f
+
+static void *lookup_real(const char *name)
+{
+	void *sym;
+
+	sym = dlsym(RTLD_NEXT, name);
+	if (!sym) {
+		fprintf(stderr, "liburcu-qsbr-preload: cannot find %s: %s\n",
+			name, dlerror());
+		abort();
+	}
+	return sym;
+}
+
+/*
+ * Resolves "name" on first use into a function pointer named real_<name>,
+ * of the type of the declaration of "name".
+ */
+#define DEFINE_REAL(name)						\
+	static __typeof__(name) *real_##name;				\
+									\
+	static __typeof__(name) *get_real_##name(void)			\
+	{								\
+		__typeof__(name) *fct;					\
+									\
+		fct = CMM_LOAD_SHARED(real_##name);			\
+		if (caa_unlikely(!fct)) {				\
+			fct = (__typeof__(name) *) lookup_real(#name);	\
+			CMM_STORE_SHARED(real_##name, fct);		\
+		}							\
+		return fct;						\
+	}
+
+/* Returns whether the thread was put offline. */
+static int blocking_begin(void)
+{
+	if (!rcu_read_ongoing())
+		return 0;
+	rcu_thread_offline();
+	return 1;
+}
+
+static void blocking_end(int was_online)
+{
+	int saved_errno;
+
+	if (!was_online)
+		return;
+	saved_errno = errno;
+	rcu_thread_online();
+	errno = saved_errno;
+}
+
+/*
+ * Defines wrapper "name" returning "type", calling the real function with
+ * "args" while offline.
+ */
+#define WRAP(type, name, params, args)					\
+	DEFINE_REAL(name)						\
+									\
+	type name params						\
+	{								\
+		type ret;						\
+		int was_online;						\
+									\
+		was_online = blocking_begin();				\
+		ret = get_real_##name() args;				\
+		blocking_end(was_online);				\
+		return ret;						\
+	}
+
+WRAP(ssize_t, read, (int fd, void *buf, size_t count),
+	(fd, buf, count))
+WRAP(ssize_t, readv, (int fd, const struct iovec *iov, int iovcnt),
+	(fd, iov, iovcnt))
+WRAP(ssize_t, recv, (int fd, void *buf, size_t len, int flags),
+	(fd, buf, len, flags))
+WRAP(ssize_t, recvfrom, (int fd, void *buf, size_t len, int flags,
+		struct sockaddr *src_addr, socklen_t *addrlen),
+	(fd, buf, len, flags, src_addr, addrlen))
+WRAP(ssize_t, recvmsg, (int fd, struct msghdr *msg, int flags),
+	(fd, msg, flags))
+WRAP(int, accept, (int fd, struct sockaddr *addr, socklen_t *addrlen),
+	(fd, addr, addrlen))
+WRAP(int, accept4, (int fd, struct sockaddr *addr, socklen_t *addrlen,
+		int flags),
+	(fd, addr, addrlen, flags))
+WRAP(int, poll, (struct pollfd *fds, nfds_t nfds, int timeout),
+	(fds, nfds, timeout))
+WRAP(int, ppoll, (struct pollfd *fds, nfds_t nfds,
+		const struct timespec *timeout, const sigset_t *sigmask),
+	(fds, nfds, timeout, sigmask))
+WRAP(int, select, (int nfds, fd_set *readfds, fd_set *writefds,
+		fd_set *exceptfds, struct timeval *timeout),
+	(nfds, readfds, writefds, exceptfds, timeout))
+WRAP(int, pselect, (int nfds, fd_set *readfds, fd_set *writefds,
+		fd_set *exceptfds, const struct timespec *timeout,
+		const sigset_t *sigmask),
+	(nfds, readfds, writefds, exceptfds, timeout, sigmask))
+WRAP(int, epoll_wait, (int epfd, struct epoll_event *events,
+		int maxevents, int timeout),
+	(epfd, events, maxevents, timeout))
+WRAP(int, epoll_pwait, (int epfd, struct epoll_event *events,
+		int maxevents, int timeout, const sigset_t *sigmask),
+	(epfd, events, maxevents, timeout, sigmask))
+WRAP(int, nanosleep, (const struct timespec *req, struct timespec *rem),
+	(req, rem))
+WRAP(int, clock_nanosleep, (clockid_t clock_id, int flags,
+		const struct timespec *req, struct timespec *rem),
+	(clock_id, flags, req, rem))
+WRAP(unsigned int, sleep, (unsigned int seconds),
+	(seconds))
+WRAP(int, usleep, (useconds_t usec),
+	(usec))
+WRAP(pid_t, wait, (int *status),
+	(status))
+WRAP(pid_t, waitpid, (pid_t pid, int *status, int options),
+	(pid, status, options))
+WRAP(int, sigwait, (const sigset_t *set, int *sig),
+	(set, sig))
+WRAP(int, sigwaitinfo, (const sigset_t *set, siginfo_t *info),
+	(set, info))
+WRAP(int, sigtimedwait, (const sigset_t *set, siginfo_t *info,
+		const struct timespec *timeout),
+	(set, info, timeout))
+WRAP(int, pthread_join, (pthread_t thread, void **retval),
+	(thread, retval))
+WRAP(int, pthread_cond_wait, (pthread_cond_t *cond, pthread_mutex_t *mutex),
+	(cond, mutex))
+WRAP(int, pthread_cond_timedwait, (pthread_cond_t *cond,
+		pthread_mutex_t *mutex, const struct timespec *abstime),
+	(cond, mutex, abstime))
+
+DEFINE_REAL(syscall)
+
+/*
+ * Only futex waits are blocking among the system calls the application
+ * may issue directly. syscall() takes at most six arguments.
+ */
+long syscall(long number, ...)
+{
+	long a[6], ret;
+	int was_online = 0, i;
+	va_list ap;
+
+	va_start(ap, number);
+	for (i = 0; i < 6; i++)
+		a[i] = va_arg(ap, long);
+	va_end(ap);
+
+	if (number == SYS_futex) {
+		switch (a[1] & FUTEX_CMD_MASK) {
+		case FUTEX_WAIT:
+		case FUTEX_WAIT_BITSET:
+			was_online = blocking_begin();
+			break;
+		}
+	}
+	ret = get_real_syscall()(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+	blocking_end(was_online);
+	return ret;
+}
@@ -44,21 +44,32 @@
 
 #include "urcu-die.h"
 #include "urcu-wait.h"
+#include "urcu-trace.h"
 
 /* Do not #define _LGPL_SOURCE to ensure we can emit the wrapper symbols */
 #undef _LGPL_SOURCE
 #include "urcu-qsbr.h"
 #define _LGPL_SOURCE
 
+#include "urcu-poll-impl.h"
+#include "urcu-scan-impl.h"
+#include "urcu-gp-stats-impl.h"
+#include "urcu-stall-impl.h"
+#include "urcu-gp-replica-impl.h"
+
 void __attribute__((destructor)) rcu_exit(void);
 
 static pthread_mutex_t rcu_gp_lock = PTHREAD_MUTEX_INITIALIZER;
-struct rcu_gp rcu_gp = { .ctr = RCU_GP_ONLINE };
-
 /*
- * Active attempts to check for reader Q.S. before calling futex().
+ * Protects registry and registry_scan. Grace periods release it while
+ * waiting for readers, so that unregistration does not wait for them.
  */
-#define RCU_QS_ACTIVE_ATTEMPTS 100
+static pthread_mutex_t rcu_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+struct rcu_gp rcu_gp = { .ctr = RCU_GP_ONLINE };
+
+#ifdef CONFIG_RCU_GP_REPLICAS
+DEFINE_RCU_GP_REPLICAS(RCU_GP_ONLINE);
+#endif
 
 /*
  * Written to only by each individual reader. Read by both the reader and the
@@ -72,6 +83,7 @@ DEFINE_URCU_TLS(unsigned int, rcu_rand_yield);
 #endif
 
 static CDS_LIST_HEAD(registry);
+static DEFINE_READER_SCAN(registry_scan);
 
 /*
  * Queue keeping threads awaiting to wait for a grace period. Contains
@@ -79,6 +91,13 @@ static CDS_LIST_HEAD(registry);
  */
 static DEFINE_URCU_WAIT_QUEUE(gp_waiters);
 
+static struct gp_stats gp_stats = GP_STATS_INIT;
+static struct stall_detector stall_detector;
+
+/* Busy-waiting budgets before calling futex(). */
+static DEFINE_URCU_SPIN(gp_spin);	/* Waiting for readers. */
+static DEFINE_URCU_SPIN(waiter_spin);	/* Waiting for a grace period. */
+
 static void mutex_lock(pthread_mutex_t *mutex)
 {
 	int ret;
@@ -106,23 +125,42 @@ static void mutex_unlock(pthread_mutex_t *mutex)
 }
 
 /*
- * synchronize_rcu() waiting. Single thread.
+ * synchronize_rcu() waiting. Single thread. Called with rcu_registry_lock
+ * held, released while sleeping.
  */
 static void wait_gp(void)
 {
+	struct timespec ts;
+
+	mutex_unlock(&rcu_registry_lock);
 	/* Read reader_gp before read futex */
 	cmm_smp_rmb();
-	if (uatomic_read(&rcu_gp.futex) == -1)
+	if (uatomic_read(&rcu_gp.futex) == -1) {
+		gp_stats_sleep(&gp_stats);
 		futex_noasync(&rcu_gp.futex, FUTEX_WAIT, -1,
-		      NULL, NULL, 0);
+		      stall_wait_timeout(&stall_detector, &ts), NULL, 0);
+	}
+	mutex_lock(&rcu_registry_lock);
 }
 
-static void wait_for_readers(struct cds_list_head *input_readers,
-			struct cds_list_head *cur_snap_readers,
-			struct cds_list_head *qsreaders)
+/*
+ * Non-expedited grace periods busy-wait for the budget of gp_spin, then
+ * block on the futex until readers are quiescent, and adapt the budget
+ * to the duration of the wait. Expedited grace periods never block on
+ * the futex: they keep busy-looping until all readers are quiescent, so
+ * readers are never asked to wake up the writer.
+ *
+ * Called with rcu_registry_lock held. It is released between passes,
+ * during which readers leaving are removed from the bitmaps.
+ */
+static void wait_for_readers(unsigned long *input_readers,
+			unsigned long *cur_snap_readers,
+			int expedited)
 {
-	int wait_loops = 0;
-	struct rcu_reader *index, *tmp;
+	struct urcu_spin_wait spin_wait = { 0 };
+	int wait_loops = 0, parked = 0, empty;
+	struct rcu_reader *index;
+	unsigned long i;
 
 	/*
 	 * Wait for each thread URCU_TLS(rcu_reader).ctr to either
@@ -130,62 +168,54 @@ static void wait_for_readers(struct cds_list_head *input_readers,
 	 * current rcu_gp.ctr value.
 	 */
 	for (;;) {
-		wait_loops++;
-		if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS) {
+		if (parked) {
 			uatomic_set(&rcu_gp.futex, -1);
 			/*
 			 * Write futex before write waiting (the other side
 			 * reads them in the opposite order).
 			 */
 			cmm_smp_wmb();
-			cds_list_for_each_entry(index, input_readers, node) {
+			reader_scan_for_each(&registry_scan, input_readers, i) {
+				index = caa_container_of(registry_scan.ctr[i],
+						struct rcu_reader, ctr);
 				_CMM_STORE_SHARED(index->waiting, 1);
 			}
 			/* Write futex before read reader_gp */
 			cmm_smp_mb();
 		}
-		cds_list_for_each_entry_safe(index, tmp, input_readers, node) {
-			switch (rcu_reader_state(&index->ctr)) {
-			case RCU_READER_ACTIVE_CURRENT:
-				if (cur_snap_readers) {
-					cds_list_move(&index->node,
-						cur_snap_readers);
-					break;
-				}
-				/* Fall-through */
-			case RCU_READER_INACTIVE:
-				cds_list_move(&index->node, qsreaders);
-				break;
-			case RCU_READER_ACTIVE_OLD:
-				/*
-				 * Old snapshot. Leaving node in
-				 * input_readers will make us busy-loop
-				 * until the snapshot becomes current or
-				 * the reader becomes inactive.
-				 */
-				break;
-			}
-		}
-
-		if (cds_list_empty(input_readers)) {
-			if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS) {
+		empty = reader_scan_pass(&registry_scan, input_readers,
+				cur_snap_readers);
+		if (empty) {
+			if (parked) {
 				/* Read reader_gp before write futex */
 				cmm_smp_mb();
 				uatomic_set(&rcu_gp.futex, 0);
 			}
 			break;
+		}
+		stall_check(&stall_detector, &registry_scan, input_readers);
+
+		if (parked) {
+			wait_gp();
+			continue;
+		}
+		if (!expedited && !wait_loops++)
+			urcu_spin_wait_start(&gp_spin, &spin_wait);
+		if (!expedited && urcu_spin_wait_expired(&spin_wait)) {
+			parked = 1;
 		} else {
-			if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS) {
-				wait_gp();
-			} else {
+			gp_stats_spin(&gp_stats);
+			mutex_unlock(&rcu_registry_lock);
 #ifndef HAS_INCOHERENT_CACHES
-				caa_cpu_relax();
+			caa_cpu_relax();
 #else /* #ifndef HAS_INCOHERENT_CACHES */
-				cmm_smp_mb();
+			cmm_smp_mb();
 #endif /* #else #ifndef HAS_INCOHERENT_CACHES */
-			}
+			mutex_lock(&rcu_registry_lock);
 		}
 	}
+	if (wait_loops)
+		urcu_spin_wait_end(&gp_spin, &spin_wait);
 }
 
 /*
@@ -194,56 +224,31 @@ static void wait_for_readers(struct cds_list_head *input_readers,
  */
 
 #if (CAA_BITS_PER_LONG < 64)
-void synchronize_rcu(void)
+/*
+ * Perform a grace period on behalf of every waiter moved out of
+ * gp_waiters so far. Called with rcu_gp_lock held.
+ */
+static void do_grace_period(int expedited)
 {
-	CDS_LIST_HEAD(cur_snap_readers);
-	CDS_LIST_HEAD(qsreaders);
-	unsigned long was_online;
-	DEFINE_URCU_WAIT_NODE(wait, URCU_WAIT_WAITING);
-	struct urcu_waiters waiters;
-
-	was_online = rcu_read_ongoing();
-
-	/* All threads should read qparity before accessing data structure
-	 * where new ptr points to.  In the "then" case, rcu_thread_offline
-	 * includes a memory barrier.
-	 *
-	 * Mark the writer thread offline to make sure we don't wait for
-	 * our own quiescent state. This allows using synchronize_rcu()
-	 * in threads registered as readers.
-	 */
-	if (was_online)
-		rcu_thread_offline();
-	else
-		cmm_smp_mb();
-
-	/*
-	 * Add ourself to gp_waiters queue of threads awaiting to wait
-	 * for a grace period. Proceed to perform the grace period only
-	 * if we are the first thread added into the queue.
-	 */
-	if (urcu_wait_add(&gp_waiters, &wait) != 0) {
-		/* Not first in queue: will be awakened by another thread. */
-		urcu_adaptative_busy_wait(&wait);
-		goto gp_end;
-	}
-	/* We won't need to wake ourself up */
-	urcu_wait_set_state(&wait, URCU_WAIT_RUNNING);
-
-	mutex_lock(&rcu_gp_lock);
-
-	/*
-	 * Move all waiters into our local queue.
-	 */
-	urcu_move_waiters(&waiters, &gp_waiters);
+	rcu_gp_seq_start();
+	urcu_trace(RCU_TRACE_GP_START, rcu_gp_seq, expedited);
 
+	mutex_lock(&rcu_registry_lock);
+	reader_scan_merge(&registry_scan, &registry);
 	if (cds_list_empty(&registry))
 		goto out;
 
+	reader_scan_start(&registry_scan, &registry);
+	gp_stats_readers(&gp_stats, &registry_scan);
+	stall_gp_start(&stall_detector);
+
 	/*
 	 * Wait for readers to observe original parity or be quiescent.
 	 */
-	wait_for_readers(&registry, &cur_snap_readers, &qsreaders);
+	gp_stats_phase_start(&gp_stats);
+	wait_for_readers(registry_scan.pending, registry_scan.cur_snap,
+			expedited);
+	gp_stats_phase_end(&gp_stats);
 
 	/*
 	 * Must finish waiting for quiescent state for original parity
@@ -264,6 +269,9 @@ void synchronize_rcu(void)
 
 	/* Switch parity: 0 -> 1, 1 -> 0 */
 	CMM_STORE_SHARED(rcu_gp.ctr, rcu_gp.ctr ^ RCU_GP_CTR);
+#ifdef CONFIG_RCU_GP_REPLICAS
+	gp_replica_update(rcu_gp.ctr);
+#endif
 
 	/*
 	 * Must commit rcu_gp.ctr update to memory before waiting for
@@ -284,36 +292,82 @@ void synchronize_rcu(void)
 	/*
 	 * Wait for readers to observe new parity or be quiescent.
 	 */
-	wait_for_readers(&cur_snap_readers, NULL, &qsreaders);
+	gp_stats_phase_start(&gp_stats);
+	wait_for_readers(registry_scan.cur_snap, NULL, expedited);
+	gp_stats_phase_end(&gp_stats);
+	stall_gp_end(&stall_detector);
+out:
+	mutex_unlock(&rcu_registry_lock);
+	urcu_trace(RCU_TRACE_GP_END, rcu_gp_seq, expedited);
+	rcu_gp_seq_end();
+}
+#else /* !(CAA_BITS_PER_LONG < 64) */
+/*
+ * Perform a grace period on behalf of every waiter moved out of
+ * gp_waiters so far. Called with rcu_gp_lock held.
+ */
+static void do_grace_period(int expedited)
+{
+	rcu_gp_seq_start();
+	urcu_trace(RCU_TRACE_GP_START, rcu_gp_seq, expedited);
+
+	mutex_lock(&rcu_registry_lock);
+	reader_scan_merge(&registry_scan, &registry);
+	if (cds_list_empty(&registry))
+		goto out;
+
+	reader_scan_start(&registry_scan, &registry);
+	gp_stats_readers(&gp_stats, &registry_scan);
+	stall_gp_start(&stall_detector);
+
+	/* Increment current G.P. */
+	CMM_STORE_SHARED(rcu_gp.ctr, rcu_gp.ctr + RCU_GP_CTR);
+#ifdef CONFIG_RCU_GP_REPLICAS
+	gp_replica_update(rcu_gp.ctr);
+#endif
 
 	/*
-	 * Put quiescent reader list back into registry.
+	 * Must commit rcu_gp.ctr update to memory before waiting for
+	 * quiescent state. Failure to do so could result in the writer
+	 * waiting forever while new readers are always accessing data
+	 * (no progress). Enforce compiler-order of store to rcu_gp.ctr
+	 * before load URCU_TLS(rcu_reader).ctr.
 	 */
-	cds_list_splice(&qsreaders, &registry);
-out:
-	mutex_unlock(&rcu_gp_lock);
-	urcu_wake_all_waiters(&waiters);
-gp_end:
+	cmm_barrier();
+
 	/*
-	 * Finish waiting for reader threads before letting the old ptr being
-	 * freed.
+	 * Adding a cmm_smp_mb() which is _not_ formally required, but makes the
+	 * model easier to understand. It does not have a big performance impact
+	 * anyway, given this is the write-side.
 	 */
-	if (was_online)
-		rcu_thread_online();
-	else
-		cmm_smp_mb();
+	cmm_smp_mb();
+
+	/*
+	 * Wait for readers to observe new count of be quiescent.
+	 */
+	gp_stats_phase_start(&gp_stats);
+	wait_for_readers(registry_scan.pending, NULL, expedited);
+	gp_stats_phase_end(&gp_stats);
+	stall_gp_end(&stall_detector);
+out:
+	mutex_unlock(&rcu_registry_lock);
+	urcu_trace(RCU_TRACE_GP_END, rcu_gp_seq, expedited);
+	rcu_gp_seq_end();
 }
-#else /* !(CAA_BITS_PER_LONG < 64) */
+#endif  /* !(CAA_BITS_PER_LONG < 64) */
+
 void synchronize_rcu(void)
 {
-	CDS_LIST_HEAD(qsreaders);
 	unsigned long was_online;
 	DEFINE_URCU_WAIT_NODE(wait, URCU_WAIT_WAITING);
 	struct urcu_waiters waiters;
 
 	was_online = rcu_read_ongoing();
 
-	/*
+	/* All threads should read qparity before accessing data structure
+	 * where new ptr points to.  In the "then" case, rcu_thread_offline
+	 * includes a memory barrier.
+	 *
 	 * Mark the writer thread offline to make sure we don't wait for
 	 * our own quiescent state. This allows using synchronize_rcu()
 	 * in threads registered as readers.
@@ -330,7 +384,7 @@ void synchronize_rcu(void)
 	 */
 	if (urcu_wait_add(&gp_waiters, &wait) != 0) {
 		/* Not first in queue: will be awakened by another thread. */
-		urcu_adaptative_busy_wait(&wait);
+		urcu_adaptative_busy_wait(&wait, &waiter_spin);
 		goto gp_end;
 	}
 	/* We won't need to wake ourself up */
@@ -343,47 +397,182 @@ void synchronize_rcu(void)
 	 */
 	urcu_move_waiters(&waiters, &gp_waiters);
 
-	if (cds_list_empty(&registry))
-		goto out;
-
-	/* Increment current G.P. */
-	CMM_STORE_SHARED(rcu_gp.ctr, rcu_gp.ctr + RCU_GP_CTR);
-
-	/*
-	 * Must commit rcu_gp.ctr update to memory before waiting for
-	 * quiescent state. Failure to do so could result in the writer
-	 * waiting forever while new readers are always accessing data
-	 * (no progress). Enforce compiler-order of store to rcu_gp.ctr
-	 * before load URCU_TLS(rcu_reader).ctr.
-	 */
-	cmm_barrier();
+	gp_stats_gp_start(&gp_stats);
+	do_grace_period(0);
+	gp_stats_gp_end(&gp_stats, &waiters, 0);
 
+	mutex_unlock(&rcu_gp_lock);
+	urcu_wake_all_waiters(&waiters);
+gp_end:
 	/*
-	 * Adding a cmm_smp_mb() which is _not_ formally required, but makes the
-	 * model easier to understand. It does not have a big performance impact
-	 * anyway, given this is the write-side.
+	 * Finish waiting for reader threads before letting the old ptr being
+	 * freed.
 	 */
-	cmm_smp_mb();
+	if (was_online)
+		rcu_thread_online();
+	else
+		cmm_smp_mb();
+}
 
-	/*
-	 * Wait for readers to observe new count of be quiescent.
-	 */
-	wait_for_readers(&registry, NULL, &qsreaders);
+/*
+ * Grace period for the caller only, which does not queue behind the
+ * current leader: it takes rcu_gp_lock directly. The threads queued in
+ * gp_waiters are left to their leader, which owns the queue once first
+ * in it: its own wait node is on its stack. The caller orders its prior
+ * memory accesses before, and must be offline.
+ */
+static void __synchronize_rcu_private(int expedited)
+{
+	unsigned long cookie;
 
-	/*
-	 * Put quiescent reader list back into registry.
-	 */
-	cds_list_splice(&qsreaders, &registry);
-out:
+	cookie = rcu_gp_seq_snap();
+	mutex_lock(&rcu_gp_lock);
+	/* Served by a grace period which ended while we waited for it. */
+	if (!rcu_gp_seq_done(cookie)) {
+		gp_stats_gp_start(&gp_stats);
+		do_grace_period(expedited);
+		gp_stats_gp_end(&gp_stats, NULL, 1);
+	}
 	mutex_unlock(&rcu_gp_lock);
-	urcu_wake_all_waiters(&waiters);
-gp_end:
+}
+
+/*
+ * Expedited grace periods busy-wait for readers instead of sleeping on
+ * the futex.
+ */
+void synchronize_rcu_expedited(void)
+{
+	unsigned long was_online;
+
+	was_online = rcu_read_ongoing();
+
+	/* See synchronize_rcu(). */
+	if (was_online)
+		rcu_thread_offline();
+	else
+		cmm_smp_mb();
+
+	__synchronize_rcu_private(1);
+
 	if (was_online)
 		rcu_thread_online();
 	else
 		cmm_smp_mb();
 }
-#endif  /* !(CAA_BITS_PER_LONG < 64) */
+
+int synchronize_rcu_timeout(const struct timespec *timeout)
+{
+	unsigned long was_online;
+	int ret;
+
+	was_online = rcu_read_ongoing();
+
+	/* See synchronize_rcu(). */
+	if (was_online)
+		rcu_thread_offline();
+	else
+		cmm_smp_mb();
+
+	ret = gp_poll_synchronize_timeout(timeout);
+
+	if (was_online)
+		rcu_thread_online();
+	else
+		cmm_smp_mb();
+	return ret;
+}
+
+/*
+ * Grace period led by the poll worker on behalf of the queued waiters,
+ * when the first of them is asynchronous.
+ */
+static void rcu_gp_lead_waiters(void)
+{
+	struct urcu_waiters waiters;
+
+	mutex_lock(&rcu_gp_lock);
+	urcu_move_waiters(&waiters, &gp_waiters);
+	if (!waiters.head) {
+		mutex_unlock(&rcu_gp_lock);
+		return;
+	}
+	gp_stats_gp_start(&gp_stats);
+	do_grace_period(0);
+	gp_stats_gp_end(&gp_stats, &waiters, 0);
+	mutex_unlock(&rcu_gp_lock);
+
+	urcu_wake_all_waiters(&waiters);
+}
+
+static void rcu_gp_poll_synchronize(void)
+{
+	/* Order prior memory accesses before reading the sequence. */
+	cmm_smp_mb();
+	__synchronize_rcu_private(0);
+}
+
+int rcu_gp_notify_eventfd(int fd)
+{
+	return gp_notify_eventfd(&gp_waiters, fd);
+}
+
+/*
+ * Opt in to hierarchical grace period detection.
+ */
+int rcu_enable_hierarchical_gp(int cpus_per_group)
+{
+	int ret;
+
+	mutex_lock(&rcu_gp_lock);
+	mutex_lock(&rcu_registry_lock);
+	ret = reader_scan_enable_tree(&registry_scan, cpus_per_group);
+	mutex_unlock(&rcu_registry_lock);
+	mutex_unlock(&rcu_gp_lock);
+	return ret;
+}
+
+void rcu_gp_stats_enable(int enable)
+{
+	gp_stats_enable(&gp_stats, enable);
+}
+
+void rcu_gp_stats_get(struct rcu_gp_stats *stats)
+{
+	gp_stats_get(&gp_stats, stats);
+}
+
+void rcu_gp_stats_reset(void)
+{
+	gp_stats_reset(&gp_stats);
+}
+
+int rcu_set_stall_detector(unsigned long timeout_ms, rcu_stall_func_t func,
+		void *priv)
+{
+	int ret;
+
+	mutex_lock(&rcu_gp_lock);
+	ret = stall_detector_set(&stall_detector, timeout_ms, func, priv);
+	mutex_unlock(&rcu_gp_lock);
+	return ret;
+}
+
+int rcu_set_spin_policy(const struct rcu_spin_policy *policy)
+{
+	int ret;
+
+	ret = urcu_spin_set(&gp_spin, policy);
+	if (ret)
+		return ret;
+	return urcu_spin_set(&waiter_spin, policy);
+}
+
+void rcu_get_spin_policy(struct rcu_spin_policy *policy)
+{
+	urcu_spin_get(&gp_spin, policy);
+	policy->gp_spin_ns = CMM_LOAD_SHARED(gp_spin.spin_ns);
+	policy->waiter_spin_ns = CMM_LOAD_SHARED(waiter_spin.spin_ns);
+}
 
 /*
  * library wrappers to be used by non-LGPL compatible source code.
@@ -419,14 +608,20 @@ void rcu_thread_online(void)
 	_rcu_thread_online();
 }
 
+/*
+ * Registration is lock-free: the reader joins the registry at the start
+ * of the next grace period, and the grace period in progress, if any,
+ * does not need to wait for it.
+ */
 void rcu_register_thread(void)
 {
 	URCU_TLS(rcu_reader).tid = pthread_self();
 	assert(URCU_TLS(rcu_reader).ctr == 0);
+#ifdef CONFIG_RCU_GP_REPLICAS
+	URCU_TLS(rcu_reader).gp_replica = gp_replica_select();
+#endif
 
-	mutex_lock(&rcu_gp_lock);
-	cds_list_add(&URCU_TLS(rcu_reader).node, &registry);
-	mutex_unlock(&rcu_gp_lock);
+	reader_scan_join(&registry_scan, &URCU_TLS(rcu_reader).node);
 	_rcu_thread_online();
 }
 
@@ -437,9 +632,10 @@ void rcu_unregister_thread(void)
 	 * with a waiting writer.
 	 */
 	_rcu_thread_offline();
-	mutex_lock(&rcu_gp_lock);
-	cds_list_del(&URCU_TLS(rcu_reader).node);
-	mutex_unlock(&rcu_gp_lock);
+	mutex_lock(&rcu_registry_lock);
+	reader_scan_leave(&registry_scan, &registry,
+			&URCU_TLS(rcu_reader).node, &URCU_TLS(rcu_reader).ctr);
+	mutex_unlock(&rcu_registry_lock);
 }
 
 void rcu_exit(void)
@@ -30,12 +30,16 @@
 
 #include <stdlib.h>
 #include <pthread.h>
+#include <time.h>
 
 /*
  * See urcu-pointer.h and urcu/static/urcu-pointer.h for pointer
  * publication headers.
  */
 #include <urcu-pointer.h>
+#include <urcu/gp-stats.h>
+#include <urcu/stall.h>
+#include <urcu/spin-policy.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -117,6 +121,63 @@ extern void rcu_thread_online(void);
 
 extern void synchronize_rcu(void);
 
+/*
+ * Grace period polling. A cookie returned by get_state_synchronize_rcu()
+ * or start_poll_synchronize_rcu() is reached once a full grace period
+ * has elapsed since the call. See rcu-api.txt.
+ */
+extern unsigned long get_state_synchronize_rcu(void);
+extern unsigned long start_poll_synchronize_rcu(void);
+extern int poll_state_synchronize_rcu(unsigned long cookie);
+extern void cond_synchronize_rcu(unsigned long cookie);
+
+/*
+ * Lower-latency synchronize_rcu(), at the expense of busy-waiting on the
+ * readers rather than sleeping.
+ */
+extern void synchronize_rcu_expedited(void);
+
+/*
+ * synchronize_rcu() waiting at most "timeout". Returns 0 if a grace period
+ * has elapsed, -ETIMEDOUT otherwise.
+ */
+extern int synchronize_rcu_timeout(const struct timespec *timeout);
+
+/*
+ * Write 1, as an 8-byte integer, to "fd" (usually an eventfd) once a grace
+ * period has elapsed, without blocking. Returns 0 or -ENOMEM.
+ */
+extern int rcu_gp_notify_eventfd(int fd);
+
+/*
+ * Hierarchical grace period detection: readers are scanned in parallel
+ * by one thread per group of "cpus_per_group" CPUs, or per NUMA node if
+ * 0. Returns 0 on success, negative error value otherwise.
+ */
+extern int rcu_enable_hierarchical_gp(int cpus_per_group);
+
+/*
+ * Grace period statistics, collected while enabled: latency histograms
+ * of grace periods and of their waits for readers, busy-wait and sleep
+ * counts, callers served and readers scanned. See rcu-api.txt.
+ */
+extern void rcu_gp_stats_enable(int enable);
+extern void rcu_gp_stats_get(struct rcu_gp_stats *stats);
+extern void rcu_gp_stats_reset(void);
+
+/*
+ * Report each reader holding up a grace period for more than timeout_ms
+ * to "func", then again every timeout_ms. A NULL "func" disables it.
+ */
+extern int rcu_set_stall_detector(unsigned long timeout_ms,
+		rcu_stall_func_t func, void *priv);
+
+/*
+ * How long waits for readers and for grace periods spin before sleeping.
+ */
+extern int rcu_set_spin_policy(const struct rcu_spin_policy *policy);
+extern void rcu_get_spin_policy(struct rcu_spin_policy *policy);
+
 /*
  * Reader thread registration.
  */
@@ -0,0 +1,292 @@
+#ifndef _URCU_READ_PROFILE_IMPL_H
+#define _URCU_READ_PROFILE_IMPL_H
+
+/*
+ * urcu-read-profile-impl.h
+ *
+ * Userspace RCU library - read-side critical section sampling profiler
+ *
+ * TO BE INCLUDED ONLY FROM URCU LIBRARY CODE, by urcu.c and urcu-bp.c.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <urcu/arch.h>
+#include <urcu/compiler.h>
+#include <urcu/system.h>
+#include <urcu/uatomic.h>
+#include <urcu/read-profile.h>
+
+#ifdef CONFIG_RCU_READ_PROFILE
+
+/* Callers per thread buffer, the last entry taking the overflow. */
+#define READ_PROFILE_CALLERS	64
+
+/* Outermost sections between two checks for enabling, while disabled. */
+#define READ_PROFILE_RECHECK	65536
+
+/*
+ * Written by its owner thread only, read by rcu_read_profile_get().
+ * Buffers are never freed: they are released when their thread exits,
+ * and taken over by later threads, entries included.
+ */
+struct rcu_read_profile_buf {
+	struct rcu_read_profile_buf *next;
+	int in_use;
+	unsigned long gen;		/* Entries are of this reset. */
+	struct rcu_read_profile_entry entry[READ_PROFILE_CALLERS];
+};
+
+DEFINE_URCU_TLS(struct rcu_read_profile_thread, rcu_read_profile);
+
+static unsigned long read_profile_period;
+static unsigned long read_profile_gen;
+static struct rcu_read_profile_buf *read_profile_bufs;
+static pthread_mutex_t read_profile_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t read_profile_once = PTHREAD_ONCE_INIT;
+static pthread_key_t read_profile_key;
+
+static void read_profile_thread_exit(void *arg)
+{
+	struct rcu_read_profile_buf *buf = arg;
+
+	cmm_smp_mb();
+	uatomic_set(&buf->in_use, 0);
+}
+
+static void read_profile_init_key(void)
+{
+	if (pthread_key_create(&read_profile_key, read_profile_thread_exit))
+		abort();
+}
+
+static struct rcu_read_profile_buf *read_profile_buf_get(void)
+{
+	struct rcu_read_profile_buf *buf, *head;
+
+	buf = URCU_TLS(rcu_read_profile).buf;
+	if (caa_likely(buf))
+		return buf;
+
+	(void) pthread_once(&read_profile_once, read_profile_init_key);
+	for (buf = uatomic_read(&read_profile_bufs); buf; buf = buf->next) {
+		if (!uatomic_read(&buf->in_use)
+				&& !uatomic_cmpxchg(&buf->in_use, 0, 1))
+			goto found;
+	}
+	buf = calloc(1, sizeof(*buf));
+	if (!buf)
+		return NULL;
+	buf->in_use = 1;
+	buf->gen = uatomic_read(&read_profile_gen);
+	do {
+		head = uatomic_read(&read_profile_bufs);
+		buf->next = head;
+	} while (uatomic_cmpxchg(&read_profile_bufs, head, buf) != head);
+found:
+	if (pthread_setspecific(read_profile_key, buf)) {
+		uatomic_set(&buf->in_use, 0);
+		return NULL;
+	}
+	URCU_TLS(rcu_read_profile).buf = buf;
+	return buf;
+}
+
+static struct rcu_read_profile_entry *
+read_profile_entry(struct rcu_read_profile_buf *buf, void *caller)
+{
+	struct rcu_read_profile_entry *entry;
+	unsigned long hash, i;
+
+	hash = ((unsigned long) caller >> 2) * 0x9E3779B9UL;
+	for (i = 0; i < READ_PROFILE_CALLERS - 1; i++) {
+		entry = &buf->entry[(hash + i) % (READ_PROFILE_CALLERS - 1)];
+		if (entry->caller == caller)
+			return entry;
+		if (!entry->caller) {
+			CMM_STORE_SHARED(entry->caller, caller);
+			return entry;
+		}
+	}
+	return &buf->entry[READ_PROFILE_CALLERS - 1];
+}
+
+void rcu_read_profile_begin(void *caller)
+{
+	struct rcu_read_profile_thread *thread = &URCU_TLS(rcu_read_profile);
+	unsigned long period;
+
+	period = CMM_LOAD_SHARED(read_profile_period);
+	if (!period) {
+		thread->countdown = READ_PROFILE_RECHECK;
+		return;
+	}
+	thread->countdown = period - 1;
+	thread->caller = caller;
+	thread->sampling = 1;
+	thread->start = caa_get_cycles();
+}
+
+void rcu_read_profile_end(void)
+{
+	struct rcu_read_profile_thread *thread = &URCU_TLS(rcu_read_profile);
+	struct rcu_read_profile_buf *buf;
+	struct rcu_read_profile_entry *entry;
+	uint64_t cycles;
+	unsigned long gen;
+
+	cycles = caa_get_cycles() - thread->start;
+	thread->sampling = 0;
+
+	buf = read_profile_buf_get();
+	if (!buf)
+		return;
+	gen = CMM_LOAD_SHARED(read_profile_gen);
+	if (caa_unlikely(buf->gen != gen)) {
+		memset(buf->entry, 0, sizeof(buf->entry));
+		cmm_smp_wmb();
+		CMM_STORE_SHARED(buf->gen, gen);
+	}
+	entry = read_profile_entry(buf, thread->caller);
+	CMM_STORE_SHARED(entry->nr_samples, entry->nr_samples + 1);
+	CMM_STORE_SHARED(entry->total_cycles, entry->total_cycles + cycles);
+	if (cycles > entry->max_cycles)
+		CMM_STORE_SHARED(entry->max_cycles, cycles);
+}
+
+static int read_profile_cmp(const void *a, const void *b)
+{
+	const struct rcu_read_profile_entry *ea = a, *eb = b;
+
+	if (ea->total_cycles != eb->total_cycles)
+		return ea->total_cycles < eb->total_cycles ? 1 : -1;
+	return 0;
+}
+
+static int read_profile_enable(unsigned long period)
+{
+	CMM_STORE_SHARED(read_profile_period, period);
+	return 0;
+}
+
+/*
+ * Merge the entries of the buffers of the current reset, read while
+ * their threads update them: counts may be off by the samples in flight.
+ */
+static int read_profile_get(struct rcu_read_profile_entry *entries,
+		int nr_entries)
+{
+	struct rcu_read_profile_buf *buf;
+	struct rcu_read_profile_entry *agg = NULL, *tmp, e;
+	unsigned long gen;
+	int nr = 0, alloc = 0, i, j;
+
+	if (nr_entries < 0)
+		return -EINVAL;
+	pthread_mutex_lock(&read_profile_lock);
+	gen = uatomic_read(&read_profile_gen);
+	for (buf = uatomic_read(&read_profile_bufs); buf; buf = buf->next) {
+		if (CMM_LOAD_SHARED(buf->gen) != gen)
+			continue;
+		cmm_smp_rmb();
+		for (i = 0; i < READ_PROFILE_CALLERS; i++) {
+			e.caller = CMM_LOAD_SHARED(buf->entry[i].caller);
+			e.nr_samples = CMM_LOAD_SHARED(buf->entry[i].nr_samples);
+			e.total_cycles = CMM_LOAD_SHARED(buf->entry[i].total_cycles);
+			e.max_cycles = CMM_LOAD_SHARED(buf->entry[i].max_cycles);
+			if (!e.nr_samples)
+				continue;
+			for (j = 0; j < nr; j++) {
+				if (agg[j].caller == e.caller)
+					break;
+			}
+			if (j < nr) {
+				agg[j].nr_samples += e.nr_samples;
+				agg[j].total_cycles += e.total_cycles;
+				if (e.max_cycles > agg[j].max_cycles)
+					agg[j].max_cycles = e.max_cycles;
+				continue;
+			}
+			if (nr == alloc) {
+				alloc = alloc ? 2 * alloc : READ_PROFILE_CALLERS;
+				tmp = realloc(agg, alloc * sizeof(*agg));
+				if (!tmp) {
+					pthread_mutex_unlock(&read_profile_lock);
+					free(agg);
+					return -ENOMEM;
+				}
+				agg = tmp;
+			}
+			agg[nr++] = e;
+		}
+	}
+	pthread_mutex_unlock(&read_profile_lock);
+
+	qsort(agg, nr, sizeof(*agg), read_profile_cmp);
+	memcpy(entries, agg, caa_min(nr, nr_entries) * sizeof(*agg));
+	free(agg);
+	return nr;
+}
+
+/* Threads drop their entries of earlier resets on their next sample. */
+static void read_profile_reset(void)
+{
+	pthread_mutex_lock(&read_profile_lock);
+	uatomic_inc(&read_profile_gen);
+	pthread_mutex_unlock(&read_profile_lock);
+}
+
+#else /* !CONFIG_RCU_READ_PROFILE */
+
+static int read_profile_enable(unsigned long period)
+{
+	return -ENOSYS;
+}
+
+static int read_profile_get(struct rcu_read_profile_entry *entries,
+		int nr_entries)
+{
+	return -ENOSYS;
+}
+
+static void read_profile_reset(void)
+{
+}
+
+#endif /* !CONFIG_RCU_READ_PROFILE */
+
+int rcu_read_profile_enable(unsigned long period)
+{
+	return read_profile_enable(period);
+}
+
+int rcu_read_profile_get(struct rcu_read_profile_entry *entries,
+		int nr_entries)
+{
+	return read_profile_get(entries, nr_entries);
+}
+
+void rcu_read_profile_reset(void)
+{
+	read_profile_reset();
+}
+
+#endif /* _URCU_READ_PROFILE_IMPL_H */
@@ -0,0 +1,766 @@
+#ifndef _URCU_SCAN_IMPL_H
+#define _URCU_SCAN_IMPL_H
+
+/*
+ * urcu-scan-impl.h
+ *
+ * Userspace RCU library - dense reader array scanned by grace periods
+ *
+ * TO BE INCLUDED ONLY FROM URCU LIBRARY CODE, after the flavor's static
+ * header (struct rcu_gp, struct rcu_reader and rcu_reader_state()).
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "config.h"
+#include <urcu/compiler.h>
+#include <urcu/arch.h>
+#include <urcu/list.h>
+#include <urcu/uatomic.h>
+#include <urcu/futex.h>
+#include "urcu-die.h"
+
+#if defined(HAVE_SCHED_SETAFFINITY) && defined(HAVE_CPU_SET) \
+	&& (SCHED_SETAFFINITY_ARGS == 3)
+#define READER_SCAN_HAVE_TREE
+#endif
+
+/*
+ * The registry list is only used for registration bookkeeping. Grace
+ * periods scan a contiguous array of pointers to the reader ctr
+ * instead, and keep track of the readers they still wait for in
+ * bitmaps indexed like the array. This avoids chasing list pointers
+ * and moving list nodes on every loop, and lets us prefetch the ctr
+ * of the next pending readers while checking the current one.
+ *
+ * The array is rebuilt from the registry by the first grace period
+ * following a registry update. All accesses are done with the registry
+ * lock held. Flavors which let grace periods release that lock while
+ * waiting for readers remove departing readers from the bitmaps of the
+ * grace period in progress with reader_scan_leave().
+ *
+ * Registering threads do not take the registry lock: they push their
+ * reader on a lock-free list of joining readers, which the next grace
+ * period splices into the registry.
+ */
+
+/* Number of pending readers whose ctr is prefetched ahead of the scan. */
+#define READER_SCAN_PREFETCH	8
+
+/* Children per node of the hierarchical scan combining tree. */
+#define READER_SCAN_TREE_FANOUT	16
+
+/* Active attempts before the hierarchical scan threads block on futex. */
+#define READER_SCAN_TREE_SPIN	1000
+
+#define READER_SCAN_BITS_PER_LONG	(sizeof(unsigned long) * CHAR_BIT)
+#define READER_SCAN_WORDS(nr)		\
+	(((nr) + READER_SCAN_BITS_PER_LONG - 1) / READER_SCAN_BITS_PER_LONG)
+
+struct reader_scan_tree;
+
+struct reader_scan {
+	struct rcu_gp *gp;		/* Counter observed by the readers. */
+	unsigned long **ctr;		/* Reader ctr, indexed like bitmaps. */
+	unsigned long *present;		/* Slots of ctr[] in use. */
+	unsigned long *pending;		/* Readers still waited for. */
+	unsigned long *cur_snap;	/* Readers which observed current ctr. */
+	unsigned long nr;		/* Number of slots in use or holes. */
+	unsigned long alloc;		/* Allocated ctr[] slots. */
+	int stale;			/* Registry updated since rebuild. */
+	struct reader_scan_tree *tree;	/* NULL unless hierarchical. */
+	/* Readers not merged in the registry yet, linked by node.next. */
+	struct cds_list_head *joining;
+};
+
+#define READER_SCAN_INIT(_gp)	{ .gp = (_gp), .stale = 1 }
+
+#define DEFINE_READER_SCAN(x)	struct reader_scan x = READER_SCAN_INIT(&rcu_gp)
+
+/*
+ * Hierarchical scanning. Readers are grouped by the set of CPUs they are
+ * allowed to run on, and the readers of each group are laid out in their
+ * own range of bitmap words. Each group is scanned by a thread bound to
+ * the group's CPUs, so reader ctr are read from a nearby cache. Scanner
+ * threads report completion of their pass up a combining tree of
+ * counters, and the last one to reach the root wakes up the grace
+ * period thread.
+ */
+struct reader_scan_node {
+	struct reader_scan_node *parent;	/* NULL for the root. */
+	long nr_children;
+	long remaining;			/* Children yet to report this pass. */
+} __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+
+struct reader_scan_group {
+	struct reader_scan *scan;
+	struct reader_scan_node *parent;
+	unsigned long begin, end;	/* Range of bitmap words scanned. */
+	unsigned long count;		/* Readers, used while rebuilding. */
+	int32_t seen;			/* Last pass generation handled. */
+#ifdef READER_SCAN_HAVE_TREE
+	cpu_set_t cpus;
+#endif
+} __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+
+struct reader_scan_tree {
+	struct reader_scan_group *groups;
+	unsigned long nr_groups;
+	struct reader_scan_node *nodes;
+	unsigned long nr_nodes;
+	pid_t pid;			/* Process owning the scanners, or 0. */
+	/* Current pass, published by incrementing gen. */
+	unsigned long *input_readers;
+	unsigned long *cur_snap_readers;
+	int busy;			/* Some group still has pending readers. */
+	int32_t gen __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+	int32_t nr_sleepers;		/* Scanners blocked on gen. */
+	int32_t pass_pending __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+	int32_t futex;			/* Grace period thread wait. */
+};
+
+static inline void reader_scan_init(struct reader_scan *scan,
+		struct rcu_gp *gp)
+{
+	memset(scan, 0, sizeof(*scan));
+	scan->gp = gp;
+	scan->stale = 1;
+}
+
+/* Only for scans which never enabled hierarchical scanning. */
+static inline void reader_scan_fini(struct reader_scan *scan)
+{
+	assert(!scan->tree);
+	free(scan->ctr);
+	free(scan->present);
+	free(scan->pending);
+	free(scan->cur_snap);
+}
+
+/*
+ * Called with the registry lock held after each addition to or removal
+ * from the registry.
+ */
+static inline void reader_scan_mark_stale(struct reader_scan *scan)
+{
+	scan->stale = 1;
+}
+
+/*
+ * Return the index of the first bit set in "bitmap" at or after "i" and
+ * before "end", or "end" if there is none.
+ */
+static inline unsigned long reader_scan_find(unsigned long *bitmap,
+		unsigned long i, unsigned long end)
+{
+	unsigned long word, w;
+
+	if (i >= end)
+		return end;
+	w = i / READER_SCAN_BITS_PER_LONG;
+	word = bitmap[w] & (~0UL << (i % READER_SCAN_BITS_PER_LONG));
+	while (!word) {
+		if (++w >= READER_SCAN_WORDS(end))
+			return end;
+		word = bitmap[w];
+	}
+	return caa_min(w * READER_SCAN_BITS_PER_LONG + __builtin_ctzl(word),
+			end);
+}
+
+#define reader_scan_for_each(scan, bitmap, i)				\
+	for ((i) = reader_scan_find(bitmap, 0, (scan)->nr);		\
+	     (i) < (scan)->nr;						\
+	     (i) = reader_scan_find(bitmap, (i) + 1, (scan)->nr))
+
+static inline void reader_scan_clear(unsigned long *bitmap, unsigned long i)
+{
+	bitmap[i / READER_SCAN_BITS_PER_LONG] &=
+		~(1UL << (i % READER_SCAN_BITS_PER_LONG));
+}
+
+static inline void reader_scan_set(unsigned long *bitmap, unsigned long i)
+{
+	bitmap[i / READER_SCAN_BITS_PER_LONG] |=
+		1UL << (i % READER_SCAN_BITS_PER_LONG);
+}
+
+/*
+ * Lock-free registration: push "node" on the list of joining readers.
+ */
+static inline void reader_scan_join(struct reader_scan *scan,
+		struct cds_list_head *node)
+{
+	struct cds_list_head *old, *head;
+
+	head = CMM_LOAD_SHARED(scan->joining);
+	do {
+		old = head;
+		node->next = old;
+		head = uatomic_cmpxchg(&scan->joining, old, node);
+	} while (head != old);
+}
+
+/*
+ * Splice the joining readers into the registry. Called with the registry
+ * lock held, by each grace period before it starts scanning. The xchg
+ * orders the updates preceding the grace period before the push of
+ * readers the merge misses, hence before their read-side critical
+ * sections: a grace period never needs to wait for them.
+ */
+static inline void reader_scan_merge(struct reader_scan *scan,
+		struct cds_list_head *registry)
+{
+	struct cds_list_head *node, *next;
+
+	node = uatomic_xchg(&scan->joining, NULL);
+	if (!node)
+		return;
+	for (; node; node = next) {
+		next = node->next;
+		cds_list_add(node, registry);
+	}
+	reader_scan_mark_stale(scan);
+}
+
+/*
+ * Remove a reader, identified by its list node and ctr, from the
+ * registry, and from the bitmaps of the grace period in progress if any.
+ * Called with the registry lock held. The reader is merged first if it
+ * is still joining.
+ */
+static inline void reader_scan_leave(struct reader_scan *scan,
+		struct cds_list_head *registry,
+		struct cds_list_head *node, unsigned long *ctr)
+{
+	unsigned long i;
+
+	reader_scan_merge(scan, registry);
+	cds_list_del(node);
+	reader_scan_for_each(scan, scan->present, i) {
+		if (scan->ctr[i] == ctr) {
+			reader_scan_clear(scan->present, i);
+			reader_scan_clear(scan->pending, i);
+			reader_scan_clear(scan->cur_snap, i);
+			break;
+		}
+	}
+	reader_scan_mark_stale(scan);
+}
+
+static unsigned long reader_scan_tree_group(struct reader_scan_tree *tree,
+		pthread_t tid, unsigned long *next);
+
+static void reader_scan_rebuild(struct reader_scan *scan,
+		struct cds_list_head *registry)
+{
+	struct reader_scan_tree *tree = scan->tree;
+	struct reader_scan_group *group;
+	struct rcu_reader *index;
+	unsigned long nr = 0, words, slot, i, next = 0;
+	unsigned int *group_of = NULL;
+
+	cds_list_for_each_entry(index, registry, node)
+		nr++;
+	if (tree) {
+		group_of = malloc(caa_max(nr, 1UL) * sizeof(*group_of));
+		if (!group_of)
+			urcu_die(ENOMEM);
+		for (i = 0; i < tree->nr_groups; i++)
+			tree->groups[i].count = 0;
+		i = 0;
+		cds_list_for_each_entry(index, registry, node) {
+			group_of[i] = reader_scan_tree_group(tree, index->tid,
+					&next);
+			tree->groups[group_of[i++]].count++;
+		}
+		words = 0;
+		for (i = 0; i < tree->nr_groups; i++) {
+			group = &tree->groups[i];
+			group->begin = words;
+			words += READER_SCAN_WORDS(group->count);
+			group->end = words;
+			group->count = 0;
+		}
+	} else {
+		words = READER_SCAN_WORDS(nr);
+	}
+	if (words > READER_SCAN_WORDS(scan->alloc)) {
+		words = caa_max(READER_SCAN_WORDS(scan->alloc) << 1, words);
+		free(scan->ctr);
+		free(scan->present);
+		free(scan->pending);
+		free(scan->cur_snap);
+		scan->ctr = malloc(words * READER_SCAN_BITS_PER_LONG
+				* sizeof(*scan->ctr));
+		scan->present = malloc(words * sizeof(*scan->present));
+		scan->pending = malloc(words * sizeof(*scan->pending));
+		scan->cur_snap = malloc(words * sizeof(*scan->cur_snap));
+		if (!scan->ctr || !scan->present || !scan->pending
+				|| !scan->cur_snap)
+			urcu_die(ENOMEM);
+		scan->alloc = words * READER_SCAN_BITS_PER_LONG;
+	}
+	memset(scan->present, 0,
+		READER_SCAN_WORDS(scan->alloc) * sizeof(*scan->present));
+	i = 0;
+	cds_list_for_each_entry(index, registry, node) {
+		if (tree) {
+			group = &tree->groups[group_of[i++]];
+			slot = group->begin * READER_SCAN_BITS_PER_LONG
+				+ group->count++;
+		} else {
+			slot = i++;
+		}
+		scan->ctr[slot] = &index->ctr;
+		reader_scan_set(scan->present, slot);
+	}
+	if (tree)
+		scan->nr = (tree->nr_groups ?
+			tree->groups[tree->nr_groups - 1].end : 0)
+			* READER_SCAN_BITS_PER_LONG;
+	else
+		scan->nr = nr;
+	scan->stale = 0;
+	free(group_of);
+}
+
+/*
+ * Prepare the scan for a new grace period: rebuild the array if needed,
+ * mark every reader as pending and clear cur_snap.
+ */
+static void reader_scan_start(struct reader_scan *scan,
+		struct cds_list_head *registry)
+{
+	unsigned long words;
+
+	if (scan->stale)
+		reader_scan_rebuild(scan, registry);
+	words = READER_SCAN_WORDS(scan->nr);
+	memcpy(scan->pending, scan->present, words * sizeof(*scan->pending));
+	memset(scan->cur_snap, 0, words * sizeof(*scan->cur_snap));
+}
+
+/*
+ * Check the state of every reader pending in "input_readers" within
+ * bitmap words [begin, end). Quiescent readers are removed from it;
+ * readers which observed the current scan->gp->ctr are moved to
+ * "cur_snap_readers" if non-NULL, or removed. Readers still using an old
+ * snapshot are left pending. Return 1 if no reader is left pending.
+ */
+static int reader_scan_pass_range(struct reader_scan *scan,
+		unsigned long *input_readers,
+		unsigned long *cur_snap_readers,
+		unsigned long begin, unsigned long end)
+{
+	unsigned long i, prefetch;
+	int n, empty = 1;
+
+	begin *= READER_SCAN_BITS_PER_LONG;
+	end = caa_min(end * READER_SCAN_BITS_PER_LONG, scan->nr);
+
+	prefetch = reader_scan_find(input_readers, begin, end);
+	for (n = 0; n < READER_SCAN_PREFETCH && prefetch < end; n++) {
+		__builtin_prefetch(scan->ctr[prefetch]);
+		prefetch = reader_scan_find(input_readers, prefetch + 1, end);
+	}
+
+	for (i = reader_scan_find(input_readers, begin, end); i < end;
+			i = reader_scan_find(input_readers, i + 1, end)) {
+		if (prefetch < end) {
+			__builtin_prefetch(scan->ctr[prefetch]);
+			prefetch = reader_scan_find(input_readers,
+					prefetch + 1, end);
+		}
+		switch (rcu_reader_state(scan->gp, scan->ctr[i])) {
+		case RCU_READER_ACTIVE_CURRENT:
+			if (cur_snap_readers) {
+				reader_scan_set(cur_snap_readers, i);
+				reader_scan_clear(input_readers, i);
+				break;
+			}
+			/* Fall-through */
+		case RCU_READER_INACTIVE:
+			reader_scan_clear(input_readers, i);
+			break;
+		case RCU_READER_ACTIVE_OLD:
+			/*
+			 * Old snapshot. Leaving the reader pending will
+			 * make us busy-loop until the snapshot becomes
+			 * current or the reader becomes inactive.
+			 */
+			empty = 0;
+			break;
+		}
+	}
+	return empty;
+}
+
+#ifdef READER_SCAN_HAVE_TREE
+
+/*
+ * Return the group of a reader allowed to run on the CPUs of a single
+ * group. Other readers have no locality to preserve, and are spread
+ * across groups.
+ */
+static unsigned long reader_scan_tree_group(struct reader_scan_tree *tree,
+		pthread_t tid, unsigned long *next)
+{
+	cpu_set_t cpus, and;
+	unsigned long i;
+
+	if (!pthread_getaffinity_np(tid, sizeof(cpus), &cpus)) {
+		for (i = 0; i < tree->nr_groups; i++) {
+			CPU_AND(&and, &cpus, &tree->groups[i].cpus);
+			if (CPU_EQUAL(&and, &cpus))
+				return i;
+		}
+	}
+	return (*next)++ % tree->nr_groups;
+}
+
+/*
+ * Report completion of a group's pass. The last reporter of each node
+ * reports for the node to its parent.
+ */
+static void reader_scan_tree_report(struct reader_scan_tree *tree,
+		struct reader_scan_node *node)
+{
+	for (; node; node = node->parent) {
+		if (uatomic_add_return(&node->remaining, -1))
+			return;
+	}
+	uatomic_set(&tree->pass_pending, 0);
+	/* Write pass_pending before read futex */
+	cmm_smp_mb();
+	if (uatomic_read(&tree->futex) == -1) {
+		uatomic_set(&tree->futex, 0);
+		futex_async(&tree->futex, FUTEX_WAKE, 1,
+			NULL, NULL, 0);
+	}
+}
+
+static void *reader_scan_tree_thread(void *arg)
+{
+	struct reader_scan_group *group = arg;
+	struct reader_scan *scan = group->scan;
+	struct reader_scan_tree *tree = scan->tree;
+	int32_t gen;
+	int attempts;
+
+	(void) pthread_setaffinity_np(pthread_self(), sizeof(group->cpus),
+			&group->cpus);
+	for (;;) {
+		attempts = 0;
+		while ((gen = uatomic_read(&tree->gen)) == group->seen) {
+			if (++attempts < READER_SCAN_TREE_SPIN) {
+				caa_cpu_relax();
+				continue;
+			}
+			uatomic_inc(&tree->nr_sleepers);
+			/* Write nr_sleepers before read gen */
+			cmm_smp_mb();
+			if (uatomic_read(&tree->gen) == group->seen)
+				futex_async(&tree->gen, FUTEX_WAIT,
+					group->seen, NULL, NULL, 0);
+			uatomic_dec(&tree->nr_sleepers);
+		}
+		group->seen = gen;
+		/* Read gen before read pass */
+		cmm_smp_mb();
+		if (!reader_scan_pass_range(scan, tree->input_readers,
+				tree->cur_snap_readers,
+				group->begin, group->end))
+			CMM_STORE_SHARED(tree->busy, 1);
+		reader_scan_tree_report(tree, group->parent);
+	}
+	return NULL;
+}
+
+/*
+ * Create the scanner threads, on first use or first use since fork().
+ */
+static void reader_scan_tree_spawn(struct reader_scan_tree *tree)
+{
+	pthread_attr_t attr;
+	pthread_t tid;
+	unsigned long i;
+	int ret;
+
+	ret = pthread_attr_init(&attr);
+	if (ret)
+		urcu_die(ret);
+	ret = pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (ret)
+		urcu_die(ret);
+	tree->nr_sleepers = 0;
+	tree->futex = 0;
+	for (i = 0; i < tree->nr_groups; i++) {
+		tree->groups[i].seen = tree->gen;
+		ret = pthread_create(&tid, &attr, reader_scan_tree_thread,
+				&tree->groups[i]);
+		if (ret)
+			urcu_die(ret);
+	}
+	pthread_attr_destroy(&attr);
+	tree->pid = getpid();
+}
+
+/*
+ * Hand out one pass over "input_readers" to the scanner threads and wait
+ * for the root of the combining tree to report completion.
+ */
+static int reader_scan_tree_pass(struct reader_scan_tree *tree,
+		unsigned long *input_readers,
+		unsigned long *cur_snap_readers)
+{
+	unsigned long i;
+	int attempts = 0;
+
+	if (tree->pid != getpid())
+		reader_scan_tree_spawn(tree);
+	for (i = 0; i < tree->nr_nodes; i++)
+		tree->nodes[i].remaining = tree->nodes[i].nr_children;
+	tree->input_readers = input_readers;
+	tree->cur_snap_readers = cur_snap_readers;
+	tree->busy = 0;
+	tree->pass_pending = 1;
+	/* Write pass before write gen */
+	cmm_smp_mb();
+	uatomic_inc(&tree->gen);
+	/* Write gen before read nr_sleepers */
+	cmm_smp_mb();
+	if (uatomic_read(&tree->nr_sleepers))
+		futex_async(&tree->gen, FUTEX_WAKE, INT_MAX,
+			NULL, NULL, 0);
+
+	while (uatomic_read(&tree->pass_pending)) {
+		if (++attempts < READER_SCAN_TREE_SPIN) {
+			caa_cpu_relax();
+			continue;
+		}
+		uatomic_set(&tree->futex, -1);
+		/* Write futex before read pass_pending */
+		cmm_smp_mb();
+		if (uatomic_read(&tree->pass_pending))
+			futex_async(&tree->futex, FUTEX_WAIT, -1,
+				NULL, NULL, 0);
+	}
+	/* Read pass_pending before read pass results */
+	cmm_smp_mb();
+	return !CMM_LOAD_SHARED(tree->busy);
+}
+
+/*
+ * Parse a sysfs CPU list such as "0-3,8-11".
+ */
+static int reader_scan_read_cpulist(const char *path, cpu_set_t *cpus)
+{
+	unsigned long first, last;
+	FILE *fp;
+	int c;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+	CPU_ZERO(cpus);
+	while (fscanf(fp, "%lu", &first) == 1) {
+		last = first;
+		c = fgetc(fp);
+		if (c == '-') {
+			if (fscanf(fp, "%lu", &last) != 1)
+				break;
+			c = fgetc(fp);
+		}
+		for (; first <= last && first < CPU_SETSIZE; first++)
+			CPU_SET(first, cpus);
+		if (c != ',')
+			break;
+	}
+	fclose(fp);
+	return 0;
+}
+
+/*
+ * Fill "groups" with the CPU sets of NUMA nodes if cpus_per_group is 0,
+ * or of sets of cpus_per_group consecutive CPUs. Return the number of
+ * groups.
+ */
+static unsigned long reader_scan_tree_cpus(cpu_set_t *groups,
+		unsigned long max_groups, int cpus_per_group)
+{
+	char path[64];
+	unsigned long nr = 0, node;
+	long nr_cpus, cpu;
+
+	if (!cpus_per_group) {
+		for (node = 0; nr < max_groups; node++) {
+			snprintf(path, sizeof(path),
+				"/sys/devices/system/node/node%lu/cpulist",
+				node);
+			if (reader_scan_read_cpulist(path, &groups[nr]))
+				break;
+			/* Skip memory-only nodes. */
+			if (CPU_COUNT(&groups[nr]))
+				nr++;
+		}
+		if (nr)
+			return nr;
+		/* No NUMA information: use a single group. */
+		cpus_per_group = CPU_SETSIZE;
+	}
+	nr_cpus = sysconf(_SC_NPROCESSORS_CONF);
+	if (nr_cpus <= 0)
+		nr_cpus = 1;
+	for (cpu = 0; cpu < nr_cpus && cpu < CPU_SETSIZE; cpu++) {
+		if (!(cpu % cpus_per_group))
+			CPU_ZERO(&groups[nr++]);
+		CPU_SET(cpu, &groups[nr - 1]);
+	}
+	return nr;
+}
+
+/*
+ * Switch "scan" to hierarchical scanning. Called with the registry lock
+ * held, outside of grace periods.
+ */
+static int reader_scan_enable_tree(struct reader_scan *scan,
+		int cpus_per_group)
+{
+	struct reader_scan_tree *tree = NULL;
+	cpu_set_t *cpus;
+	unsigned long nr_groups, nr_nodes, n, i, level, next;
+	int ret = -ENOMEM;
+
+	if (cpus_per_group < 0)
+		return -EINVAL;
+	if (scan->tree)
+		return -EBUSY;
+	cpus = malloc(CPU_SETSIZE * sizeof(*cpus));
+	if (!cpus)
+		goto error;
+	if (posix_memalign((void **) &tree, CAA_CACHE_LINE_SIZE,
+			sizeof(*tree))) {
+		tree = NULL;
+		goto error;
+	}
+	memset(tree, 0, sizeof(*tree));
+	nr_groups = reader_scan_tree_cpus(cpus, CPU_SETSIZE, cpus_per_group);
+
+	/* Count the combining tree nodes, from the leaves up. */
+	nr_nodes = 0;
+	n = nr_groups;
+	do {
+		n = (n + READER_SCAN_TREE_FANOUT - 1) / READER_SCAN_TREE_FANOUT;
+		nr_nodes += n;
+	} while (n > 1);
+
+	if (posix_memalign((void **) &tree->groups, CAA_CACHE_LINE_SIZE,
+			nr_groups * sizeof(*tree->groups)))
+		goto error;
+	if (posix_memalign((void **) &tree->nodes, CAA_CACHE_LINE_SIZE,
+			nr_nodes * sizeof(*tree->nodes)))
+		goto error;
+	memset(tree->groups, 0, nr_groups * sizeof(*tree->groups));
+	memset(tree->nodes, 0, nr_nodes * sizeof(*tree->nodes));
+	tree->nr_groups = nr_groups;
+	tree->nr_nodes = nr_nodes;
+
+	for (i = 0; i < nr_groups; i++) {
+		tree->groups[i].scan = scan;
+		tree->groups[i].cpus = cpus[i];
+		tree->groups[i].parent =
+			&tree->nodes[i / READER_SCAN_TREE_FANOUT];
+		tree->groups[i].parent->nr_children++;
+	}
+	/* Link each level of nodes to the next one, up to the root. */
+	level = 0;
+	n = (nr_groups + READER_SCAN_TREE_FANOUT - 1) / READER_SCAN_TREE_FANOUT;
+	while (n > 1) {
+		next = level + n;
+		for (i = 0; i < n; i++) {
+			tree->nodes[level + i].parent =
+				&tree->nodes[next + i / READER_SCAN_TREE_FANOUT];
+			tree->nodes[level + i].parent->nr_children++;
+		}
+		level = next;
+		n = (n + READER_SCAN_TREE_FANOUT - 1) / READER_SCAN_TREE_FANOUT;
+	}
+
+	free(cpus);
+	scan->tree = tree;
+	reader_scan_mark_stale(scan);
+	return 0;
+
+error:
+	if (tree) {
+		free(tree->groups);
+		free(tree->nodes);
+	}
+	free(tree);
+	free(cpus);
+	return ret;
+}
+
+#else /* #ifdef READER_SCAN_HAVE_TREE */
+
+static unsigned long reader_scan_tree_group(struct reader_scan_tree *tree,
+		pthread_t tid, unsigned long *next)
+{
+	return 0;
+}
+
+static int reader_scan_tree_pass(struct reader_scan_tree *tree,
+		unsigned long *input_readers,
+		unsigned long *cur_snap_readers)
+{
+	return 1;
+}
+
+static int reader_scan_enable_tree(struct reader_scan *scan,
+		int cpus_per_group)
+{
+	return -ENOSYS;
+}
+
+#endif /* #else #ifdef READER_SCAN_HAVE_TREE */
+
+/*
+ * One pass over the readers pending in "input_readers", either scanned
+ * here or handed out to the hierarchical scanners. Return 1 if no reader
+ * is left pending.
+ */
+static int reader_scan_pass(struct reader_scan *scan,
+		unsigned long *input_readers,
+		unsigned long *cur_snap_readers)
+{
+	if (scan->tree)
+		return reader_scan_tree_pass(scan->tree, input_readers,
+				cur_snap_readers);
+	return reader_scan_pass_range(scan, input_readers, cur_snap_readers,
+			0, READER_SCAN_WORDS(scan->nr));
+}
+
+#endif /* _URCU_SCAN_IMPL_H */
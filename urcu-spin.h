@@ -0,0 +1,137 @@
+#ifndef _URCU_SPIN_H
+#define _URCU_SPIN_H
+
+/*
+ * urcu-spin.h
+ *
+ * Userspace RCU library - adaptive spin-then-park budgets
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <urcu/compiler.h>
+#include <urcu/system.h>
+#include <urcu/spin-policy.h>
+
+/* Default bounds and initial value of the spin budgets. */
+#define URCU_SPIN_MIN_NS	1000UL
+#define URCU_SPIN_MAX_NS	100000UL
+#define URCU_SPIN_START_NS	20000UL
+
+/*
+ * Spin budget of a wait site. Updated without synchronization by the
+ * threads waiting there: a lost update only slows down learning.
+ */
+struct urcu_spin {
+	unsigned long min_ns, max_ns;
+	int adaptive;
+	unsigned long spin_ns;		/* Current budget. */
+	unsigned long avg_ns;		/* Average wait, times 8. */
+};
+
+#define URCU_SPIN_INIT						\
+	{							\
+		.min_ns = URCU_SPIN_MIN_NS,			\
+		.max_ns = URCU_SPIN_MAX_NS,			\
+		.adaptive = 1,					\
+		.spin_ns = URCU_SPIN_START_NS,			\
+		.avg_ns = URCU_SPIN_START_NS * 4,		\
+	}
+
+#define DEFINE_URCU_SPIN(x)	struct urcu_spin x = URCU_SPIN_INIT
+
+/* A wait which did not complete on its first attempt. */
+struct urcu_spin_wait {
+	uint64_t start;
+	unsigned long budget;
+};
+
+static inline uint64_t urcu_spin_now(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void urcu_spin_wait_start(struct urcu_spin *spin,
+		struct urcu_spin_wait *wait)
+{
+	wait->start = urcu_spin_now();
+	wait->budget = CMM_LOAD_SHARED(spin->spin_ns);
+}
+
+/* Whether the wait should stop spinning and sleep. */
+static inline int urcu_spin_wait_expired(struct urcu_spin_wait *wait)
+{
+	return urcu_spin_now() - wait->start >= wait->budget;
+}
+
+/*
+ * Learn from the duration of a completed wait. The budget is twice the
+ * average, so that waits up to about the average never sleep.
+ */
+static inline void urcu_spin_wait_end(struct urcu_spin *spin,
+		struct urcu_spin_wait *wait)
+{
+	unsigned long min_ns, max_ns, avg, sample;
+	uint64_t wait_ns;
+
+	if (!CMM_LOAD_SHARED(spin->adaptive))
+		return;
+	wait_ns = urcu_spin_now() - wait->start;
+	min_ns = CMM_LOAD_SHARED(spin->min_ns);
+	max_ns = CMM_LOAD_SHARED(spin->max_ns);
+	sample = wait_ns <= max_ns ? wait_ns : 0;
+	avg = CMM_LOAD_SHARED(spin->avg_ns);
+	avg = avg - avg / 8 + sample;
+	CMM_STORE_SHARED(spin->avg_ns, avg);
+	CMM_STORE_SHARED(spin->spin_ns,
+		caa_min(caa_max(avg / 4, min_ns), max_ns));
+}
+
+static inline int urcu_spin_set(struct urcu_spin *spin,
+		const struct rcu_spin_policy *policy)
+{
+	unsigned long start;
+
+	if (policy->min_ns > policy->max_ns)
+		return -EINVAL;
+	start = policy->adaptive ?
+		caa_min(caa_max(URCU_SPIN_START_NS, policy->min_ns),
+			policy->max_ns) :
+		policy->max_ns;
+	CMM_STORE_SHARED(spin->min_ns, policy->min_ns);
+	CMM_STORE_SHARED(spin->max_ns, policy->max_ns);
+	CMM_STORE_SHARED(spin->adaptive, policy->adaptive);
+	CMM_STORE_SHARED(spin->avg_ns, start * 4);
+	CMM_STORE_SHARED(spin->spin_ns, start);
+	return 0;
+}
+
+/* Fill the tunables of "policy" from "spin". */
+static inline void urcu_spin_get(struct urcu_spin *spin,
+		struct rcu_spin_policy *policy)
+{
+	policy->min_ns = CMM_LOAD_SHARED(spin->min_ns);
+	policy->max_ns = CMM_LOAD_SHARED(spin->max_ns);
+	policy->adaptive = CMM_LOAD_SHARED(spin->adaptive);
+}
+
+#endif /* _URCU_SPIN_H */
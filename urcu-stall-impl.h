@@ -0,0 +1,127 @@
+#ifndef _URCU_STALL_IMPL_H
+#define _URCU_STALL_IMPL_H
+
+/*
+ * urcu-stall-impl.h
+ *
+ * Userspace RCU library - reader stall detection
+ *
+ * TO BE INCLUDED ONLY FROM URCU LIBRARY CODE, after urcu-scan-impl.h and
+ * urcu-gp-stats-impl.h.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <time.h>
+
+#include <urcu/compiler.h>
+#include <urcu/system.h>
+#include <urcu/stall.h>
+
+/*
+ * Only accessed with the grace period lock held: by grace periods, and by
+ * stall_detector_set(). Once a grace period has waited "timeout" for its
+ * readers, the readers still pending are reported, and again every
+ * "timeout" until they are all quiescent.
+ */
+struct stall_detector {
+	uint64_t timeout;		/* Nanoseconds, 0 when disabled. */
+	rcu_stall_func_t func;
+	void *priv;
+	uint64_t start;			/* Grace period in progress start. */
+	uint64_t deadline;		/* Next report, 0 if none. */
+};
+
+static inline int stall_detector_set(struct stall_detector *det,
+		unsigned long timeout_ms, rcu_stall_func_t func, void *priv)
+{
+	if (func && !timeout_ms)
+		return -EINVAL;
+	det->timeout = func ? timeout_ms * 1000000ULL : 0;
+	det->func = func;
+	det->priv = priv;
+	return 0;
+}
+
+static inline void stall_gp_start(struct stall_detector *det)
+{
+	if (!det || caa_likely(!det->timeout))
+		return;
+	det->start = gp_stats_now();
+	det->deadline = det->start + det->timeout;
+}
+
+static inline void stall_gp_end(struct stall_detector *det)
+{
+	if (det)
+		det->deadline = 0;
+}
+
+/*
+ * Timeout of a sleep waiting for readers, so that it ends by the next
+ * report. Returns NULL if there is none.
+ */
+static inline const struct timespec *stall_wait_timeout(
+		struct stall_detector *det, struct timespec *ts)
+{
+	uint64_t now, left = 0;
+
+	if (!det || caa_likely(!det->deadline))
+		return NULL;
+	now = gp_stats_now();
+	if (now < det->deadline)
+		left = det->deadline - now;
+	ts->tv_sec = left / 1000000000ULL;
+	ts->tv_nsec = left % 1000000000ULL;
+	return ts;
+}
+
+static void stall_report(struct stall_detector *det,
+		struct reader_scan *scan, unsigned long *input_readers)
+{
+	struct rcu_stall_info info;
+	uint64_t now;
+	unsigned long i;
+
+	now = gp_stats_now();
+	if (now < det->deadline)
+		return;
+	info.gp_ctr = CMM_LOAD_SHARED(scan->gp->ctr);
+	info.stall_ms = (now - det->start) / 1000000;
+	reader_scan_for_each(scan, input_readers, i) {
+		info.tid = caa_container_of(scan->ctr[i], struct rcu_reader,
+				ctr)->tid;
+		info.ctr = CMM_LOAD_SHARED(*scan->ctr[i]);
+		det->func(&info, det->priv);
+	}
+	det->deadline = now + det->timeout;
+}
+
+/*
+ * Report the readers still pending in "input_readers" if the grace period
+ * has waited for them past the deadline. Called between passes of
+ * wait_for_readers(), with the registry lock held, or the grace period
+ * lock for rcu-bp, so that reported readers cannot unregister.
+ */
+static inline void stall_check(struct stall_detector *det,
+		struct reader_scan *scan, unsigned long *input_readers)
+{
+	if (!det || caa_likely(!det->deadline))
+		return;
+	stall_report(det, scan, input_readers);
+}
+
+#endif /* _URCU_STALL_IMPL_H */
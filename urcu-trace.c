@@ -0,0 +1,226 @@
+/*
+ * urcu-trace.c
+ *
+ * Userspace RCU library - built-in event trace
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <urcu/arch.h>
+#include <urcu/compiler.h>
+#include <urcu/system.h>
+#include <urcu/uatomic.h>
+#include <urcu/tls-compat.h>
+#include "urcu-trace.h"
+
+#define RING_SIZE	(1UL << RCU_TRACE_RING_ORDER)
+#define RING_MASK	(RING_SIZE - 1)
+
+/*
+ * Single-producer ring of a thread: records are written by their thread
+ * only, and "head" published after each. Rings are never freed: they are
+ * released when their thread exits, and taken over, records included, by
+ * later threads.
+ */
+struct rcu_trace_ring {
+	struct rcu_trace_ring *next;
+	int in_use;
+	uint32_t tid;
+	unsigned long head;		/* Records written so far. */
+	struct rcu_trace_record rec[RING_SIZE];
+};
+
+int rcu_trace_active;
+
+static struct rcu_trace_ring *rings;
+static pthread_mutex_t dump_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t ring_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+
+static DEFINE_URCU_TLS(struct rcu_trace_ring *, trace_ring);
+
+static void ring_thread_exit(void *arg)
+{
+	struct rcu_trace_ring *ring = arg;
+
+	cmm_smp_mb();
+	uatomic_set(&ring->in_use, 0);
+}
+
+static void ring_init_key(void)
+{
+	if (pthread_key_create(&ring_key, ring_thread_exit))
+		abort();
+}
+
+static struct rcu_trace_ring *ring_get(void)
+{
+	struct rcu_trace_ring *ring, *head;
+
+	ring = URCU_TLS(trace_ring);
+	if (caa_likely(ring))
+		return ring;
+
+	(void) pthread_once(&ring_once, ring_init_key);
+	for (ring = uatomic_read(&rings); ring; ring = ring->next) {
+		if (!uatomic_read(&ring->in_use)
+				&& !uatomic_cmpxchg(&ring->in_use, 0, 1))
+			goto found;
+	}
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return NULL;
+	ring->in_use = 1;
+	do {
+		head = uatomic_read(&rings);
+		ring->next = head;
+	} while (uatomic_cmpxchg(&rings, head, ring) != head);
+found:
+	if (pthread_setspecific(ring_key, ring)) {
+		uatomic_set(&ring->in_use, 0);
+		return NULL;
+	}
+	ring->tid = (uint32_t) syscall(SYS_gettid);
+	URCU_TLS(trace_ring) = ring;
+	return ring;
+}
+
+void rcu_trace_record(enum rcu_trace_type type, uint64_t arg0,
+		uint64_t arg1)
+{
+	struct rcu_trace_ring *ring;
+	struct rcu_trace_record *rec;
+	struct timespec ts;
+
+	ring = ring_get();
+	if (!ring)
+		return;
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	rec = &ring->rec[ring->head & RING_MASK];
+	rec->ts_ns = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	rec->tid = ring->tid;
+	rec->type = type;
+	rec->arg[0] = arg0;
+	rec->arg[1] = arg1;
+	/* Write the record before publishing it. */
+	cmm_smp_wmb();
+	CMM_STORE_SHARED(ring->head, ring->head + 1);
+}
+
+void rcu_trace_enable(int enable)
+{
+	CMM_STORE_SHARED(rcu_trace_active, !!enable);
+}
+
+/*
+ * Copy the records of "ring" to "out", which has room for RING_SIZE.
+ * Records overwritten while copying are dropped, along with the one the
+ * thread may be overwriting: the record at "head" - RING_SIZE.
+ */
+static unsigned long ring_copy(struct rcu_trace_ring *ring,
+		struct rcu_trace_record *out)
+{
+	unsigned long begin, end, i, nr = 0;
+
+	end = CMM_LOAD_SHARED(ring->head);
+	/* Read head before the records. */
+	cmm_smp_rmb();
+	begin = end > RING_SIZE ? end - RING_SIZE : 0;
+	for (i = begin; i < end; i++)
+		out[i - begin] = ring->rec[i & RING_MASK];
+	/* Read the records before checking for overwrites. */
+	cmm_smp_rmb();
+	/* Records below head + 1 - RING_SIZE may be overwritten. */
+	i = CMM_LOAD_SHARED(ring->head) + 1;
+	if (i > RING_SIZE && i - RING_SIZE > begin) {
+		nr = i - RING_SIZE - begin;
+		if (nr > end - begin)
+			nr = end - begin;
+		memmove(out, out + nr, (end - begin - nr) * sizeof(*out));
+	}
+	return end - begin - nr;
+}
+
+static int record_cmp(const void *a, const void *b)
+{
+	const struct rcu_trace_record *ra = a, *rb = b;
+
+	if (ra->ts_ns != rb->ts_ns)
+		return ra->ts_ns < rb->ts_ns ? -1 : 1;
+	return 0;
+}
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+	const char *p = buf;
+	ssize_t ret;
+
+	while (len) {
+		ret = write(fd, p, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		p += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+int rcu_trace_dump(int fd)
+{
+	struct rcu_trace_ring *ring;
+	struct rcu_trace_record *recs;
+	struct rcu_trace_header hdr;
+	unsigned long nr_rings = 0, nr = 0;
+	int ret;
+
+	pthread_mutex_lock(&dump_lock);
+	for (ring = uatomic_read(&rings); ring; ring = ring->next)
+		nr_rings++;
+	recs = malloc((nr_rings ? nr_rings : 1) * RING_SIZE * sizeof(*recs));
+	if (!recs) {
+		pthread_mutex_unlock(&dump_lock);
+		return -ENOMEM;
+	}
+	/* Rings pushed since counting are left out. */
+	for (ring = uatomic_read(&rings); ring && nr_rings;
+			ring = ring->next, nr_rings--)
+		nr += ring_copy(ring, recs + nr);
+	pthread_mutex_unlock(&dump_lock);
+
+	qsort(recs, nr, sizeof(*recs), record_cmp);
+	memset(&hdr, 0, sizeof(hdr));
+	strcpy(hdr.magic, RCU_TRACE_MAGIC);
+	hdr.version = RCU_TRACE_VERSION;
+	hdr.record_size = sizeof(struct rcu_trace_record);
+	hdr.nr_records = nr;
+	ret = write_all(fd, &hdr, sizeof(hdr));
+	if (!ret)
+		ret = write_all(fd, recs, nr * sizeof(*recs));
+	free(recs);
+	return ret;
+}
@@ -0,0 +1,43 @@
+#ifndef _URCU_TRACE_INTERNAL_H
+#define _URCU_TRACE_INTERNAL_H
+
+/*
+ * urcu-trace.h
+ *
+ * Userspace RCU library - built-in event trace, recording side
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <urcu/compiler.h>
+#include <urcu/system.h>
+#include <urcu/trace.h>
+
+/* Set by rcu_trace_enable(), in liburcu-common. */
+extern int rcu_trace_active;
+
+extern void rcu_trace_record(enum rcu_trace_type type, uint64_t arg0,
+		uint64_t arg1);
+
+/* Costs a load and a predictable branch while tracing is disabled. */
+static inline void urcu_trace(enum rcu_trace_type type, uint64_t arg0,
+		uint64_t arg1)
+{
+	if (caa_unlikely(CMM_LOAD_SHARED(rcu_trace_active)))
+		rcu_trace_record(type, arg0, arg1);
+}
+
+#endif /* _URCU_TRACE_INTERNAL_H */
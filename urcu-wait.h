@@ -25,10 +25,11 @@
 
 #include <urcu/uatomic.h>
 #include <urcu/wfstack.h>
+#include "urcu-spin.h"
 
 /*
- * Number of busy-loop attempts before waiting on futex for grace period
- * batching.
+ * Number of busy-loop attempts before waiting for the waker to release
+ * the wait node.
  */
 #define URCU_WAIT_ATTEMPTS 1000
 
@@ -39,6 +40,8 @@ enum urcu_wait_state {
 	URCU_WAIT_WAKEUP =	(1 << 0),
 	URCU_WAIT_RUNNING =	(1 << 1),
 	URCU_WAIT_TEARDOWN =	(1 << 2),
+	/* No thread waits on the node: see struct urcu_wait_async_node. */
+	URCU_WAIT_ASYNC =	(1 << 3),
 };
 
 struct urcu_wait_node {
@@ -46,6 +49,15 @@ struct urcu_wait_node {
 	int32_t state;	/* enum urcu_wait_state */
 };
 
+/*
+ * Waiter which does not block: the waker calls "func" instead, which
+ * owns the node from then on.
+ */
+struct urcu_wait_async_node {
+	struct urcu_wait_node wait;
+	void (*func)(struct urcu_wait_async_node *node);
+};
+
 #define URCU_WAIT_NODE_INIT(name, _state)		\
 	{ .state = _state }
 
@@ -130,22 +142,30 @@ void urcu_adaptative_wake_up(struct urcu_wait_node *wait)
 
 /*
  * Caller must initialize "value" to URCU_WAIT_WAITING before passing its
- * memory to waker thread.
+ * memory to waker thread. Busy-waits for the budget of "spin" before
+ * waiting on futex, and adapts it to the duration of the wait.
  */
 static inline
-void urcu_adaptative_busy_wait(struct urcu_wait_node *wait)
+void urcu_adaptative_busy_wait(struct urcu_wait_node *wait,
+		struct urcu_spin *spin)
 {
+	struct urcu_spin_wait spin_wait;
 	unsigned int i;
 
 	/* Load and test condition before read state */
 	cmm_smp_rmb();
-	for (i = 0; i < URCU_WAIT_ATTEMPTS; i++) {
+	if (uatomic_read(&wait->state) != URCU_WAIT_WAITING)
+		goto skip_futex_wait;
+	urcu_spin_wait_start(spin, &spin_wait);
+	while (!urcu_spin_wait_expired(&spin_wait)) {
 		if (uatomic_read(&wait->state) != URCU_WAIT_WAITING)
-			goto skip_futex_wait;
+			goto end_spin_wait;
 		caa_cpu_relax();
 	}
 	futex_noasync(&wait->state, FUTEX_WAIT,
 		URCU_WAIT_WAITING, NULL, NULL, 0);
+end_spin_wait:
+	urcu_spin_wait_end(spin, &spin_wait);
 skip_futex_wait:
 
 	/* Tell waker thread than we are running. */
@@ -175,6 +195,16 @@ void urcu_wake_all_waiters(struct urcu_waiters *waiters)
 		struct urcu_wait_node *wait_node =
 			caa_container_of(iter, struct urcu_wait_node, node);
 
+		if (wait_node->state & URCU_WAIT_ASYNC) {
+			struct urcu_wait_async_node *async_node =
+				caa_container_of(wait_node,
+					struct urcu_wait_async_node, wait);
+
+			/* Order grace period before notification. */
+			cmm_smp_mb();
+			async_node->func(async_node);
+			continue;
+		}
 		/* Don't wake already running threads */
 		if (wait_node->state & URCU_WAIT_RUNNING)
 			continue;
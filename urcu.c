@@ -44,12 +44,23 @@
 
 #include "urcu-die.h"
 #include "urcu-wait.h"
+#include "urcu-trace.h"
 
 /* Do not #define _LGPL_SOURCE to ensure we can emit the wrapper symbols */
 #undef _LGPL_SOURCE
 #include "urcu.h"
 #define _LGPL_SOURCE
 
+#include "urcu-poll-impl.h"
+#include "urcu-scan-impl.h"
+#include "urcu-gp-stats-impl.h"
+#include "urcu-stall-impl.h"
+#include "urcu-gp-replica-impl.h"
+#include "urcu-read-profile-impl.h"
+#ifdef RCU_MEMBARRIER
+#include "urcu-membarrier-impl.h"
+#endif
+
 /*
  * If a reader is really non-cooperative and refuses to commit its
  * rcu_active_readers count to memory (there is no barrier in the reader
@@ -58,32 +69,19 @@
 #define KICK_READER_LOOPS 10000
 
 /*
- * Active attempts to check for reader Q.S. before calling futex().
+ * Loops between reader kicks of expedited grace periods, which never
+ * sleep, on incoherent cache architectures.
  */
 #define RCU_QS_ACTIVE_ATTEMPTS 100
 
-/*
- * RCU_MEMBARRIER is only possibly available on Linux.
- */
-#if defined(RCU_MEMBARRIER) && defined(__linux__)
-#include <syscall.h>
-#endif
-
-/* If the headers do not support SYS_membarrier, fall back on RCU_MB */
-#ifdef SYS_membarrier
-# define membarrier(...)		syscall(SYS_membarrier, __VA_ARGS__)
-#else
-# define membarrier(...)		-ENOSYS
-#endif
-
-#define MEMBARRIER_EXPEDITED		(1 << 0)
-#define MEMBARRIER_DELAYED		(1 << 1)
-#define MEMBARRIER_QUERY		(1 << 16)
-
 #ifdef RCU_MEMBARRIER
 static int init_done;
 int rcu_has_sys_membarrier;
 
+/* Selected by rcu_init(), used by smp_mb_master(). */
+static enum rcu_membarrier_mode membarrier_mode = RCU_MEMBARRIER_MODE_NONE;
+static int membarrier_cmd;
+
 void __attribute__((constructor)) rcu_init(void);
 #endif
 
@@ -100,27 +98,72 @@ void __attribute__((constructor)) rcu_init(void);
 void __attribute__((destructor)) rcu_exit(void);
 #endif
 
-static pthread_mutex_t rcu_gp_lock = PTHREAD_MUTEX_INITIALIZER;
 struct rcu_gp rcu_gp = { .ctr = RCU_GP_COUNT };
 
+#ifdef CONFIG_RCU_GP_REPLICAS
+DEFINE_RCU_GP_REPLICAS(RCU_GP_COUNT);
+#endif
+
 /*
  * Written to only by each individual reader. Read by both the reader and the
  * writers.
  */
 DEFINE_URCU_TLS(struct rcu_reader, rcu_reader);
 
+/* Reader of each RCU domain the thread is registered to, by domain id. */
+DEFINE_URCU_TLS(struct rcu_domain_readers, rcu_domain_readers);
+
 #ifdef DEBUG_YIELD
 unsigned int rcu_yield_active;
 DEFINE_URCU_TLS(unsigned int, rcu_rand_yield);
 #endif
 
-static CDS_LIST_HEAD(registry);
-
 /*
- * Queue keeping threads awaiting to wait for a grace period. Contains
- * struct gp_waiters_thread objects.
+ * Update-side state of a grace period domain: the flavor's own below,
+ * and the one of each RCU domain.
  */
-static DEFINE_URCU_WAIT_QUEUE(gp_waiters);
+struct rcu_gp_state {
+	struct rcu_gp *gp;		/* Counter observed by the readers. */
+	unsigned long *seq;		/* Grace period sequence number. */
+	pthread_mutex_t lock;		/* Held while doing grace periods. */
+	/*
+	 * Protects registry and scan. Grace periods release it while
+	 * waiting for readers, so that unregistration does not wait for
+	 * them.
+	 */
+	pthread_mutex_t registry_lock;
+	struct cds_list_head registry;	/* Registered struct rcu_reader. */
+	struct reader_scan scan;
+	/*
+	 * Queue keeping threads awaiting to wait for a grace period.
+	 * Contains struct gp_waiters_thread objects.
+	 */
+	struct urcu_wait_queue waiters;
+	struct gp_stats *stats;		/* NULL if not sampled. */
+	struct stall_detector *stall;	/* NULL if not watched. */
+	/* Spin budgets, shared by the flavor and its domains. */
+	struct urcu_spin *gp_spin;	/* Waiting for readers. */
+	struct urcu_spin *waiter_spin;	/* Waiting for a grace period. */
+};
+
+static struct gp_stats gp_stats = GP_STATS_INIT;
+static struct stall_detector stall_detector;
+static DEFINE_URCU_SPIN(gp_spin);
+static DEFINE_URCU_SPIN(waiter_spin);
+
+static struct rcu_gp_state default_gp_state = {
+	.gp = &rcu_gp,
+	.seq = &rcu_gp_seq,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.registry_lock = PTHREAD_MUTEX_INITIALIZER,
+	.registry = CDS_LIST_HEAD_INIT(default_gp_state.registry),
+	.scan = READER_SCAN_INIT(&rcu_gp),
+	.waiters = URCU_WAIT_QUEUE_HEAD_INIT(default_gp_state.waiters),
+	.stats = &gp_stats,
+	.stall = &stall_detector,
+	.gp_spin = &gp_spin,
+	.waiter_spin = &waiter_spin,
+};
 
 static void mutex_lock(pthread_mutex_t *mutex)
 {
@@ -154,24 +197,24 @@ static void mutex_unlock(pthread_mutex_t *mutex)
 }
 
 #ifdef RCU_MEMBARRIER
-static void smp_mb_master(int group)
+static void smp_mb_master(struct rcu_gp_state *state)
 {
 	if (caa_likely(rcu_has_sys_membarrier))
-		(void) membarrier(MEMBARRIER_EXPEDITED);
+		(void) membarrier(membarrier_cmd, 0);
 	else
 		cmm_smp_mb();
 }
 #endif
 
 #ifdef RCU_MB
-static void smp_mb_master(int group)
+static void smp_mb_master(struct rcu_gp_state *state)
 {
 	cmm_smp_mb();
 }
 #endif
 
 #ifdef RCU_SIGNAL
-static void force_mb_all_readers(void)
+static void force_mb_all_readers(struct cds_list_head *registry)
 {
 	struct rcu_reader *index;
 
@@ -179,7 +222,7 @@ static void force_mb_all_readers(void)
 	 * Ask for each threads to execute a cmm_smp_mb() so we can consider the
 	 * compiler barriers around rcu read lock as real memory barriers.
 	 */
-	if (cds_list_empty(&registry))
+	if (cds_list_empty(registry))
 		return;
 	/*
 	 * pthread_kill has a cmm_smp_mb(). But beware, we assume it performs
@@ -187,7 +230,7 @@ static void force_mb_all_readers(void)
 	 * safe and don't assume anything : we use cmm_smp_mc() to make sure the
 	 * cache flush is enforced.
 	 */
-	cds_list_for_each_entry(index, &registry, node) {
+	cds_list_for_each_entry(index, registry, node) {
 		CMM_STORE_SHARED(index->need_mb, 1);
 		pthread_kill(index->tid, SIGRCU);
 	}
@@ -204,7 +247,7 @@ static void force_mb_all_readers(void)
 	 * relevant bug report.  For Linux kernels, we recommend getting
 	 * the Linux Test Project (LTP).
 	 */
-	cds_list_for_each_entry(index, &registry, node) {
+	cds_list_for_each_entry(index, registry, node) {
 		while (CMM_LOAD_SHARED(index->need_mb)) {
 			pthread_kill(index->tid, SIGRCU);
 			poll(NULL, 0, 1);
@@ -213,156 +256,142 @@ static void force_mb_all_readers(void)
 	cmm_smp_mb();	/* read ->need_mb before ending the barrier */
 }
 
-static void smp_mb_master(int group)
+static void smp_mb_master(struct rcu_gp_state *state)
 {
-	force_mb_all_readers();
+	force_mb_all_readers(&state->registry);
 }
 #endif /* #ifdef RCU_SIGNAL */
 
 /*
- * synchronize_rcu() waiting. Single thread.
+ * synchronize_rcu() waiting. Single thread. Called with
+ * state->registry_lock held, released while sleeping.
  */
-static void wait_gp(void)
+static void wait_gp(struct rcu_gp_state *state)
 {
+	struct timespec ts;
+
 	/* Read reader_gp before read futex */
-	smp_mb_master(RCU_MB_GROUP);
-	if (uatomic_read(&rcu_gp.futex) == -1)
-		futex_async(&rcu_gp.futex, FUTEX_WAIT, -1,
-		      NULL, NULL, 0);
+	smp_mb_master(state);
+	mutex_unlock(&state->registry_lock);
+	if (uatomic_read(&state->gp->futex) == -1) {
+		gp_stats_sleep(state->stats);
+		futex_async(&state->gp->futex, FUTEX_WAIT, -1,
+		      stall_wait_timeout(state->stall, &ts), NULL, 0);
+	}
+	mutex_lock(&state->registry_lock);
 }
 
-static void wait_for_readers(struct cds_list_head *input_readers,
-			struct cds_list_head *cur_snap_readers,
-			struct cds_list_head *qsreaders)
+/*
+ * Busy-waiting, without holding back threads unregistering.
+ */
+static void relax_registry(struct rcu_gp_state *state)
+{
+	gp_stats_spin(state->stats);
+	mutex_unlock(&state->registry_lock);
+	caa_cpu_relax();
+	mutex_lock(&state->registry_lock);
+}
+
+/*
+ * Non-expedited grace periods busy-wait for the budget of state->gp_spin,
+ * then block on the futex until readers are quiescent, and adapt the
+ * budget to the duration of the wait. Expedited grace periods never
+ * block on the futex: they keep busy-looping until all readers are
+ * quiescent, and kick readers on incoherent cache architectures every
+ * RCU_QS_ACTIVE_ATTEMPTS loops rather than every KICK_READER_LOOPS.
+ *
+ * Called with state->registry_lock held. It is released between passes,
+ * during which readers leaving are removed from the bitmaps.
+ */
+static void wait_for_readers(struct rcu_gp_state *state,
+			unsigned long *input_readers,
+			unsigned long *cur_snap_readers,
+			int expedited)
 {
-	int wait_loops = 0;
-	struct rcu_reader *index, *tmp;
+	struct urcu_spin_wait spin_wait = { 0 };
+	int wait_loops = 0, parked = 0, empty;
 
 	/*
 	 * Wait for each thread URCU_TLS(rcu_reader).ctr to either
 	 * indicate quiescence (not nested), or observe the current
-	 * rcu_gp.ctr value.
+	 * state->gp->ctr value.
 	 */
 	for (;;) {
-		wait_loops++;
-		if (wait_loops == RCU_QS_ACTIVE_ATTEMPTS) {
-			uatomic_dec(&rcu_gp.futex);
+		if (parked) {
+			uatomic_set(&state->gp->futex, -1);
 			/* Write futex before read reader_gp */
-			smp_mb_master(RCU_MB_GROUP);
-		}
-
-		cds_list_for_each_entry_safe(index, tmp, input_readers, node) {
-			switch (rcu_reader_state(&index->ctr)) {
-			case RCU_READER_ACTIVE_CURRENT:
-				if (cur_snap_readers) {
-					cds_list_move(&index->node,
-						cur_snap_readers);
-					break;
-				}
-				/* Fall-through */
-			case RCU_READER_INACTIVE:
-				cds_list_move(&index->node, qsreaders);
-				break;
-			case RCU_READER_ACTIVE_OLD:
-				/*
-				 * Old snapshot. Leaving node in
-				 * input_readers will make us busy-loop
-				 * until the snapshot becomes current or
-				 * the reader becomes inactive.
-				 */
-				break;
-			}
+			smp_mb_master(state);
 		}
 
-#ifndef HAS_INCOHERENT_CACHES
-		if (cds_list_empty(input_readers)) {
-			if (wait_loops == RCU_QS_ACTIVE_ATTEMPTS) {
+		empty = reader_scan_pass(&state->scan, input_readers,
+				cur_snap_readers);
+		if (empty) {
+			if (parked) {
 				/* Read reader_gp before write futex */
-				smp_mb_master(RCU_MB_GROUP);
-				uatomic_set(&rcu_gp.futex, 0);
+				smp_mb_master(state);
+				uatomic_set(&state->gp->futex, 0);
 			}
 			break;
-		} else {
-			if (wait_loops == RCU_QS_ACTIVE_ATTEMPTS)
-				wait_gp();
-			else
-				caa_cpu_relax();
 		}
-#else /* #ifndef HAS_INCOHERENT_CACHES */
+		stall_check(state->stall, &state->scan, input_readers);
+
+		if (parked) {
+			wait_gp(state);
+			continue;
+		}
+		if (!expedited && !wait_loops)
+			urcu_spin_wait_start(state->gp_spin, &spin_wait);
+		wait_loops++;
+#ifdef HAS_INCOHERENT_CACHES
 		/*
-		 * BUSY-LOOP. Force the reader thread to commit its
+		 * Force the reader thread to commit its
 		 * URCU_TLS(rcu_reader).ctr update to memory if we wait
 		 * for too long.
 		 */
-		if (cds_list_empty(input_readers)) {
-			if (wait_loops == RCU_QS_ACTIVE_ATTEMPTS) {
-				/* Read reader_gp before write futex */
-				smp_mb_master(RCU_MB_GROUP);
-				uatomic_set(&rcu_gp.futex, 0);
-			}
-			break;
-		} else {
-			switch (wait_loops) {
-			case RCU_QS_ACTIVE_ATTEMPTS:
-				wait_gp();
-				break; /* only escape switch */
-			case KICK_READER_LOOPS:
-				smp_mb_master(RCU_MB_GROUP);
-				wait_loops = 0;
-				break; /* only escape switch */
-			default:
-				caa_cpu_relax();
-			}
-		}
-#endif /* #else #ifndef HAS_INCOHERENT_CACHES */
+		if (!(wait_loops % (expedited ? RCU_QS_ACTIVE_ATTEMPTS
+				: KICK_READER_LOOPS)))
+			smp_mb_master(state);
+#endif /* #ifdef HAS_INCOHERENT_CACHES */
+		if (!expedited && urcu_spin_wait_expired(&spin_wait))
+			parked = 1;
+		else
+			relax_registry(state);
 	}
+	if (!expedited && wait_loops)
+		urcu_spin_wait_end(state->gp_spin, &spin_wait);
 }
 
-void synchronize_rcu(void)
+/*
+ * Perform a grace period on behalf of every waiter moved out of
+ * state->waiters so far. Called with state->lock held.
+ */
+static void do_grace_period(struct rcu_gp_state *state, int expedited)
 {
-	CDS_LIST_HEAD(cur_snap_readers);
-	CDS_LIST_HEAD(qsreaders);
-	DEFINE_URCU_WAIT_NODE(wait, URCU_WAIT_WAITING);
-	struct urcu_waiters waiters;
+	rcu_seq_start(state->seq);
+	urcu_trace(RCU_TRACE_GP_START, *state->seq, expedited);
 
-	/*
-	 * Add ourself to gp_waiters queue of threads awaiting to wait
-	 * for a grace period. Proceed to perform the grace period only
-	 * if we are the first thread added into the queue.
-	 * The implicit memory barrier before urcu_wait_add()
-	 * orders prior memory accesses of threads put into the wait
-	 * queue before their insertion into the wait queue.
-	 */
-	if (urcu_wait_add(&gp_waiters, &wait) != 0) {
-		/* Not first in queue: will be awakened by another thread. */
-		urcu_adaptative_busy_wait(&wait);
-		/* Order following memory accesses after grace period. */
-		cmm_smp_mb();
-		return;
-	}
-	/* We won't need to wake ourself up */
-	urcu_wait_set_state(&wait, URCU_WAIT_RUNNING);
-
-	mutex_lock(&rcu_gp_lock);
-
-	/*
-	 * Move all waiters into our local queue.
-	 */
-	urcu_move_waiters(&waiters, &gp_waiters);
-
-	if (cds_list_empty(&registry))
+	mutex_lock(&state->registry_lock);
+	reader_scan_merge(&state->scan, &state->registry);
+	if (cds_list_empty(&state->registry))
 		goto out;
 
+	reader_scan_start(&state->scan, &state->registry);
+	gp_stats_readers(state->stats, &state->scan);
+	stall_gp_start(state->stall);
+
 	/* All threads should read qparity before accessing data structure
-	 * where new ptr points to. Must be done within rcu_gp_lock because it
-	 * iterates on reader threads.*/
+	 * where new ptr points to. Must be done within state->registry_lock
+	 * because it iterates on reader threads.*/
 	/* Write new ptr before changing the qparity */
-	smp_mb_master(RCU_MB_GROUP);
+	smp_mb_master(state);
 
 	/*
 	 * Wait for readers to observe original parity or be quiescent.
 	 */
-	wait_for_readers(&registry, &cur_snap_readers, &qsreaders);
+	gp_stats_phase_start(state->stats);
+	wait_for_readers(state, state->scan.pending, state->scan.cur_snap,
+			expedited);
+	gp_stats_phase_end(state->stats);
 
 	/*
 	 * Must finish waiting for quiescent state for original parity before
@@ -381,7 +410,12 @@ void synchronize_rcu(void)
 	cmm_smp_mb();
 
 	/* Switch parity: 0 -> 1, 1 -> 0 */
-	CMM_STORE_SHARED(rcu_gp.ctr, rcu_gp.ctr ^ RCU_GP_CTR_PHASE);
+	CMM_STORE_SHARED(state->gp->ctr, state->gp->ctr ^ RCU_GP_CTR_PHASE);
+#ifdef CONFIG_RCU_GP_REPLICAS
+	/* RCU domains have a single copy. */
+	if (state->gp == &rcu_gp)
+		gp_replica_update(rcu_gp.ctr);
+#endif
 
 	/*
 	 * Must commit rcu_gp.ctr update to memory before waiting for quiescent
@@ -402,19 +436,57 @@ void synchronize_rcu(void)
 	/*
 	 * Wait for readers to observe new parity or be quiescent.
 	 */
-	wait_for_readers(&cur_snap_readers, NULL, &qsreaders);
+	gp_stats_phase_start(state->stats);
+	wait_for_readers(state, state->scan.cur_snap, NULL, expedited);
+	gp_stats_phase_end(state->stats);
+
+	/* Finish waiting for reader threads before letting the old ptr being
+	 * freed. Must be done within state->registry_lock because it iterates
+	 * on reader threads. */
+	smp_mb_master(state);
+
+	stall_gp_end(state->stall);
+out:
+	mutex_unlock(&state->registry_lock);
+	urcu_trace(RCU_TRACE_GP_END, *state->seq, expedited);
+	rcu_seq_end(state->seq);
+}
+
+static void __synchronize_rcu(struct rcu_gp_state *state)
+{
+	DEFINE_URCU_WAIT_NODE(wait, URCU_WAIT_WAITING);
+	struct urcu_waiters waiters;
+
+	/*
+	 * Add ourself to state->waiters queue of threads awaiting to wait
+	 * for a grace period. Proceed to perform the grace period only
+	 * if we are the first thread added into the queue.
+	 * The implicit memory barrier before urcu_wait_add()
+	 * orders prior memory accesses of threads put into the wait
+	 * queue before their insertion into the wait queue.
+	 */
+	if (urcu_wait_add(&state->waiters, &wait) != 0) {
+		/* Not first in queue: will be awakened by another thread. */
+		urcu_adaptative_busy_wait(&wait, state->waiter_spin);
+		/* Order following memory accesses after grace period. */
+		cmm_smp_mb();
+		return;
+	}
+	/* We won't need to wake ourself up */
+	urcu_wait_set_state(&wait, URCU_WAIT_RUNNING);
+
+	mutex_lock(&state->lock);
 
 	/*
-	 * Put quiescent reader list back into registry.
+	 * Move all waiters into our local queue.
 	 */
-	cds_list_splice(&qsreaders, &registry);
+	urcu_move_waiters(&waiters, &state->waiters);
 
-	/* Finish waiting for reader threads before letting the old ptr being
-	 * freed. Must be done within rcu_gp_lock because it iterates on reader
-	 * threads. */
-	smp_mb_master(RCU_MB_GROUP);
-out:
-	mutex_unlock(&rcu_gp_lock);
+	gp_stats_gp_start(state->stats);
+	do_grace_period(state, 0);
+	gp_stats_gp_end(state->stats, &waiters, 0);
+
+	mutex_unlock(&state->lock);
 
 	/*
 	 * Wakeup waiters only after we have completed the grace period
@@ -424,6 +496,149 @@ out:
 	urcu_wake_all_waiters(&waiters);
 }
 
+void synchronize_rcu(void)
+{
+	__synchronize_rcu(&default_gp_state);
+}
+
+/*
+ * Grace period for the caller only, which does not queue behind the
+ * current leader: it takes the grace period lock directly. The threads
+ * queued in the waiters queue are left to their leader, which owns the
+ * queue once first in it: its own wait node is on its stack.
+ */
+static void __synchronize_rcu_private(struct rcu_gp_state *state,
+		int expedited)
+{
+	unsigned long cookie;
+
+	/* Order prior memory accesses before reading the sequence. */
+	cmm_smp_mb();
+	cookie = rcu_seq_snap(state->seq);
+
+	mutex_lock(&state->lock);
+	/* Served by a grace period which ended while we waited for it. */
+	if (!rcu_seq_done(state->seq, cookie)) {
+		gp_stats_gp_start(state->stats);
+		do_grace_period(state, expedited);
+		gp_stats_gp_end(state->stats, NULL, 1);
+	}
+	mutex_unlock(&state->lock);
+
+	/* Order grace period end before the caller's following accesses. */
+	cmm_smp_mb();
+}
+
+/*
+ * Expedited grace periods busy-wait for readers instead of sleeping on
+ * the futex.
+ */
+static void __synchronize_rcu_expedited(struct rcu_gp_state *state)
+{
+	__synchronize_rcu_private(state, 1);
+}
+
+void synchronize_rcu_expedited(void)
+{
+	__synchronize_rcu_expedited(&default_gp_state);
+}
+
+int synchronize_rcu_timeout(const struct timespec *timeout)
+{
+	return gp_poll_synchronize_timeout(timeout);
+}
+
+/*
+ * Grace period led by the poll worker on behalf of the queued waiters,
+ * when the first of them is asynchronous.
+ */
+static void rcu_gp_lead_waiters(void)
+{
+	struct rcu_gp_state *state = &default_gp_state;
+	struct urcu_waiters waiters;
+
+	mutex_lock(&state->lock);
+	urcu_move_waiters(&waiters, &state->waiters);
+	if (!waiters.head) {
+		mutex_unlock(&state->lock);
+		return;
+	}
+	gp_stats_gp_start(state->stats);
+	do_grace_period(state, 0);
+	gp_stats_gp_end(state->stats, &waiters, 0);
+	mutex_unlock(&state->lock);
+
+	urcu_wake_all_waiters(&waiters);
+}
+
+static void rcu_gp_poll_synchronize(void)
+{
+	__synchronize_rcu_private(&default_gp_state, 0);
+}
+
+int rcu_gp_notify_eventfd(int fd)
+{
+	return gp_notify_eventfd(&default_gp_state.waiters, fd);
+}
+
+/*
+ * Opt in to hierarchical grace period detection.
+ */
+int rcu_enable_hierarchical_gp(int cpus_per_group)
+{
+	int ret;
+
+	mutex_lock(&default_gp_state.lock);
+	mutex_lock(&default_gp_state.registry_lock);
+	ret = reader_scan_enable_tree(&default_gp_state.scan, cpus_per_group);
+	mutex_unlock(&default_gp_state.registry_lock);
+	mutex_unlock(&default_gp_state.lock);
+	return ret;
+}
+
+void rcu_gp_stats_enable(int enable)
+{
+	gp_stats_enable(&gp_stats, enable);
+}
+
+void rcu_gp_stats_get(struct rcu_gp_stats *stats)
+{
+	gp_stats_get(&gp_stats, stats);
+}
+
+void rcu_gp_stats_reset(void)
+{
+	gp_stats_reset(&gp_stats);
+}
+
+int rcu_set_stall_detector(unsigned long timeout_ms, rcu_stall_func_t func,
+		void *priv)
+{
+	int ret;
+
+	mutex_lock(&default_gp_state.lock);
+	ret = stall_detector_set(&stall_detector, timeout_ms, func, priv);
+	mutex_unlock(&default_gp_state.lock);
+	return ret;
+}
+
+int rcu_set_spin_policy(const struct rcu_spin_policy *policy)
+{
+	int ret;
+
+	ret = urcu_spin_set(&gp_spin, policy);
+	if (ret)
+		return ret;
+	return urcu_spin_set(&waiter_spin, policy);
+}
+
+void rcu_get_spin_policy(struct rcu_spin_policy *policy)
+{
+	urcu_spin_get(&gp_spin, policy);
+	policy->gp_spin_ns = CMM_LOAD_SHARED(gp_spin.spin_ns);
+	policy->waiter_spin_ns = CMM_LOAD_SHARED(waiter_spin.spin_ns);
+}
+
 /*
  * library wrappers to be used by non-LGPL compatible source code.
  */
@@ -443,23 +658,59 @@ int rcu_read_ongoing(void)
 	return _rcu_read_ongoing();
 }
 
-void rcu_register_thread(void)
+void rcu_domain_read_lock(struct rcu_domain *domain)
+{
+	_rcu_domain_read_lock(domain);
+}
+
+void rcu_domain_read_unlock(struct rcu_domain *domain)
+{
+	_rcu_domain_read_unlock(domain);
+}
+
+int rcu_domain_read_ongoing(struct rcu_domain *domain)
 {
-	URCU_TLS(rcu_reader).tid = pthread_self();
-	assert(URCU_TLS(rcu_reader).need_mb == 0);
-	assert(!(URCU_TLS(rcu_reader).ctr & RCU_GP_CTR_NEST_MASK));
+	return _rcu_domain_read_ongoing(domain);
+}
+
+/*
+ * Registration is lock-free: the reader joins the registry at the start
+ * of the next grace period, and the grace period in progress, if any,
+ * does not need to wait for it.
+ */
+static void add_reader(struct rcu_gp_state *state, struct rcu_reader *reader)
+{
+	reader->tid = pthread_self();
+	assert(reader->need_mb == 0);
+	assert(!(reader->ctr & RCU_GP_CTR_NEST_MASK));
 
-	mutex_lock(&rcu_gp_lock);
 	rcu_init();	/* In case gcc does not support constructor attribute */
-	cds_list_add(&URCU_TLS(rcu_reader).node, &registry);
-	mutex_unlock(&rcu_gp_lock);
+	reader_scan_join(&state->scan, &reader->node);
+}
+
+/*
+ * Only waits for the grace period in progress, if any, to finish its
+ * current pass over the readers.
+ */
+static void del_reader(struct rcu_gp_state *state, struct rcu_reader *reader)
+{
+	mutex_lock(&state->registry_lock);
+	reader_scan_leave(&state->scan, &state->registry, &reader->node,
+			&reader->ctr);
+	mutex_unlock(&state->registry_lock);
+}
+
+void rcu_register_thread(void)
+{
+#ifdef CONFIG_RCU_GP_REPLICAS
+	URCU_TLS(rcu_reader).gp_replica = gp_replica_select();
+#endif
+	add_reader(&default_gp_state, &URCU_TLS(rcu_reader));
 }
 
 void rcu_unregister_thread(void)
 {
-	mutex_lock(&rcu_gp_lock);
-	cds_list_del(&URCU_TLS(rcu_reader).node);
-	mutex_unlock(&rcu_gp_lock);
+	del_reader(&default_gp_state, &URCU_TLS(rcu_reader));
 }
 
 #ifdef RCU_MEMBARRIER
@@ -468,14 +719,41 @@ void rcu_init(void)
 	if (init_done)
 		return;
 	init_done = 1;
-	if (!membarrier(MEMBARRIER_EXPEDITED | MEMBARRIER_QUERY))
-		rcu_has_sys_membarrier = 1;
+
+	membarrier_cmd = membarrier_select_cmd();
+	switch (membarrier_cmd) {
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED:
+		membarrier_mode = RCU_MEMBARRIER_MODE_PRIVATE_EXPEDITED;
+		break;
+	case MEMBARRIER_CMD_GLOBAL_EXPEDITED:
+		membarrier_mode = RCU_MEMBARRIER_MODE_GLOBAL_EXPEDITED;
+		break;
+	case MEMBARRIER_CMD_GLOBAL:
+		membarrier_mode = RCU_MEMBARRIER_MODE_GLOBAL;
+		break;
+	default:
+#ifdef CONFIG_RCU_FORCE_SYS_MEMBARRIER
+		/* Readers rely on sys_membarrier() unconditionally. */
+		urcu_die(ENOSYS);
+#endif
+		return;
+	}
+	rcu_has_sys_membarrier = 1;
+}
+
+enum rcu_membarrier_mode rcu_get_membarrier_mode(void)
+{
+	rcu_init();	/* In case gcc does not support constructor attribute */
+	return membarrier_mode;
 }
 #endif
 
 #ifdef RCU_SIGNAL
 static void sigrcu_handler(int signo, siginfo_t *siginfo, void *context)
 {
+	struct rcu_reader *reader;
+	int i;
+
 	/*
 	 * Executing this cmm_smp_mb() is the only purpose of this signal handler.
 	 * It punctually promotes cmm_barrier() into cmm_smp_mb() on every thread it is
@@ -483,6 +761,12 @@ static void sigrcu_handler(int signo, siginfo_t *siginfo, void *context)
 	 */
 	cmm_smp_mb();
 	_CMM_STORE_SHARED(URCU_TLS(rcu_reader).need_mb, 0);
+	/* The barrier may have been requested by the grace period of a domain. */
+	for (i = 0; i < RCU_DOMAIN_MAX; i++) {
+		reader = URCU_TLS(rcu_domain_readers).reader[i];
+		if (reader)
+			_CMM_STORE_SHARED(reader->need_mb, 0);
+	}
 	cmm_smp_mb();
 }
 
@@ -490,9 +774,9 @@ static void sigrcu_handler(int signo, siginfo_t *siginfo, void *context)
  * rcu_init constructor. Called when the library is linked, but also when
  * reader threads are calling rcu_register_thread().
  * Should only be called by a single thread at a given time. This is ensured by
- * holing the rcu_gp_lock from rcu_register_thread() or by running at library
- * load time, which should not be executed by multiple threads nor concurrently
- * with rcu_register_thread() anyway.
+ * running at library load time, which should not be executed by multiple
+ * threads nor concurrently with rcu_register_thread() anyway: later calls
+ * return early.
  */
 void rcu_init(void)
 {
@@ -520,7 +804,8 @@ void rcu_exit(void)
 	if (ret)
 		urcu_die(errno);
 	assert(act.sa_sigaction == sigrcu_handler);
-	assert(cds_list_empty(&registry));
+	assert(cds_list_empty(&default_gp_state.registry));
+	assert(!default_gp_state.scan.joining);
 }
 
 #endif /* #ifdef RCU_SIGNAL */
@@ -529,3 +814,255 @@ DEFINE_RCU_FLAVOR(rcu_flavor);
 
 #include "urcu-call-rcu-impl.h"
 #include "urcu-defer-impl.h"
+
+/*
+ * RCU domains. Each domain has its own grace period state, and its own
+ * call_rcu thread, registered as a reader of the domain, which also
+ * performs the grace periods requested by
+ * rcu_domain_start_poll_synchronize().
+ */
+struct rcu_domain_data {
+	struct rcu_domain domain;	/* Used by readers. */
+	struct rcu_gp_state state;
+	unsigned long seq __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+	struct call_rcu_data *crdp;
+	struct rcu_head poll_head;
+	unsigned long poll_target;	/* Newest cookie requested. */
+	int poll_queued;		/* poll_head is queued. */
+	unsigned long poll_seq;		/* Sequence served by poll_head. */
+	struct gp_poll_waiters poll_waiters;	/* Waiting for poll_seq. */
+};
+
+/* Domain ids in use. Protected by default_gp_state.lock. */
+static char rcu_domain_ids[RCU_DOMAIN_MAX];
+
+static struct rcu_domain_data *rcu_domain_data(struct rcu_domain *domain)
+{
+	return caa_container_of(domain, struct rcu_domain_data, domain);
+}
+
+static void rcu_domain_gp_register(void *arg)
+{
+	rcu_domain_register_thread(arg);
+}
+
+static void rcu_domain_gp_unregister(void *arg)
+{
+	rcu_domain_unregister_thread(arg);
+}
+
+static void rcu_domain_gp_synchronize(void *arg)
+{
+	rcu_domain_synchronize(arg);
+}
+
+static const struct call_rcu_gp_ops rcu_domain_gp_ops = {
+	.register_thread = rcu_domain_gp_register,
+	.unregister_thread = rcu_domain_gp_unregister,
+	.synchronize = rcu_domain_gp_synchronize,
+};
+
+/*
+ * Return a new RCU domain, or NULL with errno set to ENOSPC if
+ * RCU_DOMAIN_MAX domains already exist, or ENOMEM.
+ */
+struct rcu_domain *rcu_domain_create(void)
+{
+	struct rcu_domain_data *data;
+	int id, ret;
+
+	ret = posix_memalign((void **) &data, CAA_CACHE_LINE_SIZE,
+			sizeof(*data));
+	if (ret) {
+		errno = ret;
+		return NULL;
+	}
+	memset(data, 0, sizeof(*data));
+
+	mutex_lock(&default_gp_state.lock);
+	rcu_init();	/* In case gcc does not support constructor attribute */
+	for (id = 0; id < RCU_DOMAIN_MAX; id++) {
+		if (!rcu_domain_ids[id])
+			break;
+	}
+	if (id < RCU_DOMAIN_MAX)
+		rcu_domain_ids[id] = 1;
+	mutex_unlock(&default_gp_state.lock);
+	if (id == RCU_DOMAIN_MAX) {
+		free(data);
+		errno = ENOSPC;
+		return NULL;
+	}
+
+	data->domain.gp.ctr = RCU_GP_COUNT;
+	data->domain.id = id;
+	data->state.gp = &data->domain.gp;
+	data->state.seq = &data->seq;
+	ret = pthread_mutex_init(&data->state.lock, NULL);
+	if (ret)
+		urcu_die(ret);
+	ret = pthread_mutex_init(&data->state.registry_lock, NULL);
+	if (ret)
+		urcu_die(ret);
+	CDS_INIT_LIST_HEAD(&data->state.registry);
+	reader_scan_init(&data->state.scan, &data->domain.gp);
+	cds_wfs_init(&data->state.waiters.stack);
+	data->state.gp_spin = &gp_spin;
+	data->state.waiter_spin = &waiter_spin;
+	data->crdp = create_call_rcu_data_gp(0, &rcu_domain_gp_ops,
+			&data->domain);
+	return &data->domain;
+}
+
+/*
+ * Every thread must have unregistered from the domain, and no thread may
+ * use it anymore. Callbacks already queued are invoked first.
+ */
+void rcu_domain_destroy(struct rcu_domain *domain)
+{
+	struct rcu_domain_data *data = rcu_domain_data(domain);
+	int ret;
+
+	/* Let the last poll request complete: it uses poll_head. */
+	gp_poll_waiters_add(&data->poll_waiters);
+	(void) gp_poll_waiters_wait(&data->poll_waiters, &data->poll_seq,
+			uatomic_read(&data->poll_target), 0);
+	call_rcu_data_free(data->crdp);
+	assert(cds_list_empty(&data->state.registry));
+	assert(!data->state.scan.joining);
+
+	reader_scan_fini(&data->state.scan);
+	ret = pthread_mutex_destroy(&data->state.lock);
+	if (ret)
+		urcu_die(ret);
+	ret = pthread_mutex_destroy(&data->state.registry_lock);
+	if (ret)
+		urcu_die(ret);
+	mutex_lock(&default_gp_state.lock);
+	rcu_domain_ids[domain->id] = 0;
+	mutex_unlock(&default_gp_state.lock);
+	free(data);
+}
+
+void rcu_domain_register_thread(struct rcu_domain *domain)
+{
+	struct rcu_reader *reader;
+	int ret;
+
+	assert(!URCU_TLS(rcu_domain_readers).reader[domain->id]);
+	ret = posix_memalign((void **) &reader, CAA_CACHE_LINE_SIZE,
+			sizeof(*reader));
+	if (ret)
+		urcu_die(ret);
+	memset(reader, 0, sizeof(*reader));
+	/* Visible to the signal handler before grace periods see it. */
+	URCU_TLS(rcu_domain_readers).reader[domain->id] = reader;
+	add_reader(&rcu_domain_data(domain)->state, reader);
+}
+
+void rcu_domain_unregister_thread(struct rcu_domain *domain)
+{
+	struct rcu_reader *reader;
+
+	reader = URCU_TLS(rcu_domain_readers).reader[domain->id];
+	del_reader(&rcu_domain_data(domain)->state, reader);
+	URCU_TLS(rcu_domain_readers).reader[domain->id] = NULL;
+	free(reader);
+}
+
+void rcu_domain_synchronize(struct rcu_domain *domain)
+{
+	__synchronize_rcu(&rcu_domain_data(domain)->state);
+}
+
+void rcu_domain_synchronize_expedited(struct rcu_domain *domain)
+{
+	__synchronize_rcu_expedited(&rcu_domain_data(domain)->state);
+}
+
+void rcu_domain_call_rcu(struct rcu_domain *domain,
+		struct rcu_head *head,
+		void (*func)(struct rcu_head *head))
+{
+	call_rcu_data_enqueue(rcu_domain_data(domain)->crdp, head, func);
+}
+
+static void rcu_domain_poll_request(struct rcu_domain_data *data,
+		unsigned long cookie);
+
+/*
+ * Invoked after a grace period of the domain. Queue poll_head again if
+ * a newer cookie was requested meanwhile, otherwise publish the
+ * sequence reached as served.
+ */
+static void rcu_domain_poll_func(struct rcu_head *head)
+{
+	struct rcu_domain_data *data;
+	unsigned long target;
+
+	data = caa_container_of(head, struct rcu_domain_data, poll_head);
+	uatomic_set(&data->poll_queued, 0);
+	/* Write poll_queued before read target. */
+	cmm_smp_mb();
+	target = uatomic_read(&data->poll_target);
+	if (!rcu_seq_done(&data->seq, target)) {
+		rcu_domain_poll_request(data, target);
+		return;
+	}
+	CMM_STORE_SHARED(data->poll_seq, CMM_LOAD_SHARED(data->seq));
+	gp_poll_waiters_wake(&data->poll_waiters);
+}
+
+static void rcu_domain_poll_request(struct rcu_domain_data *data,
+		unsigned long cookie)
+{
+	unsigned long old, target;
+
+	target = uatomic_read(&data->poll_target);
+	do {
+		old = target;
+		if (RCU_GP_SEQ_GE(old, cookie))
+			break;
+		target = uatomic_cmpxchg(&data->poll_target, old, cookie);
+	} while (target != old);
+	/* Write target before read poll_queued. */
+	cmm_smp_mb();
+	if (!uatomic_cmpxchg(&data->poll_queued, 0, 1))
+		call_rcu_data_enqueue(data->crdp, &data->poll_head,
+				rcu_domain_poll_func);
+}
+
+unsigned long rcu_domain_get_state_synchronize(struct rcu_domain *domain)
+{
+	/* Order prior updates before reading the sequence number. */
+	cmm_smp_mb();
+	return rcu_seq_snap(&rcu_domain_data(domain)->seq);
+}
+
+unsigned long rcu_domain_start_poll_synchronize(struct rcu_domain *domain)
+{
+	struct rcu_domain_data *data = rcu_domain_data(domain);
+	unsigned long cookie;
+
+	cookie = rcu_domain_get_state_synchronize(domain);
+	if (!rcu_seq_done(&data->seq, cookie))
+		rcu_domain_poll_request(data, cookie);
+	return cookie;
+}
+
+int rcu_domain_poll_state_synchronize(struct rcu_domain *domain,
+		unsigned long cookie)
+{
+	if (!rcu_seq_done(&rcu_domain_data(domain)->seq, cookie))
+		return 0;
+	/* Order grace period end before the caller's following accesses. */
+	cmm_smp_mb();
+	return 1;
+}
+
+void rcu_domain_cond_synchronize(struct rcu_domain *domain,
+		unsigned long cookie)
+{
+	if (!rcu_domain_poll_state_synchronize(domain, cookie))
+		rcu_domain_synchronize(domain);
+}
@@ -33,12 +33,17 @@
 
 #include <stdlib.h>
 #include <pthread.h>
+#include <time.h>
 
 /*
  * See urcu-pointer.h and urcu/static/urcu-pointer.h for pointer
  * publication headers.
  */
 #include <urcu-pointer.h>
+#include <urcu/gp-stats.h>
+#include <urcu/stall.h>
+#include <urcu/spin-policy.h>
+#include <urcu/read-profile.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -46,6 +51,8 @@ extern "C" {
 
 #include <urcu/map/urcu.h>
 
+struct rcu_domain;
+
 /*
  * Important !
  *
@@ -75,14 +82,23 @@ extern "C" {
 #define rcu_read_lock_memb		_rcu_read_lock
 #define rcu_read_unlock_memb		_rcu_read_unlock
 #define rcu_read_ongoing_memb		_rcu_read_ongoing
+#define rcu_domain_read_lock_memb	_rcu_domain_read_lock
+#define rcu_domain_read_unlock_memb	_rcu_domain_read_unlock
+#define rcu_domain_read_ongoing_memb	_rcu_domain_read_ongoing
 #elif defined(RCU_SIGNAL)
 #define rcu_read_lock_sig		_rcu_read_lock
 #define rcu_read_unlock_sig		_rcu_read_unlock
 #define rcu_read_ongoing_sig		_rcu_read_ongoing
+#define rcu_domain_read_lock_sig	_rcu_domain_read_lock
+#define rcu_domain_read_unlock_sig	_rcu_domain_read_unlock
+#define rcu_domain_read_ongoing_sig	_rcu_domain_read_ongoing
 #elif defined(RCU_MB)
 #define rcu_read_lock_mb		_rcu_read_lock
 #define rcu_read_unlock_mb		_rcu_read_unlock
 #define rcu_read_ongoing_mb		_rcu_read_ongoing
+#define rcu_domain_read_lock_mb		_rcu_domain_read_lock
+#define rcu_domain_read_unlock_mb	_rcu_domain_read_unlock
+#define rcu_domain_read_ongoing_mb	_rcu_domain_read_ongoing
 #endif
 
 #else /* !_LGPL_SOURCE */
@@ -96,21 +112,131 @@ extern void rcu_read_lock(void);
 extern void rcu_read_unlock(void);
 extern int rcu_read_ongoing(void);
 
+extern void rcu_domain_read_lock(struct rcu_domain *domain);
+extern void rcu_domain_read_unlock(struct rcu_domain *domain);
+extern int rcu_domain_read_ongoing(struct rcu_domain *domain);
+
 #endif /* !_LGPL_SOURCE */
 
 extern void synchronize_rcu(void);
 
+/*
+ * Grace period polling. A cookie returned by get_state_synchronize_rcu()
+ * or start_poll_synchronize_rcu() is reached once a full grace period
+ * has elapsed since the call. See rcu-api.txt.
+ */
+extern unsigned long get_state_synchronize_rcu(void);
+extern unsigned long start_poll_synchronize_rcu(void);
+extern int poll_state_synchronize_rcu(unsigned long cookie);
+extern void cond_synchronize_rcu(unsigned long cookie);
+
+/*
+ * Lower-latency synchronize_rcu(), at the expense of busy-waiting on the
+ * readers rather than sleeping.
+ */
+extern void synchronize_rcu_expedited(void);
+
+/*
+ * synchronize_rcu() waiting at most "timeout". Returns 0 if a grace period
+ * has elapsed, -ETIMEDOUT otherwise.
+ */
+extern int synchronize_rcu_timeout(const struct timespec *timeout);
+
+/*
+ * Write 1, as an 8-byte integer, to "fd" (usually an eventfd) once a grace
+ * period has elapsed, without blocking. Returns 0 or -ENOMEM.
+ */
+extern int rcu_gp_notify_eventfd(int fd);
+
+/*
+ * Hierarchical grace period detection: readers are scanned in parallel
+ * by one thread per group of "cpus_per_group" CPUs, or per NUMA node if
+ * 0. Returns 0 on success, negative error value otherwise.
+ */
+extern int rcu_enable_hierarchical_gp(int cpus_per_group);
+
+/*
+ * Grace period statistics, collected while enabled: latency histograms
+ * of grace periods and of their waits for readers, busy-wait and sleep
+ * counts, callers served and readers scanned. See rcu-api.txt.
+ */
+extern void rcu_gp_stats_enable(int enable);
+extern void rcu_gp_stats_get(struct rcu_gp_stats *stats);
+extern void rcu_gp_stats_reset(void);
+
+/*
+ * Report each reader holding up a grace period for more than timeout_ms
+ * to "func", then again every timeout_ms. A NULL "func" disables it.
+ */
+extern int rcu_set_stall_detector(unsigned long timeout_ms,
+		rcu_stall_func_t func, void *priv);
+
+/*
+ * How long waits for readers and for grace periods spin before sleeping.
+ */
+extern int rcu_set_spin_policy(const struct rcu_spin_policy *policy);
+extern void rcu_get_spin_policy(struct rcu_spin_policy *policy);
+
+/*
+ * Sample one in "period" outermost read-side critical sections, 0 to
+ * stop, and report the sampled durations aggregated by caller, longest
+ * total first. Return -ENOSYS unless configured with
+ * --enable-rcu-read-profile.
+ */
+extern int rcu_read_profile_enable(unsigned long period);
+extern int rcu_read_profile_get(struct rcu_read_profile_entry *entries,
+		int nr_entries);
+extern void rcu_read_profile_reset(void);
+
 /*
  * Reader thread registration.
  */
 extern void rcu_register_thread(void);
 extern void rcu_unregister_thread(void);
 
+/*
+ * RCU domains: independent grace period domains, each with its own
+ * grace period counter, reader registry, grace period waiters and
+ * call_rcu thread, so updaters of one domain never wait for the readers
+ * of another. Threads register to each domain they read in. See
+ * rcu-api.txt.
+ */
+extern struct rcu_domain *rcu_domain_create(void);
+extern void rcu_domain_destroy(struct rcu_domain *domain);
+extern void rcu_domain_register_thread(struct rcu_domain *domain);
+extern void rcu_domain_unregister_thread(struct rcu_domain *domain);
+extern void rcu_domain_synchronize(struct rcu_domain *domain);
+extern void rcu_domain_synchronize_expedited(struct rcu_domain *domain);
+extern unsigned long rcu_domain_get_state_synchronize(
+		struct rcu_domain *domain);
+extern unsigned long rcu_domain_start_poll_synchronize(
+		struct rcu_domain *domain);
+extern int rcu_domain_poll_state_synchronize(struct rcu_domain *domain,
+		unsigned long cookie);
+extern void rcu_domain_cond_synchronize(struct rcu_domain *domain,
+		unsigned long cookie);
+
 /*
  * Explicit rcu initialization, for "early" use within library constructors.
  */
 extern void rcu_init(void);
 
+#ifdef RCU_MEMBARRIER
+/*
+ * sys_membarrier() command issued by the writer to turn the readers'
+ * compiler barriers into memory barriers. RCU_MEMBARRIER_MODE_NONE means
+ * readers fall back on full memory barriers.
+ */
+enum rcu_membarrier_mode {
+	RCU_MEMBARRIER_MODE_NONE = 0,
+	RCU_MEMBARRIER_MODE_GLOBAL,
+	RCU_MEMBARRIER_MODE_GLOBAL_EXPEDITED,
+	RCU_MEMBARRIER_MODE_PRIVATE_EXPEDITED,
+};
+
+extern enum rcu_membarrier_mode rcu_get_membarrier_mode(void);
+#endif
+
 /*
  * Q.S. reporting are no-ops for these URCU flavors.
  */
@@ -134,4 +260,20 @@ static inline void rcu_thread_online(void)
 #include <urcu-defer.h>
 #include <urcu-flavor.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Schedule "func" to be invoked after a grace period of "domain", by
+ * the domain's own call_rcu thread.
+ */
+extern void rcu_domain_call_rcu(struct rcu_domain *domain,
+		struct rcu_head *head,
+		void (*func)(struct rcu_head *head));
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* _URCU_H */
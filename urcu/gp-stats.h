@@ -0,0 +1,61 @@
+#ifndef _URCU_GP_STATS_H
+#define _URCU_GP_STATS_H
+
+/*
+ * urcu/gp-stats.h
+ *
+ * Userspace RCU library - grace period statistics
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RCU_GP_STATS_HIST_BUCKETS	64
+
+/*
+ * Log2 histogram: bucket[i] counts the values v such that
+ * 2^i <= v < 2^(i + 1). bucket[0] also counts the zero values.
+ */
+struct rcu_gp_stats_hist {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint64_t bucket[RCU_GP_STATS_HIST_BUCKETS];
+};
+
+/*
+ * Statistics of the grace periods performed by a flavor while they are
+ * enabled. Times are in nanoseconds.
+ */
+struct rcu_gp_stats {
+	uint64_t nr_gp;				/* Grace periods. */
+	uint64_t nr_spins;			/* Busy-wait iterations. */
+	uint64_t nr_sleeps;			/* Waits for readers to wake us. */
+	struct rcu_gp_stats_hist gp_time;	/* Whole grace period. */
+	struct rcu_gp_stats_hist phase_time[2];	/* Each wait for readers. */
+	struct rcu_gp_stats_hist batch;		/* Callers served per period. */
+	struct rcu_gp_stats_hist readers;	/* Readers scanned per period. */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_GP_STATS_H */
@@ -45,20 +45,47 @@
 #define rcu_init			rcu_init_bp
 #define rcu_exit			rcu_exit_bp
 #define synchronize_rcu			synchronize_rcu_bp
+#define get_state_synchronize_rcu	get_state_synchronize_rcu_bp
+#define start_poll_synchronize_rcu	start_poll_synchronize_rcu_bp
+#define poll_state_synchronize_rcu	poll_state_synchronize_rcu_bp
+#define cond_synchronize_rcu		cond_synchronize_rcu_bp
+#define synchronize_rcu_expedited	synchronize_rcu_expedited_bp
+#define synchronize_rcu_timeout		synchronize_rcu_timeout_bp
+#define rcu_gp_notify_eventfd		rcu_gp_notify_eventfd_bp
+#define rcu_enable_hierarchical_gp	rcu_enable_hierarchical_gp_bp
+#define rcu_gp_stats_enable		rcu_gp_stats_enable_bp
+#define rcu_gp_stats_get		rcu_gp_stats_get_bp
+#define rcu_gp_stats_reset		rcu_gp_stats_reset_bp
+#define rcu_set_stall_detector		rcu_set_stall_detector_bp
+#define rcu_set_spin_policy		rcu_set_spin_policy_bp
+#define rcu_get_spin_policy		rcu_get_spin_policy_bp
+#define rcu_read_profile_enable	rcu_read_profile_enable_bp
+#define rcu_read_profile_get		rcu_read_profile_get_bp
+#define rcu_read_profile_reset	rcu_read_profile_reset_bp
+#define rcu_read_profile		rcu_read_profile_bp
+#define rcu_read_profile_begin	rcu_read_profile_begin_bp
+#define rcu_read_profile_end		rcu_read_profile_end_bp
 #define rcu_reader			rcu_reader_bp
 #define rcu_gp				rcu_gp_bp
+#define rcu_gp_replica			rcu_gp_replica_bp
+#define rcu_has_sys_membarrier		rcu_has_sys_membarrier_bp
 
 #define get_cpu_call_rcu_data		get_cpu_call_rcu_data_bp
 #define get_call_rcu_thread		get_call_rcu_thread_bp
 #define create_call_rcu_data		create_call_rcu_data_bp
+#define create_call_rcu_data_attr	create_call_rcu_data_attr_bp
+#define call_rcu_data_set_attr		call_rcu_data_set_attr_bp
+#define call_rcu_data_get_attr		call_rcu_data_get_attr_bp
 #define set_cpu_call_rcu_data		set_cpu_call_rcu_data_bp
 #define get_default_call_rcu_data	get_default_call_rcu_data_bp
 #define get_call_rcu_data		get_call_rcu_data_bp
 #define get_thread_call_rcu_data	get_thread_call_rcu_data_bp
 #define set_thread_call_rcu_data	set_thread_call_rcu_data_bp
 #define create_all_cpu_call_rcu_data	create_all_cpu_call_rcu_data_bp
+#define create_all_cpu_call_rcu_data_pool	create_all_cpu_call_rcu_data_pool_bp
 #define free_all_cpu_call_rcu_data	free_all_cpu_call_rcu_data_bp
 #define call_rcu			call_rcu_bp
+#define rcu_barrier			rcu_barrier_bp
 #define call_rcu_data_free		call_rcu_data_free_bp
 #define call_rcu_before_fork		call_rcu_before_fork_bp
 #define call_rcu_after_fork_parent	call_rcu_after_fork_parent_bp
@@ -69,6 +96,7 @@
 #define rcu_defer_unregister_thread	rcu_defer_unregister_thread_bp
 #define rcu_defer_barrier		rcu_defer_barrier_bp
 #define rcu_defer_barrier_thread	rcu_defer_barrier_thread_bp
+#define rcu_defer_barrier_timeout	rcu_defer_barrier_timeout_bp
 #define rcu_defer_exit			rcu_defer_exit_bp
 
 #define rcu_flavor			rcu_flavor_bp
@@ -48,19 +48,39 @@
 #define rcu_unregister_thread		rcu_unregister_thread_qsbr
 #define rcu_exit			rcu_exit_qsbr
 #define synchronize_rcu			synchronize_rcu_qsbr
+#define get_state_synchronize_rcu	get_state_synchronize_rcu_qsbr
+#define start_poll_synchronize_rcu	start_poll_synchronize_rcu_qsbr
+#define poll_state_synchronize_rcu	poll_state_synchronize_rcu_qsbr
+#define cond_synchronize_rcu		cond_synchronize_rcu_qsbr
+#define synchronize_rcu_expedited	synchronize_rcu_expedited_qsbr
+#define synchronize_rcu_timeout		synchronize_rcu_timeout_qsbr
+#define rcu_gp_notify_eventfd		rcu_gp_notify_eventfd_qsbr
+#define rcu_enable_hierarchical_gp	rcu_enable_hierarchical_gp_qsbr
+#define rcu_gp_stats_enable		rcu_gp_stats_enable_qsbr
+#define rcu_gp_stats_get		rcu_gp_stats_get_qsbr
+#define rcu_gp_stats_reset		rcu_gp_stats_reset_qsbr
+#define rcu_set_stall_detector		rcu_set_stall_detector_qsbr
+#define rcu_set_spin_policy		rcu_set_spin_policy_qsbr
+#define rcu_get_spin_policy		rcu_get_spin_policy_qsbr
 #define rcu_reader			rcu_reader_qsbr
 #define rcu_gp				rcu_gp_qsbr
+#define rcu_gp_replica			rcu_gp_replica_qsbr
 
 #define get_cpu_call_rcu_data		get_cpu_call_rcu_data_qsbr
 #define get_call_rcu_thread		get_call_rcu_thread_qsbr
 #define create_call_rcu_data		create_call_rcu_data_qsbr
+#define create_call_rcu_data_attr	create_call_rcu_data_attr_qsbr
+#define call_rcu_data_set_attr		call_rcu_data_set_attr_qsbr
+#define call_rcu_data_get_attr		call_rcu_data_get_attr_qsbr
 #define set_cpu_call_rcu_data		set_cpu_call_rcu_data_qsbr
 #define get_default_call_rcu_data	get_default_call_rcu_data_qsbr
 #define get_call_rcu_data		get_call_rcu_data_qsbr
 #define get_thread_call_rcu_data	get_thread_call_rcu_data_qsbr
 #define set_thread_call_rcu_data	set_thread_call_rcu_data_qsbr
 #define create_all_cpu_call_rcu_data	create_all_cpu_call_rcu_data_qsbr
+#define create_all_cpu_call_rcu_data_pool	create_all_cpu_call_rcu_data_pool_qsbr
 #define call_rcu			call_rcu_qsbr
+#define rcu_barrier			rcu_barrier_qsbr
 #define call_rcu_data_free		call_rcu_data_free_qsbr
 #define call_rcu_before_fork		call_rcu_before_fork_qsbr
 #define call_rcu_after_fork_parent	call_rcu_after_fork_parent_qsbr
@@ -71,6 +91,7 @@
 #define rcu_defer_unregister_thread	rcu_defer_unregister_thread_qsbr
 #define	rcu_defer_barrier		rcu_defer_barrier_qsbr
 #define rcu_defer_barrier_thread	rcu_defer_barrier_thread_qsbr
+#define rcu_defer_barrier_timeout	rcu_defer_barrier_timeout_qsbr
 #define rcu_defer_exit			rcu_defer_exit_qsbr
 
 #define rcu_flavor			rcu_flavor_qsbr
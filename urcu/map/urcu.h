@@ -51,20 +51,65 @@
 #define rcu_init			rcu_init_memb
 #define rcu_exit			rcu_exit_memb
 #define synchronize_rcu			synchronize_rcu_memb
+#define get_state_synchronize_rcu	get_state_synchronize_rcu_memb
+#define start_poll_synchronize_rcu	start_poll_synchronize_rcu_memb
+#define poll_state_synchronize_rcu	poll_state_synchronize_rcu_memb
+#define cond_synchronize_rcu		cond_synchronize_rcu_memb
+#define synchronize_rcu_expedited	synchronize_rcu_expedited_memb
+#define synchronize_rcu_timeout		synchronize_rcu_timeout_memb
+#define rcu_gp_notify_eventfd		rcu_gp_notify_eventfd_memb
+#define rcu_enable_hierarchical_gp	rcu_enable_hierarchical_gp_memb
+#define rcu_gp_stats_enable		rcu_gp_stats_enable_memb
+#define rcu_gp_stats_get		rcu_gp_stats_get_memb
+#define rcu_gp_stats_reset		rcu_gp_stats_reset_memb
+#define rcu_set_stall_detector		rcu_set_stall_detector_memb
+#define rcu_set_spin_policy		rcu_set_spin_policy_memb
+#define rcu_get_spin_policy		rcu_get_spin_policy_memb
+#define rcu_read_profile_enable	rcu_read_profile_enable_memb
+#define rcu_read_profile_get		rcu_read_profile_get_memb
+#define rcu_read_profile_reset	rcu_read_profile_reset_memb
+#define rcu_read_profile		rcu_read_profile_memb
+#define rcu_read_profile_begin	rcu_read_profile_begin_memb
+#define rcu_read_profile_end		rcu_read_profile_end_memb
 #define rcu_reader			rcu_reader_memb
 #define rcu_gp				rcu_gp_memb
+#define rcu_gp_replica			rcu_gp_replica_memb
+
+#define rcu_domain_create		rcu_domain_create_memb
+#define rcu_domain_destroy		rcu_domain_destroy_memb
+#define rcu_domain_register_thread	rcu_domain_register_thread_memb
+#define rcu_domain_unregister_thread	rcu_domain_unregister_thread_memb
+#define rcu_domain_read_lock		rcu_domain_read_lock_memb
+#define _rcu_domain_read_lock		_rcu_domain_read_lock_memb
+#define rcu_domain_read_unlock		rcu_domain_read_unlock_memb
+#define _rcu_domain_read_unlock		_rcu_domain_read_unlock_memb
+#define rcu_domain_read_ongoing		rcu_domain_read_ongoing_memb
+#define _rcu_domain_read_ongoing	_rcu_domain_read_ongoing_memb
+#define rcu_domain_synchronize		rcu_domain_synchronize_memb
+#define rcu_domain_synchronize_expedited	rcu_domain_synchronize_expedited_memb
+#define rcu_domain_get_state_synchronize	rcu_domain_get_state_synchronize_memb
+#define rcu_domain_start_poll_synchronize	rcu_domain_start_poll_synchronize_memb
+#define rcu_domain_poll_state_synchronize	rcu_domain_poll_state_synchronize_memb
+#define rcu_domain_cond_synchronize	rcu_domain_cond_synchronize_memb
+#define rcu_domain_call_rcu		rcu_domain_call_rcu_memb
+#define rcu_domain_readers		rcu_domain_readers_memb
 
 #define get_cpu_call_rcu_data		get_cpu_call_rcu_data_memb
 #define get_call_rcu_thread		get_call_rcu_thread_memb
 #define create_call_rcu_data		create_call_rcu_data_memb
+#define create_call_rcu_data_attr	create_call_rcu_data_attr_memb
+#define call_rcu_data_set_attr		call_rcu_data_set_attr_memb
+#define call_rcu_data_get_attr		call_rcu_data_get_attr_memb
 #define set_cpu_call_rcu_data		set_cpu_call_rcu_data_memb
 #define get_default_call_rcu_data	get_default_call_rcu_data_memb
 #define get_call_rcu_data		get_call_rcu_data_memb
 #define get_thread_call_rcu_data	get_thread_call_rcu_data_memb
 #define set_thread_call_rcu_data	set_thread_call_rcu_data_memb
 #define create_all_cpu_call_rcu_data	create_all_cpu_call_rcu_data_memb
+#define create_all_cpu_call_rcu_data_pool	create_all_cpu_call_rcu_data_pool_memb
 #define free_all_cpu_call_rcu_data	free_all_cpu_call_rcu_data_memb
 #define call_rcu			call_rcu_memb
+#define rcu_barrier			rcu_barrier_memb
 #define call_rcu_data_free		call_rcu_data_free_memb
 #define call_rcu_before_fork		call_rcu_before_fork_memb
 #define call_rcu_after_fork_parent	call_rcu_after_fork_parent_memb
@@ -75,6 +120,7 @@
 #define rcu_defer_unregister_thread	rcu_defer_unregister_thread_memb
 #define rcu_defer_barrier		rcu_defer_barrier_memb
 #define rcu_defer_barrier_thread	rcu_defer_barrier_thread_memb
+#define rcu_defer_barrier_timeout	rcu_defer_barrier_timeout_memb
 #define rcu_defer_exit			rcu_defer_exit_memb
 
 #define rcu_flavor			rcu_flavor_memb
@@ -84,6 +130,7 @@
 
 /* Specific to MEMBARRIER flavor */
 #define rcu_has_sys_membarrier		rcu_has_sys_membarrier_memb
+#define rcu_get_membarrier_mode		rcu_get_membarrier_mode_memb
 
 #elif defined(RCU_SIGNAL)
 
@@ -98,20 +145,65 @@
 #define rcu_init			rcu_init_sig
 #define rcu_exit			rcu_exit_sig
 #define synchronize_rcu			synchronize_rcu_sig
+#define get_state_synchronize_rcu	get_state_synchronize_rcu_sig
+#define start_poll_synchronize_rcu	start_poll_synchronize_rcu_sig
+#define poll_state_synchronize_rcu	poll_state_synchronize_rcu_sig
+#define cond_synchronize_rcu		cond_synchronize_rcu_sig
+#define synchronize_rcu_expedited	synchronize_rcu_expedited_sig
+#define synchronize_rcu_timeout		synchronize_rcu_timeout_sig
+#define rcu_gp_notify_eventfd		rcu_gp_notify_eventfd_sig
+#define rcu_enable_hierarchical_gp	rcu_enable_hierarchical_gp_sig
+#define rcu_gp_stats_enable		rcu_gp_stats_enable_sig
+#define rcu_gp_stats_get		rcu_gp_stats_get_sig
+#define rcu_gp_stats_reset		rcu_gp_stats_reset_sig
+#define rcu_set_stall_detector		rcu_set_stall_detector_sig
+#define rcu_set_spin_policy		rcu_set_spin_policy_sig
+#define rcu_get_spin_policy		rcu_get_spin_policy_sig
+#define rcu_read_profile_enable	rcu_read_profile_enable_sig
+#define rcu_read_profile_get		rcu_read_profile_get_sig
+#define rcu_read_profile_reset	rcu_read_profile_reset_sig
+#define rcu_read_profile		rcu_read_profile_sig
+#define rcu_read_profile_begin	rcu_read_profile_begin_sig
+#define rcu_read_profile_end		rcu_read_profile_end_sig
 #define rcu_reader			rcu_reader_sig
 #define rcu_gp				rcu_gp_sig
+#define rcu_gp_replica			rcu_gp_replica_sig
+
+#define rcu_domain_create		rcu_domain_create_sig
+#define rcu_domain_destroy		rcu_domain_destroy_sig
+#define rcu_domain_register_thread	rcu_domain_register_thread_sig
+#define rcu_domain_unregister_thread	rcu_domain_unregister_thread_sig
+#define rcu_domain_read_lock		rcu_domain_read_lock_sig
+#define _rcu_domain_read_lock		_rcu_domain_read_lock_sig
+#define rcu_domain_read_unlock		rcu_domain_read_unlock_sig
+#define _rcu_domain_read_unlock		_rcu_domain_read_unlock_sig
+#define rcu_domain_read_ongoing		rcu_domain_read_ongoing_sig
+#define _rcu_domain_read_ongoing	_rcu_domain_read_ongoing_sig
+#define rcu_domain_synchronize		rcu_domain_synchronize_sig
+#define rcu_domain_synchronize_expedited	rcu_domain_synchronize_expedited_sig
+#define rcu_domain_get_state_synchronize	rcu_domain_get_state_synchronize_sig
+#define rcu_domain_start_poll_synchronize	rcu_domain_start_poll_synchronize_sig
+#define rcu_domain_poll_state_synchronize	rcu_domain_poll_state_synchronize_sig
+#define rcu_domain_cond_synchronize	rcu_domain_cond_synchronize_sig
+#define rcu_domain_call_rcu		rcu_domain_call_rcu_sig
+#define rcu_domain_readers		rcu_domain_readers_sig
 
 #define get_cpu_call_rcu_data		get_cpu_call_rcu_data_sig
 #define get_call_rcu_thread		get_call_rcu_thread_sig
 #define create_call_rcu_data		create_call_rcu_data_sig
+#define create_call_rcu_data_attr	create_call_rcu_data_attr_sig
+#define call_rcu_data_set_attr		call_rcu_data_set_attr_sig
+#define call_rcu_data_get_attr		call_rcu_data_get_attr_sig
 #define set_cpu_call_rcu_data		set_cpu_call_rcu_data_sig
 #define get_default_call_rcu_data	get_default_call_rcu_data_sig
 #define get_call_rcu_data		get_call_rcu_data_sig
 #define get_thread_call_rcu_data	get_thread_call_rcu_data_sig
 #define set_thread_call_rcu_data	set_thread_call_rcu_data_sig
 #define create_all_cpu_call_rcu_data	create_all_cpu_call_rcu_data_sig
+#define create_all_cpu_call_rcu_data_pool	create_all_cpu_call_rcu_data_pool_sig
 #define free_all_cpu_call_rcu_data	free_all_cpu_call_rcu_data_sig
 #define call_rcu			call_rcu_sig
+#define rcu_barrier			rcu_barrier_sig
 #define call_rcu_data_free		call_rcu_data_free_sig
 #define call_rcu_before_fork		call_rcu_before_fork_sig
 #define call_rcu_after_fork_parent	call_rcu_after_fork_parent_sig
@@ -122,6 +214,7 @@
 #define rcu_defer_unregister_thread	rcu_defer_unregister_thread_sig
 #define rcu_defer_barrier		rcu_defer_barrier_sig
 #define rcu_defer_barrier_thread	rcu_defer_barrier_thread_sig
+#define rcu_defer_barrier_timeout	rcu_defer_barrier_timeout_sig
 #define rcu_defer_exit			rcu_defer_exit_sig
 
 #define rcu_flavor			rcu_flavor_sig
@@ -142,20 +235,65 @@
 #define rcu_init			rcu_init_mb
 #define rcu_exit			rcu_exit_mb
 #define synchronize_rcu			synchronize_rcu_mb
+#define get_state_synchronize_rcu	get_state_synchronize_rcu_mb
+#define start_poll_synchronize_rcu	start_poll_synchronize_rcu_mb
+#define poll_state_synchronize_rcu	poll_state_synchronize_rcu_mb
+#define cond_synchronize_rcu		cond_synchronize_rcu_mb
+#define synchronize_rcu_expedited	synchronize_rcu_expedited_mb
+#define synchronize_rcu_timeout		synchronize_rcu_timeout_mb
+#define rcu_gp_notify_eventfd		rcu_gp_notify_eventfd_mb
+#define rcu_enable_hierarchical_gp	rcu_enable_hierarchical_gp_mb
+#define rcu_gp_stats_enable		rcu_gp_stats_enable_mb
+#define rcu_gp_stats_get		rcu_gp_stats_get_mb
+#define rcu_gp_stats_reset		rcu_gp_stats_reset_mb
+#define rcu_set_stall_detector		rcu_set_stall_detector_mb
+#define rcu_set_spin_policy		rcu_set_spin_policy_mb
+#define rcu_get_spin_policy		rcu_get_spin_policy_mb
+#define rcu_read_profile_enable	rcu_read_profile_enable_mb
+#define rcu_read_profile_get		rcu_read_profile_get_mb
+#define rcu_read_profile_reset	rcu_read_profile_reset_mb
+#define rcu_read_profile		rcu_read_profile_mb
+#define rcu_read_profile_begin	rcu_read_profile_begin_mb
+#define rcu_read_profile_end		rcu_read_profile_end_mb
 #define rcu_reader			rcu_reader_mb
 #define rcu_gp				rcu_gp_mb
+#define rcu_gp_replica			rcu_gp_replica_mb
+
+#define rcu_domain_create		rcu_domain_create_mb
+#define rcu_domain_destroy		rcu_domain_destroy_mb
+#define rcu_domain_register_thread	rcu_domain_register_thread_mb
+#define rcu_domain_unregister_thread	rcu_domain_unregister_thread_mb
+#define rcu_domain_read_lock		rcu_domain_read_lock_mb
+#define _rcu_domain_read_lock		_rcu_domain_read_lock_mb
+#define rcu_domain_read_unlock		rcu_domain_read_unlock_mb
+#define _rcu_domain_read_unlock		_rcu_domain_read_unlock_mb
+#define rcu_domain_read_ongoing		rcu_domain_read_ongoing_mb
+#define _rcu_domain_read_ongoing	_rcu_domain_read_ongoing_mb
+#define rcu_domain_synchronize		rcu_domain_synchronize_mb
+#define rcu_domain_synchronize_expedited	rcu_domain_synchronize_expedited_mb
+#define rcu_domain_get_state_synchronize	rcu_domain_get_state_synchronize_mb
+#define rcu_domain_start_poll_synchronize	rcu_domain_start_poll_synchronize_mb
+#define rcu_domain_poll_state_synchronize	rcu_domain_poll_state_synchronize_mb
+#define rcu_domain_cond_synchronize	rcu_domain_cond_synchronize_mb
+#define rcu_domain_call_rcu		rcu_domain_call_rcu_mb
+#define rcu_domain_readers		rcu_domain_readers_mb
 
 #define get_cpu_call_rcu_data		get_cpu_call_rcu_data_mb
 #define get_call_rcu_thread		get_call_rcu_thread_mb
 #define create_call_rcu_data		create_call_rcu_data_mb
+#define create_call_rcu_data_attr	create_call_rcu_data_attr_mb
+#define call_rcu_data_set_attr		call_rcu_data_set_attr_mb
+#define call_rcu_data_get_attr		call_rcu_data_get_attr_mb
 #define set_cpu_call_rcu_data		set_cpu_call_rcu_data_mb
 #define get_default_call_rcu_data	get_default_call_rcu_data_mb
 #define get_call_rcu_data		get_call_rcu_data_mb
 #define get_thread_call_rcu_data	get_thread_call_rcu_data_mb
 #define set_thread_call_rcu_data	set_thread_call_rcu_data_mb
 #define create_all_cpu_call_rcu_data	create_all_cpu_call_rcu_data_mb
+#define create_all_cpu_call_rcu_data_pool	create_all_cpu_call_rcu_data_pool_mb
 #define free_all_cpu_call_rcu_data	free_all_cpu_call_rcu_data_mb
 #define call_rcu			call_rcu_mb
+#define rcu_barrier			rcu_barrier_mb
 #define call_rcu_data_free		call_rcu_data_free_mb
 #define call_rcu_before_fork		call_rcu_before_fork_mb
 #define call_rcu_after_fork_parent	call_rcu_after_fork_parent_mb
@@ -166,6 +304,7 @@
 #define rcu_defer_unregister_thread	rcu_defer_unregister_thread_mb
 #define rcu_defer_barrier		rcu_defer_barrier_mb
 #define rcu_defer_barrier_thread	rcu_defer_barrier_thread_mb
+#define rcu_defer_barrier_timeout	rcu_defer_barrier_timeout_mb
 #define rcu_defer_exit			rcu_defer_exit_mb
 
 #define rcu_flavor			rcu_flavor_mb
@@ -0,0 +1,116 @@
+#ifndef _URCU_RCURWLOCK_H
+#define _URCU_RCURWLOCK_H
+
+/*
+ * urcu/rcurwlock.h
+ *
+ * Userspace RCU library - RCU-assisted reader-biased reader-writer lock
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Reader-writer lock whose readers, while the lock is reader-biased, only
+ * publish the lock in a slot of a global table of visible readers, from
+ * within an RCU read-side critical section. A writer clears the bias,
+ * waits for a grace period, after which readers which saw the bias are
+ * all visible in the table, and waits for them to leave. Other readers
+ * and writers use the underlying pthread rwlock. Readers restore the bias
+ * once a multiple of the time the last revocation took has elapsed, so
+ * that frequent writers do not pay for a grace period each (BRAVO).
+ *
+ * Readers must be registered RCU reader threads of the flavor included
+ * before this header, and must not be nested within a read-side critical
+ * section. Writers must not be within a read-side critical section.
+ * With QSBR, readers and registered writers must be online: they are put
+ * offline while blocking on the rwlock.
+ */
+struct rcu_rwlock {
+	int rbias;			/* Readers use the visible table. */
+	uint64_t inhibit_until;		/* No bias until then, in ns. */
+	pthread_rwlock_t rwlock;
+	const struct rcu_flavor_struct *flavor;
+};
+
+/* Read-side state, from rcu_rwlock_read_lock() to its unlock. */
+struct rcu_rwlock_reader {
+	struct rcu_rwlock **slot;	/* NULL if holding rwlock. */
+};
+
+#define RCU_RWLOCK_READERS_ORDER	12
+
+extern struct rcu_rwlock *rcu_rwlock_visible_readers[1UL << RCU_RWLOCK_READERS_ORDER];
+
+/*
+ * _rcu_rwlock_init - API used by rcu_rwlock_init wrapper. Do not use
+ * directly.
+ */
+extern int _rcu_rwlock_init(struct rcu_rwlock *lock,
+		const struct rcu_flavor_struct *flavor);
+
+/*
+ * rcu_rwlock_init - initialize a lock, reader-biased, for the RCU flavor
+ * included before this header. Returns 0, or an error number from
+ * pthread_rwlock_init().
+ */
+static inline int rcu_rwlock_init(struct rcu_rwlock *lock)
+{
+	return _rcu_rwlock_init(lock, &rcu_flavor);
+}
+
+extern int rcu_rwlock_destroy(struct rcu_rwlock *lock);
+
+/* Slow paths of the read-side, do not use directly. */
+extern void rcu_rwlock_read_lock_slow(struct rcu_rwlock *lock,
+		struct rcu_rwlock_reader *reader);
+extern void rcu_rwlock_read_unlock_slow(struct rcu_rwlock *lock);
+
+extern void rcu_rwlock_write_lock(struct rcu_rwlock *lock);
+extern void rcu_rwlock_write_unlock(struct rcu_rwlock *lock);
+
+#ifdef _LGPL_SOURCE
+
+#include <urcu/static/rcurwlock.h>
+
+#define rcu_rwlock_read_lock		_rcu_rwlock_read_lock
+#define rcu_rwlock_read_unlock		_rcu_rwlock_read_unlock
+
+#else /* !_LGPL_SOURCE */
+
+/*
+ * Take "lock" for reading. "reader" is the caller's, and is passed as is
+ * to rcu_rwlock_read_unlock().
+ */
+extern void rcu_rwlock_read_lock(struct rcu_rwlock *lock,
+		struct rcu_rwlock_reader *reader);
+extern void rcu_rwlock_read_unlock(struct rcu_rwlock *lock,
+		struct rcu_rwlock_reader *reader);
+
+#endif /* !_LGPL_SOURCE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_RCURWLOCK_H */
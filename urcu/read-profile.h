@@ -0,0 +1,58 @@
+#ifndef _URCU_READ_PROFILE_H
+#define _URCU_READ_PROFILE_H
+
+/*
+ * urcu/read-profile.h
+ *
+ * Userspace RCU library - read-side critical section sampling profiler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sampled outermost read-side critical sections, aggregated by "caller":
+ * the return address of the function which called rcu_read_lock(), or
+ * which inlined it. Durations are in caa_get_cycles() units. A NULL
+ * caller accounts for the samples of threads which saw too many callers.
+ */
+struct rcu_read_profile_entry {
+	void *caller;
+	uint64_t nr_samples;
+	uint64_t total_cycles;
+	uint64_t max_cycles;
+};
+
+struct rcu_read_profile_buf;
+
+/* Per-thread sampling state, used by the read-side. */
+struct rcu_read_profile_thread {
+	unsigned long countdown;	/* Sections before the next sample. */
+	int sampling;			/* Current section is sampled. */
+	void *caller;
+	uint64_t start;
+	struct rcu_read_profile_buf *buf;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_READ_PROFILE_H */
@@ -0,0 +1,49 @@
+#ifndef _URCU_SPIN_POLICY_H
+#define _URCU_SPIN_POLICY_H
+
+/*
+ * urcu/spin-policy.h
+ *
+ * Userspace RCU library - spin-then-park policy of grace period waits
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * How long grace periods busy-wait for readers, and synchronize_rcu()
+ * callers for the grace period performed on their behalf, before
+ * sleeping. When adaptive, each budget follows twice the average of the
+ * recent waits, within [min_ns, max_ns]; waits longer than max_ns count
+ * as zero, since spinning would not have avoided sleeping. Otherwise,
+ * waits spin for max_ns.
+ */
+struct rcu_spin_policy {
+	unsigned long min_ns;
+	unsigned long max_ns;
+	int adaptive;
+	/* Current budgets, only filled by rcu_get_spin_policy(). */
+	unsigned long gp_spin_ns;	/* Grace period waiting for readers. */
+	unsigned long waiter_spin_ns;	/* Callers waiting for a grace period. */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_SPIN_POLICY_H */
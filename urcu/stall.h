@@ -0,0 +1,52 @@
+#ifndef _URCU_STALL_H
+#define _URCU_STALL_H
+
+/*
+ * urcu/stall.h
+ *
+ * Userspace RCU library - reader stall detection
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Reader holding up a grace period, as reported to the stall callback.
+ * "ctr" is a snapshot of the reader counter: with rcu-qsbr, the grace
+ * period counter observed by its last quiescent state; with the other
+ * flavors, the grace period phase and, in its low bits
+ * (RCU_GP_CTR_NEST_MASK), the read-side critical section nesting.
+ */
+struct rcu_stall_info {
+	pthread_t tid;			/* Stalled reader thread. */
+	unsigned long ctr;		/* Reader counter snapshot. */
+	unsigned long gp_ctr;		/* Grace period counter. */
+	uint64_t stall_ms;		/* Time the grace period waited. */
+};
+
+typedef void (*rcu_stall_func_t)(const struct rcu_stall_info *info,
+		void *priv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_STALL_H */
@@ -0,0 +1,49 @@
+#ifndef _URCU_GP_REPLICA_STATIC_H
+#define _URCU_GP_REPLICA_STATIC_H
+
+/*
+ * urcu/static/gp-replica.h
+ *
+ * Userspace RCU library - per-node copies of the grace period counter
+ *
+ * TO BE INCLUDED ONLY FROM urcu/static/urcu.h, urcu/static/urcu-qsbr.h
+ * AND urcu/static/urcu-bp.h.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <urcu/config.h>
+
+#ifdef CONFIG_RCU_GP_REPLICAS
+
+#include <urcu/arch.h>
+
+/*
+ * Copies of rcu_gp.ctr, each in its own cache line. A reader reads the
+ * copy of the NUMA node it registered on, modulo RCU_GP_NR_REPLICAS, so
+ * that a grace period only invalidates the line cached by each node
+ * rather than a line shared by all of them. The writer stores the new
+ * counter to rcu_gp.ctr and to every copy before waiting for readers,
+ * so rcu_reader_state() keeps comparing readers against rcu_gp.ctr.
+ */
+#define RCU_GP_NR_REPLICAS	8
+
+struct rcu_gp_replica {
+	unsigned long ctr;
+} __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+
+#endif /* CONFIG_RCU_GP_REPLICAS */
+
+#endif /* _URCU_GP_REPLICA_STATIC_H */
@@ -0,0 +1,91 @@
+#ifndef _URCU_RCURWLOCK_STATIC_H
+#define _URCU_RCURWLOCK_STATIC_H
+
+/*
+ * urcu/static/rcurwlock.h
+ *
+ * Userspace RCU library - RCU-assisted reader-biased reader-writer lock
+ *
+ * TO BE INCLUDED ONLY IN LGPL-COMPATIBLE CODE. See urcu/rcurwlock.h for
+ * linking dynamically with the userspace rcu library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <urcu/compiler.h>
+#include <urcu/arch.h>
+#include <urcu/system.h>
+#include <urcu/uatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Slot of the visible readers table for the calling thread and "lock". */
+static inline struct rcu_rwlock **_rcu_rwlock_slot(struct rcu_rwlock *lock)
+{
+	uint64_t hash;
+
+	hash = ((uint64_t) (uintptr_t) pthread_self()
+			^ (uint64_t) (uintptr_t) lock) * 0x9E3779B97F4A7C15ULL;
+	return &rcu_rwlock_visible_readers[hash
+			>> (64 - RCU_RWLOCK_READERS_ORDER)];
+}
+
+/*
+ * Publish "lock" in our slot if the lock is reader-biased, all within a
+ * read-side critical section, so that a writer clearing the bias and
+ * then waiting for a grace period sees the slot. The cmpxchg orders the
+ * slot before the critical section. Readers whose slot is taken, by
+ * another thread or lock, use the rwlock.
+ */
+static inline void _rcu_rwlock_read_lock(struct rcu_rwlock *lock,
+		struct rcu_rwlock_reader *reader)
+{
+	struct rcu_rwlock **slot;
+
+	if (caa_likely(CMM_LOAD_SHARED(lock->rbias))) {
+		slot = _rcu_rwlock_slot(lock);
+		lock->flavor->read_lock();
+		if (caa_likely(CMM_LOAD_SHARED(lock->rbias))
+				&& !uatomic_cmpxchg(slot, NULL, lock)) {
+			lock->flavor->read_unlock();
+			reader->slot = slot;
+			return;
+		}
+		lock->flavor->read_unlock();
+	}
+	rcu_rwlock_read_lock_slow(lock, reader);
+}
+
+static inline void _rcu_rwlock_read_unlock(struct rcu_rwlock *lock,
+		struct rcu_rwlock_reader *reader)
+{
+	if (caa_likely(reader->slot)) {
+		/* Order critical section before releasing the slot. */
+		cmm_smp_mb();
+		CMM_STORE_SHARED(*reader->slot, NULL);
+		return;
+	}
+	rcu_rwlock_read_unlock_slow(lock);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_RCURWLOCK_STATIC_H */
@@ -0,0 +1,76 @@
+#ifndef _URCU_READ_PROFILE_STATIC_H
+#define _URCU_READ_PROFILE_STATIC_H
+
+/*
+ * urcu/static/read-profile.h
+ *
+ * Userspace RCU library - read-side critical section sampling profiler
+ *
+ * TO BE INCLUDED ONLY FROM urcu/static/urcu.h AND urcu/static/urcu-bp.h,
+ * after the flavor mapping.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <urcu/config.h>
+
+#ifdef CONFIG_RCU_READ_PROFILE
+
+#include <urcu/compiler.h>
+#include <urcu/tls-compat.h>
+#include <urcu/read-profile.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern DECLARE_URCU_TLS(struct rcu_read_profile_thread, rcu_read_profile);
+
+extern void rcu_read_profile_begin(void *caller);
+extern void rcu_read_profile_end(void);
+
+/*
+ * Called with the nesting count "tmp" read before entering, once within
+ * the critical section. Every countdown expiry of an outermost section
+ * calls into the library, which samples it if enabled and reloads the
+ * countdown.
+ */
+#define _rcu_read_profile_lock(tmp, caller)				\
+do {									\
+	if (caa_likely(!((tmp) & RCU_GP_CTR_NEST_MASK))			\
+			&& caa_unlikely(!URCU_TLS(rcu_read_profile).countdown--)) \
+		rcu_read_profile_begin(caller);				\
+} while (0)
+
+/* Called with the nesting count "tmp" read before leaving. */
+#define _rcu_read_profile_unlock(tmp)					\
+do {									\
+	if (caa_unlikely(URCU_TLS(rcu_read_profile).sampling)		\
+			&& ((tmp) & RCU_GP_CTR_NEST_MASK) == RCU_GP_COUNT) \
+		rcu_read_profile_end();					\
+} while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#else /* !CONFIG_RCU_READ_PROFILE */
+
+#define _rcu_read_profile_lock(tmp, caller)	do { } while (0)
+#define _rcu_read_profile_unlock(tmp)		do { } while (0)
+
+#endif /* !CONFIG_RCU_READ_PROFILE */
+
+#endif /* _URCU_READ_PROFILE_STATIC_H */
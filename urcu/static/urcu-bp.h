@@ -39,6 +39,8 @@
 #include <urcu/uatomic.h>
 #include <urcu/list.h>
 #include <urcu/tls-compat.h>
+#include <urcu/static/read-profile.h>
+#include <urcu/static/gp-replica.h>
 
 /*
  * This code section can only be included in LGPL 2.1 compatible source code.
@@ -143,13 +145,21 @@ struct rcu_gp {
 
 extern struct rcu_gp rcu_gp;
 
+#ifdef CONFIG_RCU_GP_REPLICAS
+extern struct rcu_gp_replica rcu_gp_replica[RCU_GP_NR_REPLICAS];
+#endif
+
 struct rcu_reader {
 	/* Data used by both reader and synchronize_rcu() */
 	unsigned long ctr;
+#ifdef CONFIG_RCU_GP_REPLICAS
+	unsigned int gp_replica;	/* Index in rcu_gp_replica. */
+#endif
 	/* Data used for registry */
 	struct cds_list_head node __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
 	pthread_t tid;
 	int alloc;	/* registry entry allocated */
+	struct rcu_reader *next_free;	/* exited or free entries list */
 };
 
 /*
@@ -159,7 +169,36 @@ struct rcu_reader {
  */
 extern DECLARE_URCU_TLS(struct rcu_reader *, rcu_reader);
 
-static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
+/*
+ * Set when grace periods use sys_membarrier() to promote the readers'
+ * compiler barriers into memory barriers. Only changes from 0 to 1, with
+ * no grace period in progress.
+ */
+extern int rcu_has_sys_membarrier;
+
+static inline void smp_mb_slave(void)
+{
+	if (caa_likely(rcu_has_sys_membarrier))
+		cmm_barrier();
+	else
+		cmm_smp_mb();
+}
+
+/*
+ * Grace period counter read by the current thread, which is registered:
+ * the copy of its node, if replicated.
+ */
+static inline unsigned long *_rcu_gp_local_ctr(void)
+{
+#ifdef CONFIG_RCU_GP_REPLICAS
+	return &rcu_gp_replica[URCU_TLS(rcu_reader)->gp_replica].ctr;
+#else
+	return &rcu_gp.ctr;
+#endif
+}
+
+static inline enum rcu_state rcu_reader_state(struct rcu_gp *gp,
+		unsigned long *ctr)
 {
 	unsigned long v;
 
@@ -172,7 +211,7 @@ static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
 	v = CMM_LOAD_SHARED(*ctr);
 	if (!(v & RCU_GP_CTR_NEST_MASK))
 		return RCU_READER_INACTIVE;
-	if (!((v ^ rcu_gp.ctr) & RCU_GP_CTR_PHASE))
+	if (!((v ^ gp->ctr) & RCU_GP_CTR_PHASE))
 		return RCU_READER_ACTIVE_CURRENT;
 	return RCU_READER_ACTIVE_OLD;
 }
@@ -187,8 +226,9 @@ static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
 static inline void _rcu_read_lock_update(unsigned long tmp)
 {
 	if (caa_likely(!(tmp & RCU_GP_CTR_NEST_MASK))) {
-		_CMM_STORE_SHARED(URCU_TLS(rcu_reader)->ctr, _CMM_LOAD_SHARED(rcu_gp.ctr));
-		cmm_smp_mb();
+		_CMM_STORE_SHARED(URCU_TLS(rcu_reader)->ctr,
+			_CMM_LOAD_SHARED(*_rcu_gp_local_ctr()));
+		smp_mb_slave();
 	} else
 		_CMM_STORE_SHARED(URCU_TLS(rcu_reader)->ctr, tmp + RCU_GP_COUNT);
 }
@@ -212,6 +252,7 @@ static inline void _rcu_read_lock(void)
 	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
 	tmp = URCU_TLS(rcu_reader)->ctr;
 	_rcu_read_lock_update(tmp);
+	_rcu_read_profile_lock(tmp, __builtin_return_address(0));
 }
 
 /*
@@ -221,10 +262,11 @@ static inline void _rcu_read_lock(void)
  */
 static inline void _rcu_read_unlock(void)
 {
+	_rcu_read_profile_unlock(URCU_TLS(rcu_reader)->ctr);
 	/*
 	 * Finish using rcu before decrementing the pointer.
 	 */
-	cmm_smp_mb();
+	smp_mb_slave();
 	_CMM_STORE_SHARED(URCU_TLS(rcu_reader)->ctr, URCU_TLS(rcu_reader)->ctr - RCU_GP_COUNT);
 	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
 }
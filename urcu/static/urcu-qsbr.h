@@ -43,6 +43,7 @@
 #include <urcu/list.h>
 #include <urcu/futex.h>
 #include <urcu/tls-compat.h>
+#include <urcu/static/gp-replica.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -132,9 +133,16 @@ struct rcu_gp {
 
 extern struct rcu_gp rcu_gp;
 
+#ifdef CONFIG_RCU_GP_REPLICAS
+extern struct rcu_gp_replica rcu_gp_replica[RCU_GP_NR_REPLICAS];
+#endif
+
 struct rcu_reader {
 	/* Data used by both reader and synchronize_rcu() */
 	unsigned long ctr;
+#ifdef CONFIG_RCU_GP_REPLICAS
+	unsigned int gp_replica;	/* Index in rcu_gp_replica. */
+#endif
 	/* Data used for registry */
 	struct cds_list_head node __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
 	int waiting;
@@ -159,14 +167,28 @@ static inline void wake_up_gp(void)
 	}
 }
 
-static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
+/*
+ * Grace period counter read by the current thread: the copy of its node,
+ * if replicated.
+ */
+static inline unsigned long *_rcu_gp_local_ctr(void)
+{
+#ifdef CONFIG_RCU_GP_REPLICAS
+	return &rcu_gp_replica[URCU_TLS(rcu_reader).gp_replica].ctr;
+#else
+	return &rcu_gp.ctr;
+#endif
+}
+
+static inline enum rcu_state rcu_reader_state(struct rcu_gp *gp,
+		unsigned long *ctr)
 {
 	unsigned long v;
 
 	v = CMM_LOAD_SHARED(*ctr);
 	if (!v)
 		return RCU_READER_INACTIVE;
-	if (v == rcu_gp.ctr)
+	if (v == gp->ctr)
 		return RCU_READER_ACTIVE_CURRENT;
 	return RCU_READER_ACTIVE_OLD;
 }
@@ -232,7 +254,7 @@ static inline void _rcu_quiescent_state_update_and_wakeup(unsigned long gp_ctr)
  * to be invoked directly from non-LGPL code.
  *
  * We skip the memory barriers and gp store if our local ctr already
- * matches the global rcu_gp.ctr value: this is OK because a prior
+ * matches the global rcu_gp.ctr value (or our node's copy of it): this is OK because a prior
  * _rcu_quiescent_state() or _rcu_thread_online() already updated it
  * within our thread, so we have no quiescent state to report.
  */
@@ -240,7 +262,8 @@ static inline void _rcu_quiescent_state(void)
 {
 	unsigned long gp_ctr;
 
-	if ((gp_ctr = CMM_LOAD_SHARED(rcu_gp.ctr)) == URCU_TLS(rcu_reader).ctr)
+	gp_ctr = CMM_LOAD_SHARED(*_rcu_gp_local_ctr());
+	if (gp_ctr == URCU_TLS(rcu_reader).ctr)
 		return;
 	_rcu_quiescent_state_update_and_wakeup(gp_ctr);
 }
@@ -273,7 +296,8 @@ static inline void _rcu_thread_offline(void)
 static inline void _rcu_thread_online(void)
 {
 	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
-	_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, CMM_LOAD_SHARED(rcu_gp.ctr));
+	_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr,
+			CMM_LOAD_SHARED(*_rcu_gp_local_ctr()));
 	cmm_smp_mb();
 }
 
@@ -41,6 +41,8 @@
 #include <urcu/list.h>
 #include <urcu/futex.h>
 #include <urcu/tls-compat.h>
+#include <urcu/static/read-profile.h>
+#include <urcu/static/gp-replica.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -157,6 +159,16 @@ static inline void rcu_debug_yield_init(void)
 #ifdef RCU_MEMBARRIER
 extern int rcu_has_sys_membarrier;
 
+/*
+ * With CONFIG_RCU_FORCE_SYS_MEMBARRIER, rcu_init() aborts if the kernel
+ * lacks sys_membarrier(), so readers need not check for it.
+ */
+#ifdef CONFIG_RCU_FORCE_SYS_MEMBARRIER
+static inline void smp_mb_slave(int group)
+{
+	cmm_barrier();
+}
+#else
 static inline void smp_mb_slave(int group)
 {
 	if (caa_likely(rcu_has_sys_membarrier))
@@ -165,6 +177,7 @@ static inline void smp_mb_slave(int group)
 		cmm_smp_mb();
 }
 #endif
+#endif
 
 #ifdef RCU_MB
 static inline void smp_mb_slave(int group)
@@ -199,15 +212,30 @@ struct rcu_gp {
 	 */
 	unsigned long ctr;
 
+#ifdef CONFIG_RCU_GP_REPLICAS
+	/*
+	 * Read by every outermost _rcu_read_unlock(): kept away from ctr,
+	 * which is written by each grace period.
+	 */
+	int32_t futex __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+#else
 	int32_t futex;
+#endif
 } __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
 
 extern struct rcu_gp rcu_gp;
 
+#ifdef CONFIG_RCU_GP_REPLICAS
+extern struct rcu_gp_replica rcu_gp_replica[RCU_GP_NR_REPLICAS];
+#endif
+
 struct rcu_reader {
 	/* Data used by both reader and synchronize_rcu() */
 	unsigned long ctr;
 	char need_mb;
+#ifdef CONFIG_RCU_GP_REPLICAS
+	unsigned int gp_replica;	/* Index in rcu_gp_replica. */
+#endif
 	/* Data used for registry */
 	struct cds_list_head node __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
 	pthread_t tid;
@@ -215,19 +243,56 @@ struct rcu_reader {
 
 extern DECLARE_URCU_TLS(struct rcu_reader, rcu_reader);
 
+/*
+ * RCU domains have their own grace period counter and registry, and
+ * track each registered thread with one struct rcu_reader per domain,
+ * found through the domain id.
+ */
+#define RCU_DOMAIN_MAX		64
+
+struct rcu_domain {
+	struct rcu_gp gp;
+	unsigned int id;	/* Index in rcu_domain_readers. */
+};
+
+struct rcu_domain_readers {
+	struct rcu_reader *reader[RCU_DOMAIN_MAX];
+};
+
+extern DECLARE_URCU_TLS(struct rcu_domain_readers, rcu_domain_readers);
+
 /*
  * Wake-up waiting synchronize_rcu(). Called from many concurrent threads.
  */
-static inline void wake_up_gp(void)
+static inline void __wake_up_gp(struct rcu_gp *gp)
 {
-	if (caa_unlikely(uatomic_read(&rcu_gp.futex) == -1)) {
-		uatomic_set(&rcu_gp.futex, 0);
-		futex_async(&rcu_gp.futex, FUTEX_WAKE, 1,
+	if (caa_unlikely(uatomic_read(&gp->futex) == -1)) {
+		uatomic_set(&gp->futex, 0);
+		futex_async(&gp->futex, FUTEX_WAKE, 1,
 		      NULL, NULL, 0);
 	}
 }
 
-static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
+static inline void wake_up_gp(void)
+{
+	__wake_up_gp(&rcu_gp);
+}
+
+/*
+ * Grace period counter read by the current thread: the copy of its node,
+ * if replicated.
+ */
+static inline unsigned long *_rcu_gp_local_ctr(void)
+{
+#ifdef CONFIG_RCU_GP_REPLICAS
+	return &rcu_gp_replica[URCU_TLS(rcu_reader).gp_replica].ctr;
+#else
+	return &rcu_gp.ctr;
+#endif
+}
+
+static inline enum rcu_state rcu_reader_state(struct rcu_gp *gp,
+		unsigned long *ctr)
 {
 	unsigned long v;
 
@@ -238,7 +303,7 @@ static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
 	v = CMM_LOAD_SHARED(*ctr);
 	if (!(v & RCU_GP_CTR_NEST_MASK))
 		return RCU_READER_INACTIVE;
-	if (!((v ^ rcu_gp.ctr) & RCU_GP_CTR_PHASE))
+	if (!((v ^ gp->ctr) & RCU_GP_CTR_PHASE))
 		return RCU_READER_ACTIVE_CURRENT;
 	return RCU_READER_ACTIVE_OLD;
 }
@@ -253,7 +318,8 @@ static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
 static inline void _rcu_read_lock_update(unsigned long tmp)
 {
 	if (caa_likely(!(tmp & RCU_GP_CTR_NEST_MASK))) {
-		_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, _CMM_LOAD_SHARED(rcu_gp.ctr));
+		_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr,
+			_CMM_LOAD_SHARED(*_rcu_gp_local_ctr()));
 		smp_mb_slave(RCU_MB_GROUP);
 	} else
 		_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, tmp + RCU_GP_COUNT);
@@ -276,6 +342,7 @@ static inline void _rcu_read_lock(void)
 	cmm_barrier();
 	tmp = URCU_TLS(rcu_reader).ctr;
 	_rcu_read_lock_update(tmp);
+	_rcu_read_profile_lock(tmp, __builtin_return_address(0));
 }
 
 /*
@@ -307,6 +374,7 @@ static inline void _rcu_read_unlock(void)
 	unsigned long tmp;
 
 	tmp = URCU_TLS(rcu_reader).ctr;
+	_rcu_read_profile_unlock(tmp);
 	_rcu_read_unlock_update_and_wakeup(tmp);
 	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
 }
@@ -323,6 +391,50 @@ static inline int _rcu_read_ongoing(void)
 	return URCU_TLS(rcu_reader).ctr & RCU_GP_CTR_NEST_MASK;
 }
 
+/*
+ * Same as _rcu_read_lock(), _rcu_read_unlock() and _rcu_read_ongoing(),
+ * within an RCU domain the thread is registered to.
+ */
+static inline void _rcu_domain_read_lock(struct rcu_domain *domain)
+{
+	struct rcu_reader *reader;
+	unsigned long tmp;
+
+	cmm_barrier();
+	reader = URCU_TLS(rcu_domain_readers).reader[domain->id];
+	tmp = reader->ctr;
+	if (caa_likely(!(tmp & RCU_GP_CTR_NEST_MASK))) {
+		_CMM_STORE_SHARED(reader->ctr, _CMM_LOAD_SHARED(domain->gp.ctr));
+		smp_mb_slave(RCU_MB_GROUP);
+	} else
+		_CMM_STORE_SHARED(reader->ctr, tmp + RCU_GP_COUNT);
+}
+
+static inline void _rcu_domain_read_unlock(struct rcu_domain *domain)
+{
+	struct rcu_reader *reader;
+	unsigned long tmp;
+
+	reader = URCU_TLS(rcu_domain_readers).reader[domain->id];
+	tmp = reader->ctr;
+	if (caa_likely((tmp & RCU_GP_CTR_NEST_MASK) == RCU_GP_COUNT)) {
+		smp_mb_slave(RCU_MB_GROUP);
+		_CMM_STORE_SHARED(reader->ctr, tmp - RCU_GP_COUNT);
+		smp_mb_slave(RCU_MB_GROUP);
+		__wake_up_gp(&domain->gp);
+	} else
+		_CMM_STORE_SHARED(reader->ctr, tmp - RCU_GP_COUNT);
+	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
+}
+
+static inline int _rcu_domain_read_ongoing(struct rcu_domain *domain)
+{
+	struct rcu_reader *reader;
+
+	reader = URCU_TLS(rcu_domain_readers).reader[domain->id];
+	return reader && (reader->ctr & RCU_GP_CTR_NEST_MASK);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,86 @@
+#ifndef _URCU_TRACE_H
+#define _URCU_TRACE_H
+
+/*
+ * urcu/trace.h
+ *
+ * Userspace RCU library - built-in event trace
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Events recorded by the library, with the meaning of their arguments. */
+enum rcu_trace_type {
+	RCU_TRACE_GP_START = 1,		/* Grace period sequence, expedited. */
+	RCU_TRACE_GP_END,		/* Grace period sequence, expedited. */
+	RCU_TRACE_CALL_RCU_BATCH,	/* Callbacks invoked, left queued. */
+	RCU_TRACE_CALL_RCU_SLEEP,	/* call_rcu thread waits for work. */
+	RCU_TRACE_CALL_RCU_WAKE,
+	RCU_TRACE_DEFER_BATCH,		/* Queue entries, ~1 per callback. */
+	RCU_TRACE_DEFER_SLEEP,		/* Defer thread waits for work. */
+	RCU_TRACE_DEFER_WAKE,
+	RCU_TRACE_LFHT_RESIZE_START,	/* Old size, new size. */
+	RCU_TRACE_LFHT_RESIZE_END,	/* Old size, new size. */
+	RCU_TRACE_NR_TYPES,
+};
+
+/*
+ * Format written by rcu_trace_dump(): a header, followed by
+ * "nr_records" records sorted by timestamp. Integers are in host byte
+ * order. tests/rcu_trace_decode prints it.
+ */
+#define RCU_TRACE_MAGIC		"URCUTRC"
+#define RCU_TRACE_VERSION	1
+
+struct rcu_trace_header {
+	char magic[8];			/* RCU_TRACE_MAGIC, NUL-terminated. */
+	uint32_t version;
+	uint32_t record_size;		/* sizeof(struct rcu_trace_record) */
+	uint64_t nr_records;
+};
+
+struct rcu_trace_record {
+	uint64_t ts_ns;			/* CLOCK_MONOTONIC. */
+	uint32_t tid;			/* Kernel thread id. */
+	uint32_t type;			/* enum rcu_trace_type */
+	uint64_t arg[2];
+};
+
+/* Records kept per thread, the oldest being overwritten. */
+#define RCU_TRACE_RING_ORDER	12
+
+/*
+ * Start or stop recording events, for all flavors and data structures
+ * of the process. Disabled by default.
+ */
+extern void rcu_trace_enable(int enable);
+
+/*
+ * Write the events recorded so far by every thread to "fd". Returns 0,
+ * or a negative error number.
+ */
+extern int rcu_trace_dump(int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_TRACE_H */